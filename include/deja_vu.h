@@ -0,0 +1,103 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Deja Vu Loop & Grain RNG
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// クロックごとのグレインパラメータ（ParamSnapshot）を決める Deja Vu ループと、その乱数。
+//   - 乱数の状態・ループの中身・ループ位置の3つがそろえば、同じつまみ・同じクロック列で
+//     同じ ParamSnapshot 列を返す（スナップショットはシードとループの中身を保存する）
+//   - 状態はオーディオタスクだけが書く（本体では loopTask からの要求を保留フラグで渡す）
+//   - スナップショットを2回ロードして同じ列になることは test/test_deja_vu で確認
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#ifndef DEJA_VU_H
+#define DEJA_VU_H
+
+#include <stdint.h>
+#include <string.h>
+#include "dsp_math.h"
+#include "grain_math.h"
+
+// ================================================================
+// 乱数
+// ================================================================
+// グレイン生成用の乱数（xoshiro128**、状態16バイト・32bit演算のみ）
+// esp_random() はハードウェアRNGの読み出しで遅く再現性もないため、トリガー経路ではこちらを使う
+struct GrainRng {
+    uint32_t s[4];
+    static inline uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+    // splitmix32 で32bitシードを状態に展開する（全ゼロ状態にはならない）
+    void seed(uint32_t seed) {
+        for (int i = 0; i < 4; i++) {
+            uint32_t z = (seed += 0x9E3779B9u);
+            z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+            z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+            s[i] = z ^ (z >> 16);
+        }
+    }
+    inline uint32_t next() {
+        uint32_t result = rotl(s[1] * 5, 7) * 9;
+        uint32_t t = s[1] << 9;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+    // 0..32767（上位ビットを使う）
+    inline int16_t uniformQ15() { return (int16_t)(next() >> 17); }
+    // -32767..32767（旧 (esp_random() % 65535) - 32767 と同じ範囲、分岐・除算なし）
+    inline int16_t bipolarQ15() { return (int16_t)((int32_t)(((next() >> 16) * 65535u) >> 16) - 32767); }
+};
+
+// ================================================================
+// Deja Vu
+// ================================================================
+constexpr int DEJA_VU_BUFFER_SIZE = 16;
+
+struct ParamSnapshot {
+    int16_t position_q15;
+    int16_t size_q15;
+    int16_t pitch_q8;         // Q8.8 semitones
+    int16_t texture_q15;
+};
+
+struct DejaVuLoop {
+    ParamSnapshot steps[DEJA_VU_BUFFER_SIZE];
+    int step;
+
+    // 保存しておいた中身に戻し、先頭から（乱数の再シードと同時に行う）
+    void restore(const ParamSnapshot* saved) {
+        memcpy(steps, saved, sizeof(steps));
+        step = 0;
+    }
+
+    // 1トリガー分。確率 deja_vu_q15 でループの今の段を再生し、それ以外は knobs（つまみの値）の
+    // 周りに TEXTURE に比例した揺らぎを引いて段に書く
+    ParamSnapshot next(GrainRng& rng, const ParamSnapshot& knobs, int16_t deja_vu_q15, int loop_length) {
+        bool replay = rng.uniformQ15() < deja_vu_q15;
+        ParamSnapshot out;
+        int current_step_in_loop = step % loop_length;
+
+        if (replay) {
+            out = steps[current_step_in_loop];
+        } else {
+            int16_t rand_val = rng.bipolarQ15();
+            int32_t pos_offset = ((int32_t)knobs.texture_q15 * rand_val) >> 14;
+            out.position_q15 = (int16_t)clamp32(knobs.position_q15 + pos_offset, 0, 32767);
+            rand_val = rng.bipolarQ15();
+            int32_t size_offset = ((int32_t)knobs.texture_q15 * rand_val) >> 15;
+            out.size_q15 = (int16_t)clamp32(knobs.size_q15 + size_offset, 1000, 32767);
+
+            rand_val = rng.bipolarQ15();
+            int32_t pitch_offset_q8 = (int32_t)(((int64_t)((int32_t)knobs.texture_q15 * rand_val) * DEJA_VU_PITCH_JITTER_K) >> 32);
+            out.pitch_q8 = (int16_t)clamp32(knobs.pitch_q8 + pitch_offset_q8, -PITCH_RANGE_Q8_HALF, PITCH_RANGE_Q8_HALF);
+            out.texture_q15 = knobs.texture_q15;
+            steps[current_step_in_loop] = out;
+        }
+
+        step = (step + 1) % DEJA_VU_BUFFER_SIZE;
+        return out;
+    }
+};
+
+#endif // DEJA_VU_H
@@ -0,0 +1,187 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Fixed-Point DSP Math (Q15 / Q16)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// オーディオ経路の固定小数点演算をまとめたヘッダ。
+//   - ESP32 (Xtensa LX6) では CLAMPS / MULL+MULSH を直接使う
+//   - それ以外（ホストテスト test/test_dsp_math など）は同じ結果になる移植版
+//     （mulShr は MULSH/MULL の上位・下位を64bit積から取り出して、実機と同じ組み立て方をする）
+//   - 各ヘルパーに *Ref（64bit の素直な定義）がある。ホストテストで全ヘルパーを照合し、
+//     実機の命令版（sat16 / mulShr）は起動時セルフテスト（PROFILE_ENABLED）でも照合する
+//   - 16bit 積で済ませているものは定義域をコメントに書く（その範囲で32bitが溢れない）
+//
+// 丸め: 名前に Round が付くものは最近接丸め（0.5 は正方向）、それ以外は従来のシフトと同じ切り捨て（負方向）
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#ifndef DSP_MATH_H
+#define DSP_MATH_H
+
+#include <stdint.h>
+
+#if defined(__XTENSA__)
+#include <xtensa/config/core-isa.h>
+#endif
+
+// ================================================================
+// リファレンス（64bit で定義どおりに計算する。速さは考えない）
+// ================================================================
+// v / 2^s の負方向への切り捨て（算術シフトに頼らない）
+inline int64_t shrFloorRef(int64_t v, int s) {
+    const int64_t d = (int64_t)1 << s;
+    int64_t q = v / d;
+    if (v % d != 0 && v < 0) q--;
+    return q;
+}
+
+// int16 へ飽和
+inline int32_t sat16Ref(int32_t x) {
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+// (a × b) >> S を64bit積で（結果は下位32bit）
+template <int S>
+inline int32_t mulShrRef(int32_t a, int32_t b) {
+    return (int32_t)(uint32_t)shrFloorRef((int64_t)a * b, S);
+}
+
+inline int16_t addSat16Ref(int32_t a, int32_t b) {
+    const int64_t v = (int64_t)a + b;
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+inline int32_t mulQ15Ref(int32_t a, int32_t b)      { return (int32_t)shrFloorRef((int64_t)a * b, 15); }
+inline int32_t mulQ15RoundRef(int32_t a, int32_t b) { return (int32_t)shrFloorRef((int64_t)a * b + (1 << 14), 15); }
+inline int32_t mulQ15WideRef(int32_t a, int32_t b)  { return mulShrRef<15>(a, b); }
+inline int32_t mulQ16Ref(int32_t a, int32_t b)      { return mulShrRef<16>(a, b); }
+inline int32_t macQ15Ref(int32_t acc, int32_t a, int32_t b) { return acc + mulQ15Ref(a, b); }
+inline int32_t lerpQ15Ref(int32_t a, int32_t b, int32_t frac_q15) {
+    return a + (int32_t)shrFloorRef((int64_t)(b - a) * frac_q15, 15);
+}
+inline int32_t onePoleQ15Ref(int32_t state, int32_t x, int32_t coef_q15) {
+    return (int32_t)shrFloorRef((int64_t)state * (32767 - coef_q15) + (int64_t)x * coef_q15, 15);
+}
+inline int32_t clamp32Ref(int32_t x, int32_t lo, int32_t hi) {
+    if (x < lo) return lo;
+    if (x > hi) return hi;
+    return x;
+}
+inline int32_t mix2Q15Ref(int32_t a, int32_t ga, int32_t b, int32_t gb) {
+    return (int32_t)shrFloorRef((int64_t)a * ga + (int64_t)b * gb, 15);
+}
+
+// 従来の分岐版ソフトクリップ（|x| ≤ 24576 はそのまま、膝は 24576 + e - e²/8192、e > 8191 で ±32767）
+inline int16_t softClipRef(int32_t x) {
+    if (x >= -24576 && x <= 24576) return (int16_t)x;
+    const int64_t e = (x > 0) ? (int64_t)x - 24576 : -24576 - (int64_t)x;
+    if (e > 8191) return x > 0 ? 32767 : -32767;
+    const int32_t soft = 24576 + (int32_t)e - (int32_t)((e * e) >> 13);
+    return (int16_t)(x > 0 ? soft : -soft);
+}
+
+// ================================================================
+// ターゲット向け（Xtensa 命令、なければ移植版）
+// ================================================================
+// int16 へ飽和（CLAMPS 1命令）
+inline int32_t sat16(int32_t x) {
+#if defined(__XTENSA__) && XCHAL_HAVE_CLAMPS
+    int32_t r;
+    __asm__("clamps %0, %1, 15" : "=a"(r) : "a"(x));
+    return r;
+#else
+    return sat16Ref(x);
+#endif
+}
+
+// (a × b) >> S、0 < S < 32。上位を MULSH、下位を MULL で取り出して組み立てる
+// （コンパイラ任せの64bit乗算はライブラリ呼び出しになることがある）
+// 命令がない環境では同じ上位・下位を64bit積から取り出し、組み立ては共通にする
+template <int S>
+inline int32_t mulShr(int32_t a, int32_t b) {
+    static_assert(S > 0 && S < 32, "shift must be 1..31");
+    int32_t hi, lo;
+#if defined(__XTENSA__) && XCHAL_HAVE_MUL32_HIGH
+    __asm__("mulsh %0, %1, %2" : "=a"(hi) : "a"(a), "a"(b));
+    __asm__("mull %0, %1, %2" : "=a"(lo) : "a"(a), "a"(b));
+#else
+    const int64_t p = (int64_t)a * b;
+    hi = (int32_t)(p >> 32);
+    lo = (int32_t)(uint32_t)p;
+#endif
+    return (int32_t)(((uint32_t)hi << (32 - S)) | ((uint32_t)lo >> S));
+}
+
+// ================================================================
+// Q15 / Q16 演算
+// ================================================================
+// 飽和加算（int16 の範囲で）。定義域: a + b が int32 に収まること
+inline int16_t addSat16(int32_t a, int32_t b) {
+    return (int16_t)sat16(a + b);
+}
+
+// Q15 × Q15。定義域: a, b とも int16（積は32bitに収まる）
+inline int32_t mulQ15(int32_t a, int32_t b) {
+    return (a * b) >> 15;
+}
+
+// Q15 × Q15（最近接丸め）。定義域は mulQ15 と同じ。
+// 帰還路で使う（切り捨ての負方向の偏りが周回ごとに溜まらないように）
+inline int32_t mulQ15Round(int32_t a, int32_t b) {
+    return (a * b + (1 << 14)) >> 15;
+}
+
+// 32bit値 × Q15（グレイン和など ±32767 を超える値に掛ける）
+inline int32_t mulQ15Wide(int32_t a, int32_t b) {
+    return mulShr<15>(a, b);
+}
+
+// 32bit値 × Q16
+inline int32_t mulQ16(int32_t a, int32_t b) {
+    return mulShr<16>(a, b);
+}
+
+// acc += a × b（Q15）。定義域は mulQ15 と同じ
+inline int32_t macQ15(int32_t acc, int32_t a, int32_t b) {
+    return acc + ((a * b) >> 15);
+}
+
+// a → b の線形補間（frac は Q15、0..32767）。定義域: a, b とも int16
+inline int32_t lerpQ15(int32_t a, int32_t b, int32_t frac_q15) {
+    return a + (((b - a) * frac_q15) >> 15);
+}
+
+// 1次ローパス: state × (1 - coef) + x × coef（Q15）。定義域: state, x とも int16、coef は 0..32767
+inline int32_t onePoleQ15(int32_t state, int32_t x, int32_t coef_q15) {
+    return (state * (32767 - coef_q15) + x * coef_q15) >> 15;
+}
+
+// 範囲制限（MIN/MAX 命令になる）
+inline int32_t clamp32(int32_t x, int32_t lo, int32_t hi) {
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// a × ga + b × gb（Q15）。2つの積を足してから1回だけ切り捨てる（b は32bit値でもよい）
+// （項ごとに >> 15 すると切り捨てが2回になり、最大1LSBずれる）
+inline int32_t mix2Q15(int32_t a, int32_t ga, int32_t b, int32_t gb) {
+    return (int32_t)(((int64_t)a * ga + (int64_t)b * gb) >> 15);
+}
+
+// ================================================================
+// ソフトクリップ
+// ================================================================
+// 高速tanh近似。入力は int32 全域、出力は -32767 ~ 32767
+// |x| ≤ 24576 はそのまま、超過分 e (≤ 8191) は 24576 + e - e²/8192、それ以上は ±32767。
+// 分岐版（区間ごとに if）とビット一致（test/test_soft_clip で確認）。膝の2次式は |x| = 28672 で
+// 最大 26624 になり、その先は下がって |x| = 32767 で 24577、32768 以上で 32767 に跳ぶ（従来の曲線のまま）。
+// 絶対値で計算して符号を戻し、区間の選択は MIN/MAX だけで行う（分岐なし。大音量で予測ミスしない）
+inline int16_t softClip(int32_t x) {
+    x = clamp32(x, -65535, 65535);                     // |x| の計算と e の引き算が溢れないように
+    const int32_t sign = x >> 31;                      // 0 or -1
+    const int32_t a = (x ^ sign) - sign;               // |x|
+    const int32_t e = clamp32(a - 24576, 0, 8191);
+    int32_t y = (a < 24576 ? a : 24576) + e - ((e * e) >> 13);
+    const int32_t full = ((32767 - a) >> 31) & 32767;  // |x| > 32767 なら 32767
+    y = y > full ? y : full;
+    return (int16_t)((y ^ sign) - sign);
+}
+
+#endif // DSP_MATH_H
@@ -0,0 +1,43 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Grain History Codec (8bit μ-law)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// 圧縮履歴（GRAIN_COMPRESSED_ENABLED）とアーカイブ段（GRAIN_TIERED_ENABLED）の符号化。
+//   - G.711 μ-law（16bit入力版）: 符号1bit + 区間3bit + 仮数4bit
+//   - 1サンプル1バイトで前後に依存しないので、どの位置も表引き1回で読める
+//   - デコード表は呼び出し側が decodeGrainSampleRef から作る（本体は DRAM の g_grain_decode_lut）
+//   - 量子化誤差は区間の刻みの半分以内、S/N はレベルによらずほぼ一定（test/test_grain_codec）
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#ifndef GRAIN_CODEC_H
+#define GRAIN_CODEC_H
+
+#include <stdint.h>
+
+// ================================================================
+// μ-law
+// ================================================================
+// 相対誤差がほぼ一定で、小さい音でも S/N が落ちにくい。
+// 無音が 0x00 になるよう G.711 のビット反転は省く（.bss の0クリアのままで無音）
+constexpr int32_t GRAIN_ULAW_BIAS = 0x84;
+constexpr int32_t GRAIN_ULAW_CLIP = 32635;
+
+// 定義域: int32 全体（|x| > 32635 は 32635 に飽和）
+inline uint8_t encodeGrainSample(int32_t x) {
+    const uint32_t sign = ((uint32_t)x >> 24) & 0x80;
+    const uint32_t mag = x < 0 ? 0u - (uint32_t)x : (uint32_t)x;
+    const int32_t a = (int32_t)(mag < (uint32_t)GRAIN_ULAW_CLIP ? mag : (uint32_t)GRAIN_ULAW_CLIP) + GRAIN_ULAW_BIAS;  // 132..32767 → 最上位ビットは 7..14
+    const int seg = 24 - __builtin_clz((uint32_t)a);                                                                   // 0..7（NSAU 1命令）
+    return (uint8_t)(sign | (seg << 4) | ((a >> (seg + 3)) & 0x0F));
+}
+
+// デコードは表をコンパイル時に作るので constexpr の1式で書く（仮数の刻みの中央に戻す）
+constexpr int32_t decodeGrainMagnitude(uint8_t code) {
+    return (((((int32_t)code & 0x0F) << 3) + GRAIN_ULAW_BIAS) << ((code >> 4) & 0x07)) - GRAIN_ULAW_BIAS;
+}
+constexpr int32_t decodeGrainSampleRef(uint8_t code) {
+    return (code & 0x80) ? -decodeGrainMagnitude(code) : decodeGrainMagnitude(code);
+}
+
+#endif // GRAIN_CODEC_H
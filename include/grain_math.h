@@ -0,0 +1,99 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Grain Trigger Math (integer)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// グレインのトリガー時に1回だけ計算する再生速度・パンの整数版。
+//   - オーディオタスクから呼ぶので浮動小数点は使わない（FPUコンテキスト退避を起こさない）
+//   - ピッチは Q8.8 半音、乱数は Q15（GrainRng::bipolarQ15）
+//   - LUT は呼び出し側が渡す（本体は main.cpp の DRAM/フラッシュ上の表、ホストテストは同じ生成式の表）
+//   - 旧 float 実装の式との誤差: 速度・パンとも ±1LSB 以内（test/test_grain_math）
+//     速度は式を double で評価した値と一致。float32 版そのものとは、LUT インデックスが
+//     Q8 の境界直下（例: 34.4999）の時に float の丸めが隣の段へ乗る分だけずれる（Q8 で1段以内）
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#ifndef GRAIN_MATH_H
+#define GRAIN_MATH_H
+
+#include <stdint.h>
+#include "dsp_math.h"
+#include "lut_gen.h"
+
+// ================================================================
+// 定数
+// ================================================================
+constexpr float PITCH_RANGE_SEMITONES = 48.0f;
+constexpr float PITCH_RANGE_SEMITONES_HALF = PITCH_RANGE_SEMITONES / 2.0f;
+constexpr int PITCH_LUT_SIZE = 257;
+constexpr int PAN_LUT_SIZE = 257;
+
+// ピッチはQ8.8半音（256 = 1半音）で保持し、トリガー経路では整数のみで扱う
+constexpr int PITCH_Q8_ONE = 256;
+constexpr int32_t PITCH_RANGE_Q8_HALF = (int32_t)PITCH_RANGE_SEMITONES_HALF * PITCH_Q8_ONE;  // ±24半音
+
+constexpr float PITCH_TEXTURE_VARIANCE = 0.2f;   // Pitch variation from texture
+constexpr float STEREO_SPREAD_SCALE = 0.5f;      // Stereo spread scaling factor
+// 整数トリガー経路用の乗数: (a_q15 * b_q15) * K >> 32 = (a/32767)*(b/32767)*scale をQ16で得る
+// （>>15 で近似すると /32768 との差で旧float計算から数LSBずれるため、32767²で割った値を使う）
+constexpr double Q15_PRODUCT_TO_Q48 = 65536.0 * 4294967296.0 / (32767.0 * 32767.0);
+constexpr int64_t PITCH_TEXTURE_VARIANCE_K = (int64_t)(PITCH_TEXTURE_VARIANCE * Q15_PRODUCT_TO_Q48 * 65536.0 + 0.5);  // → Q32半音
+constexpr int32_t STEREO_SPREAD_SCALE_K = (int32_t)(STEREO_SPREAD_SCALE * Q15_PRODUCT_TO_Q48 + 0.5);        // → Q16パン
+constexpr int32_t DEJA_VU_PITCH_JITTER_K = (int32_t)(5.0 * Q15_PRODUCT_TO_Q48 / 256.0 + 0.5);               // → Q8半音（±5半音）
+
+// ================================================================
+// LUT の生成式（コンパイル時）
+// ================================================================
+// ピッチ（半音 → 再生速度 Q16、±24半音）。
+// lutExp2 の誤差で整数オクターブ（2^n × 65536）が真値の直下になり切り捨てで1LSB落ちるので、
+// 切り捨ての前に 1e-6 足す（整数でない値の切り捨て結果は変わらない）
+constexpr double PITCH_LUT_TRUNC_EPSILON = 1e-6;
+constexpr int32_t pitchQ16(int i) {
+    return (int32_t)(lutgen::lutExp2(((double)i / (PITCH_LUT_SIZE - 1) * PITCH_RANGE_SEMITONES - PITCH_RANGE_SEMITONES_HALF) / 12.0) * 65536.0
+                     + PITCH_LUT_TRUNC_EPSILON);
+}
+
+// 等パワーパン（sin カーブ）
+constexpr int32_t panQ15(int i) {
+    return (int32_t)(lutgen::lutSin((double)i / (PAN_LUT_SIZE - 1) * (lutgen::PI_D * 0.5)) * 32767.0);
+}
+
+// ================================================================
+// 速度・パン
+// ================================================================
+// ピッチはQ32半音で計算し、LUTインデックス(Q8)へは ×256/48 = ×16/3 で変換する
+// （Q16 だと乱数項の切り捨てで真値が境界の直下に落ち、補間1段 = 最大11LSB ずれる。
+//   トリガー時に1回だけなので int64 の乗除算で精度を取る）
+inline int32_t grainSpeedQ16(const int32_t* pitch_lut, int16_t base_pitch_q8, int16_t texture, int16_t rand_val) {
+    int64_t pitch_rand_comp_q32 = ((int64_t)((int32_t)texture * rand_val) * PITCH_TEXTURE_VARIANCE_K) >> 32;
+    int64_t pitch_q32 = ((int64_t)base_pitch_q8 << 24) + pitch_rand_comp_q32;
+
+    int64_t index_q32 = (pitch_q32 + ((int64_t)PITCH_RANGE_Q8_HALF << 24)) * 16 / 3;
+    int32_t index_q8 = (int32_t)(index_q32 >> 24);
+    index_q8 = clamp32(index_q8, 0, (PITCH_LUT_SIZE - 2) << 8);
+
+    int index_i = index_q8 >> 8;
+    int32_t frac_q8 = index_q8 & 0xFF;
+    int32_t y0 = pitch_lut[index_i], y1 = pitch_lut[index_i + 1];
+    int32_t speed = y0 + (((y1 - y0) * frac_q8) >> 8);
+    return clamp32(speed, 1 << 14, 4 << 16);
+}
+
+// パン位置(Q16, 0..1) × (PAN_LUT_SIZE-1 = 256) がそのままQ8のLUTインデックスになる
+inline void grainPanQ15(const int16_t* pan_lut, int16_t spread_q15, int16_t pan_random, int16_t& panL, int16_t& panR) {
+    int32_t pan_q16 = 32768 + (int32_t)(((int64_t)((int32_t)spread_q15 * pan_random) * STEREO_SPREAD_SCALE_K) >> 32);
+    pan_q16 = clamp32(pan_q16, 0, 65536);
+
+    int32_t pan_index_q8 = pan_q16;
+    int pan_index_i = pan_index_q8 >> 8;
+    if (pan_index_i > PAN_LUT_SIZE - 2) pan_index_i = PAN_LUT_SIZE - 2;
+    int32_t frac_q8 = pan_index_q8 - (pan_index_i << 8);
+    panR = pan_lut[pan_index_i] + (((pan_lut[pan_index_i + 1] - pan_lut[pan_index_i]) * frac_q8) >> 8);
+
+    int32_t pan_index_l_q8 = ((PAN_LUT_SIZE - 1) << 8) - pan_index_q8;
+    int pan_index_l_i = pan_index_l_q8 >> 8;
+    if (pan_index_l_i > PAN_LUT_SIZE - 2) pan_index_l_i = PAN_LUT_SIZE - 2;
+    int32_t frac_l_q8 = pan_index_l_q8 - (pan_index_l_i << 8);
+    panL = pan_lut[pan_index_l_i] + (((pan_lut[pan_index_l_i + 1] - pan_lut[pan_index_l_i]) * frac_l_q8) >> 8);
+}
+
+#endif // GRAIN_MATH_H
@@ -0,0 +1,83 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Compile-Time LUT Generation
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// ルックアップテーブルをコンパイル時に作るためのヘッダ（C++11 の constexpr だけで書く）。
+//   - lutSin / lutCos / lutExp / lutExp2: double のテイラー級数（起動時の sinf/cosf/exp2f の代わり）
+//   - LutTable<T, N>: 配列1つだけの構造体。ポインタへ暗黙変換できるので、従来の配列と同じ
+//     g_xxx[i] / const T* p = g_xxx で読める
+//   - makeLut<T, N>(gen): gen(0) .. gen(N-1) を並べたテーブル（gen は constexpr 関数）
+//
+// 置き場所は定義側で決める: const のままなら .rodata（フラッシュ）、DRAM_ATTR を付ければ内部RAM
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#ifndef LUT_GEN_H
+#define LUT_GEN_H
+
+#include <stdint.h>
+
+namespace lutgen {
+
+constexpr double PI_D = 3.14159265358979323846;
+constexpr int SERIES_TERMS = 32;  // |x| ≤ π で double の精度に十分
+
+// ================================================================
+// 数学関数（constexpr）
+// ================================================================
+// [-π, π] へ畳み込む
+constexpr double wrapPi(double x) {
+    return x - 2.0 * PI_D * (double)(long long)(x / (2.0 * PI_D) + (x >= 0 ? 0.5 : -0.5));
+}
+
+// Σ (-1)^k x^(2k+1) / (2k+1)!（term が現在の項、x2 = x²）
+constexpr double sinSeries(double x2, double term, int k, double sum) {
+    return k > SERIES_TERMS ? sum + term
+                            : sinSeries(x2, -term * x2 / ((2.0 * k) * (2.0 * k + 1.0)), k + 1, sum + term);
+}
+// Σ (-1)^k x^(2k) / (2k)!
+constexpr double cosSeries(double x2, double term, int k, double sum) {
+    return k > SERIES_TERMS ? sum + term
+                            : cosSeries(x2, -term * x2 / ((2.0 * k - 1.0) * (2.0 * k)), k + 1, sum + term);
+}
+// Σ x^k / k!（x ≥ 0 で使う。負の引数は逆数にして桁落ちを避ける）
+constexpr double expSeries(double x, double term, int k, double sum) {
+    return k > 2 * SERIES_TERMS ? sum + term : expSeries(x, term * x / k, k + 1, sum + term);
+}
+
+constexpr double lutSin(double x) { return sinSeries(wrapPi(x) * wrapPi(x), wrapPi(x), 1, 0.0); }
+constexpr double lutCos(double x) { return cosSeries(wrapPi(x) * wrapPi(x), 1.0, 1, 0.0); }
+constexpr double lutExp(double x) { return x < 0 ? 1.0 / expSeries(-x, 1.0, 1, 0.0) : expSeries(x, 1.0, 1, 0.0); }
+constexpr double lutExp2(double x) { return lutExp(x * 0.69314718055994530942); }
+constexpr double lutMin(double a, double b) { return a < b ? a : b; }
+
+// 最近接丸め（0.5 は0から遠い側、lroundf と同じ）
+constexpr int32_t lutRound(double x) { return x >= 0 ? (int32_t)(x + 0.5) : -(int32_t)(-x + 0.5); }
+
+// ================================================================
+// テーブル
+// ================================================================
+template <typename T, int N>
+struct LutTable {
+    T v[N];
+    constexpr operator const T*() const { return v; }
+};
+
+// 0..N-1 のインデックス列（C++11 には std::index_sequence がないので自前で）
+template <int... I> struct Indices {};
+template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+template <typename T, typename G, int... I>
+constexpr LutTable<T, sizeof...(I)> makeLutFrom(G gen, Indices<I...>) {
+    return LutTable<T, sizeof...(I)>{{ static_cast<T>(gen(I))... }};
+}
+
+template <typename T, int N, typename G>
+constexpr LutTable<T, N> makeLut(G gen) {
+    return makeLutFrom<T>(gen, typename MakeIndices<N>::type());
+}
+
+}  // namespace lutgen
+
+#endif // LUT_GEN_H
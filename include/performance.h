@@ -15,6 +15,63 @@
 #include <Arduino.h>
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
+#include "esp_freertos_hooks.h"
+
+// ================================================================
+// コア負荷メーター（常時有効）
+// ================================================================
+// 各コアのアイドルフックの呼び出し回数からCPU負荷を推定する。
+// アイドルタスクが回れた回数 ÷ 観測最大回数 = アイドル率。
+// 表示タスクのフレームレート制御でも使うため PROFILE_ENABLED とは無関係に有効。
+constexpr unsigned long CORE_LOAD_WINDOW_MS = 250;
+
+struct CoreLoadMeter {
+    volatile uint32_t idle_count;   // アイドルフック呼び出し回数
+    uint32_t last_count;
+    uint32_t max_rate;              // 観測された最大アイドル回数/ms（校正値）
+    uint8_t  load_pct;              // 直近ウィンドウの負荷（0-100%）
+};
+
+// グローバルメーター（main.cpp で定義）
+extern CoreLoadMeter g_coreLoad[2];
+
+inline bool coreLoadIdleHook0() { g_coreLoad[0].idle_count++; return false; }
+inline bool coreLoadIdleHook1() { g_coreLoad[1].idle_count++; return false; }
+
+// アイドルフック登録（起動の最初に呼ぶ）。校正用の待ち時間は取らない:
+// 両コアは同じクロックでアイドルフックのコストも同じなので、最大アイドル率は両コアで共有し、
+// 入力待ちで空いているコア1（または空いた瞬間のコア0）の値がそのまま校正値になる
+inline void initCoreLoadMeters() {
+    memset(g_coreLoad, 0, sizeof(g_coreLoad));
+    esp_register_freertos_idle_hook_for_cpu(coreLoadIdleHook0, 0);
+    esp_register_freertos_idle_hook_for_cpu(coreLoadIdleHook1, 1);
+}
+
+// ウィンドウ経過時のみ負荷を再計算する。呼ぶのは表示タスク（updateFrameScheduler）だけ:
+// 窓の時刻と last_count は排他なしで書き換えるので、別コアから重ねて呼ぶと差分が ≈0 になり
+// 負荷 100% に見える。ほかの場所は load_pct を読むだけにする
+inline void updateCoreLoad() {
+    static unsigned long lastWindowTime = 0;
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastWindowTime;
+    if (elapsed < CORE_LOAD_WINDOW_MS) return;
+    lastWindowTime = now;
+
+    uint32_t rate[2];
+    uint32_t max_rate = max(g_coreLoad[0].max_rate, g_coreLoad[1].max_rate);
+    for (int core = 0; core < 2; core++) {
+        CoreLoadMeter& m = g_coreLoad[core];
+        uint32_t count = m.idle_count;
+        rate[core] = (count - m.last_count) / elapsed;
+        m.last_count = count;
+        if (rate[core] > max_rate) max_rate = rate[core];
+    }
+    for (int core = 0; core < 2; core++) {
+        CoreLoadMeter& m = g_coreLoad[core];
+        m.max_rate = max_rate;
+        m.load_pct = (max_rate > 0) ? (uint8_t)(100 - min(rate[core] * 100 / max_rate, (uint32_t)100)) : 0;
+    }
+}
 
 // ================================================================
 // プロファイリング制御
@@ -24,6 +81,12 @@
 // 統計情報の出力間隔（ミリ秒）
 #define PROFILE_REPORT_INTERVAL_MS 5000
 
+// レイヤー別カウンターの最大数（GRAIN_LAYERS の上限）
+#define PROFILE_MAX_LAYERS 4
+
+// 持続発音数の構成（リバーブエンジン Freeverb / FDN4 / FDN8 + リバーブ停止）
+#define PROFILE_REVERB_SLOTS 4
+
 // ================================================================
 // パフォーマンスカウンター
 // ================================================================
@@ -33,11 +96,63 @@ struct PerformanceCounters {
     uint32_t renderGrain_us;
     uint32_t renderAllGrains_us;
     uint32_t updateDisplay_us;
+    uint32_t cloudScheduler_us;     // クラウドスケジューラ（1ブロックあたり）
+
+    // 表示タスク（フレームスケジューラ）
+    uint32_t frame_hist[8];         // フレーム時間ヒストグラム（FRAME_HIST_EDGES_MS 参照）
+    uint16_t display_fps_x10;       // 達成fps ×10
+    uint16_t viz_fps_x10;           // ビジュアライザ達成fps ×10
+    uint8_t  viz_divider;           // ビジュアライザ間引き率
+    uint8_t  audio_headroom_min_pct; // オーディオ締切までの最小余裕
+    uint16_t limiter_gr_db_x10;     // マスターリミッターのゲインリダクション（直近ウィンドウの最大、dB ×10）
+    uint16_t max_limiter_gr_db_x10; // 同（レポート間の最大）
+    uint32_t ui_spi_bytes;          // パラメータパネルのSPI転送量（直近フレーム）
+    uint32_t max_ui_spi_bytes;
+
+    // グレイン補間（起動時ベンチマーク）
+    uint16_t interp_cycles_x10[3];  // 補間方式別 cycles/sample ×10（Linear/Hermite/Sinc、1グレインあたり）
+    uint8_t  interp_mode_active;    // 直近ブロックで使った補間方式
+    int16_t  grain_codec_snr_db_x10[2];     // 圧縮履歴の S/N（-6 / -30 dBFS、dB ×10）
+    uint16_t grain_codec_encode_cycles_x10; // 圧縮履歴のエンコード cycles/sample ×10
+
+    // リバーブ（起動時ベンチマーク、ステレオ1サンプルあたり）
+    uint16_t reverb_ref_cycles_x10;   // サンプル単位の参照実装
+    uint16_t reverb_block_cycles_x10; // ブロック処理版
+    bool     reverb_bit_exact;        // 両者の出力が一致したか
+    uint16_t reverb_fdn_cycles_x10[2]; // FDN 4ライン / 8ライン
+
+    // 固定小数点演算（起動時セルフテスト、dsp_math.h の命令版と移植版の不一致数）
+    uint32_t dsp_math_mismatches;
+
+    // DSP の配置（コアごとの処理時間の割合、I2S待ちは含まない）
+    uint8_t  dsp_core1_pct;         // グレイン段（シングルコア動作時は全段）
+    uint8_t  dsp_core0_pct;         // リバーブ・出力段（DSP_PIPELINE_ENABLED でパイプライン動作時）
+    uint8_t  dsp_active_grains;     // 同じ窓の終わりの発音数
+    bool     pipeline_active;
+    uint32_t pipeline_switches;     // パイプライン ⇔ シングルコアの切り替え回数
+    // 実測の持続発音数 [シングルコア/パイプライン][リバーブ構成]（起動からの最大、0 = 該当する窓なし）
+    uint8_t  max_sustained_grains[2][PROFILE_REVERB_SLOTS];
+
+    // グラニュラーレイヤー（GRAIN_LAYERS、レポート間の積算）
+    uint8_t  layer_count;
+    uint8_t  layer_core[PROFILE_MAX_LAYERS];
+    uint32_t layer_busy_us[PROFILE_MAX_LAYERS];       // クラウド+レンダリングの処理時間
+    uint32_t layer_voice_samples[PROFILE_MAX_LAYERS]; // 発音数 × サンプル数
+    uint32_t layer_samples[PROFILE_MAX_LAYERS];
+    uint32_t max_layer_render_us[PROFILE_MAX_LAYERS]; // 1ブロックの最大
+    uint32_t layer_wait_us;         // コア1がコア0のレイヤーを待った時間
+    uint32_t max_layer_wait_us;
 
     // 実行回数
     uint32_t processAudioSample_count;
     uint32_t renderGrain_count;
     uint32_t grainTrigger_count;
+    uint32_t cloud_grain_count;     // クラウドが発音したグレイン
+    uint32_t archive_grain_count;   // アーカイブ段から読んだグレイン（GRAIN_TIERED_ENABLED）
+    uint32_t cloud_dropped_count;   // 空きボイスがなく捨てたオンセット
+    uint32_t grain_bypass_blocks;   // グレインを状態だけ進めたブロック（ウェット0・バッファ無音）
+    uint32_t reverb_bypass_blocks;  // リバーブを止めたブロック（MIX 0・残響が消え切った）
+    uint32_t feedback_bypass_blocks; // フィードバック書き込みを止めたブロック
 
     // 累積時間（オーバーフロー対策）
     uint64_t total_audio_processing_us;
@@ -59,8 +174,28 @@ struct PerformanceCounters {
     // 最大実行時間（マイクロ秒）
     uint32_t max_processAudioSample_us;
     uint32_t max_renderGrain_us;
+    uint32_t max_updateDisplay_us;
+    uint32_t max_cloudScheduler_us;
+};
+
+// レイヤー1つ分のカウンター（GranularEngine が持つ）。
+// そのレイヤーをレンダリングするタスクだけが書き、ブロックの合流でオーディオタスクが g_perf へ移す
+// （コア0とコア1が同じ g_perf のフィールドを同時に ++ しないように）
+struct LayerPerfCounters {
+    uint32_t busy_us;               // クラウド+レンダリング（このブロック）
+    uint32_t cloud_us;              // クラウドスケジューラ（このブロック）
+    uint32_t voice_samples;
+    uint32_t samples;
+    uint32_t cloud_grain_count;
+    uint32_t cloud_dropped_count;
+    uint32_t archive_grain_count;
+    uint32_t grain_bypass_blocks;
+    uint8_t  interp_mode;
 };
 
+// フレーム時間ヒストグラムのビン上限（ミリ秒、最後のビンはそれ以上）
+constexpr uint16_t FRAME_HIST_EDGES_MS[7] = {2, 4, 8, 16, 33, 50, 100};
+
 // グローバルカウンター
 extern PerformanceCounters g_perf;
 
@@ -84,26 +219,19 @@ extern PerformanceCounters g_perf;
 // CPU使用率測定
 // ================================================================
 inline void updateCpuUsage() {
-    static uint32_t lastIdleTime0 = 0, lastIdleTime1 = 0;
-    static uint32_t lastTotalTime = 0;
-
-    uint32_t idleTime0 = xTaskGetIdleTaskCountForCore(0);
-    uint32_t idleTime1 = xTaskGetIdleTaskCountForCore(1);
-    uint32_t totalTime = millis();
-
-    if (lastTotalTime > 0) {
-        uint32_t deltaTime = totalTime - lastTotalTime;
-        uint32_t deltaIdle0 = idleTime0 - lastIdleTime0;
-        uint32_t deltaIdle1 = idleTime1 - lastIdleTime1;
-
-        // CPU使用率 = 100% - (アイドル時間の割合)
-        g_perf.cpu_usage_core0 = 100.0f - (deltaIdle0 * 100.0f / deltaTime);
-        g_perf.cpu_usage_core1 = 100.0f - (deltaIdle1 * 100.0f / deltaTime);
-    }
+    // CPU使用率 = 100% - (アイドル率)。計測は表示タスクのコア負荷メーター（ここでは読むだけ）
+    g_perf.cpu_usage_core0 = g_coreLoad[0].load_pct;
+    g_perf.cpu_usage_core1 = g_coreLoad[1].load_pct;
+}
 
-    lastIdleTime0 = idleTime0;
-    lastIdleTime1 = idleTime1;
-    lastTotalTime = totalTime;
+// ================================================================
+// フレーム時間の記録（表示タスクから毎フレーム呼ぶ）
+// ================================================================
+inline void profileRecordFrame(uint32_t frame_us) {
+    uint32_t frame_ms = frame_us / 1000;
+    int bin = 0;
+    while (bin < 7 && frame_ms >= FRAME_HIST_EDGES_MS[bin]) bin++;
+    g_perf.frame_hist[bin]++;
 }
 
 // ================================================================
@@ -150,13 +278,135 @@ inline void printPerformanceReport() {
     Serial.printf("  renderGrain: %u μs (max: %u μs)\n",
                   g_perf.renderGrain_us, g_perf.max_renderGrain_us);
     Serial.printf("  renderAllGrains: %u μs\n", g_perf.renderAllGrains_us);
-    Serial.printf("  updateDisplay: %u μs\n", g_perf.updateDisplay_us);
+    Serial.printf("  updateDisplay: %u μs (max: %u μs)\n",
+                  g_perf.updateDisplay_us, g_perf.max_updateDisplay_us);
+    Serial.printf("  cloudScheduler: %u μs/block (max: %u μs)\n",
+                  g_perf.cloudScheduler_us, g_perf.max_cloudScheduler_us);
+
+    // 表示タスク（達成fpsとフレーム時間分布）
+    Serial.println(F("\n[Display Task]"));
+    Serial.printf("  UI: %u.%u fps | Visualizer: %u.%u fps (1/%u)\n",
+                  g_perf.display_fps_x10 / 10, g_perf.display_fps_x10 % 10,
+                  g_perf.viz_fps_x10 / 10, g_perf.viz_fps_x10 % 10, g_perf.viz_divider);
+    Serial.printf("  Audio headroom (min): %u%%\n", g_perf.audio_headroom_min_pct);
+    Serial.printf("  Limiter GR: -%u.%u dB (max: -%u.%u dB)\n",
+                  g_perf.limiter_gr_db_x10 / 10, g_perf.limiter_gr_db_x10 % 10,
+                  g_perf.max_limiter_gr_db_x10 / 10, g_perf.max_limiter_gr_db_x10 % 10);
+    g_perf.max_limiter_gr_db_x10 = 0;
+    Serial.printf("  UI SPI: %u bytes/frame (max: %u)\n", g_perf.ui_spi_bytes, g_perf.max_ui_spi_bytes);
+    g_perf.max_ui_spi_bytes = 0;
+    Serial.print("  Frame time [ms]:");
+    for (int i = 0; i < 8; i++) {
+        if (i < 7) Serial.printf(" <%u:%u", FRAME_HIST_EDGES_MS[i], g_perf.frame_hist[i]);
+        else       Serial.printf(" >=%u:%u", FRAME_HIST_EDGES_MS[6], g_perf.frame_hist[i]);
+    }
+    Serial.println();
+    memset(g_perf.frame_hist, 0, sizeof(g_perf.frame_hist));
+
+    // グレイン補間カーネル（1グレインあたりのコスト → 発音数の予算を見積もる）
+    // 1サンプルの予算は 240MHz / 44.1kHz ≈ 5442 cycles
+    static const char* const INTERP_NAMES[3] = {"Linear", "Hermite", "Sinc"};
+    constexpr uint32_t CYCLES_PER_SAMPLE_X10 = 54422;
+    Serial.println(F("\n[Grain Interpolation]"));
+    for (int m = 0; m < 3; m++) {
+        uint32_t c = g_perf.interp_cycles_x10[m];
+        uint32_t pct_x10 = (c * 1000) / CYCLES_PER_SAMPLE_X10;
+        Serial.printf("  %-7s: %u.%u cycles/sample (%u.%u%% of core 1 per grain)\n",
+                      INTERP_NAMES[m], c / 10, c % 10, pct_x10 / 10, pct_x10 % 10);
+    }
+    Serial.printf("  Active: %s\n", INTERP_NAMES[g_perf.interp_mode_active < 3 ? g_perf.interp_mode_active : 0]);
+
+    // DSP の配置と発音数
+    //   - 実測: 実際の音声経路で、窓（FRAME_SCHED_EVAL_INTERVAL_MS）の間ずっと締切の余裕が0より大きかったときの
+    //     最小発音数の最大。構成（モード × リバーブ）が窓の途中で変わった窓は数えない。
+    //     実際に鳴らした発音数までしか分からないので、上限ではなく「ここまでは持続した」値
+    //   - 見積もり: グレイン段のコアに20%の余裕を残し、起動時ベンチマークのリニア補間1グレインのコストで割る
+    Serial.println(F("\n[DSP Placement]"));
+    Serial.printf("  Mode: %s (switches: %u) | core1 DSP: %u%% | core0 DSP: %u%% | grains: %u\n",
+                  g_perf.pipeline_active ? "dual-core pipeline" : "single-core",
+                  g_perf.pipeline_switches, g_perf.dsp_core1_pct, g_perf.dsp_core0_pct, g_perf.dsp_active_grains);
+    static const char* const REVERB_SLOT_NAMES[PROFILE_REVERB_SLOTS] = {"FV", "FDN4", "FDN8", "off"};
+    static const char* const MODE_NAMES[2] = {"single-core", "pipeline"};
+    Serial.print(F("  Sustained grains (measured, headroom > 0):"));
+    for (int r = 0; r < PROFILE_REVERB_SLOTS; r++) Serial.printf(" %6s", REVERB_SLOT_NAMES[r]);
+    Serial.println();
+    for (int m = 0; m < 2; m++) {
+        Serial.printf("    %-40s", MODE_NAMES[m]);
+        for (int r = 0; r < PROFILE_REVERB_SLOTS; r++) {
+            uint8_t g = g_perf.max_sustained_grains[m][r];
+            if (g > 0) Serial.printf(" %6u", g);
+            else       Serial.print(F("      -"));
+        }
+        Serial.println();
+    }
+    int32_t voice_pct_x10 = (int32_t)((g_perf.interp_cycles_x10[0] * 1000UL) / CYCLES_PER_SAMPLE_X10);
+    if (voice_pct_x10 > 0) {
+        int32_t fixed_pct_x10 = g_perf.dsp_core1_pct * 10 - g_perf.dsp_active_grains * voice_pct_x10;
+        Serial.printf("  Voice budget (estimate from boot benchmark, Linear, 20%% margin): ~%d\n",
+                      (int)max((int32_t)0, (800 - fixed_pct_x10) / voice_pct_x10));
+    }
+#if defined(GRAIN_COMPRESSED_ENABLED) || defined(GRAIN_TIERED_ENABLED)
+    // 圧縮履歴（上の cycles はデコード込み）
+    Serial.printf("  mu-law history: SNR %d.%d dB @-6dBFS, %d.%d dB @-30dBFS | encode %u.%u cycles\n",
+                  g_perf.grain_codec_snr_db_x10[0] / 10, abs(g_perf.grain_codec_snr_db_x10[0]) % 10,
+                  g_perf.grain_codec_snr_db_x10[1] / 10, abs(g_perf.grain_codec_snr_db_x10[1]) % 10,
+                  g_perf.grain_codec_encode_cycles_x10 / 10, g_perf.grain_codec_encode_cycles_x10 % 10);
+#endif
+
+    // グラニュラーレイヤー（コアごとの処理時間から、1ボイスのコストとそのコアに入る発音数を見積もる）
+    // 1サンプルの実時間は 1e6 / 44100 ≈ 22.68 μs。収容数はレイヤー単独で80%まで使った場合
+    if (g_perf.layer_count > 1) {
+        Serial.println(F("\n[Granular Layers]"));
+        for (int k = 0; k < g_perf.layer_count && k < PROFILE_MAX_LAYERS; k++) {
+            uint32_t samples = g_perf.layer_samples[k];
+            uint32_t voice_samples = g_perf.layer_voice_samples[k];
+            if (samples == 0) continue;
+            uint32_t realtime_us = (uint32_t)(((uint64_t)samples * 1000000ULL) / 44100);
+            uint32_t load_x10 = (uint32_t)(((uint64_t)g_perf.layer_busy_us[k] * 1000) / max(realtime_us, (uint32_t)1));
+            uint32_t voices_x10 = (uint32_t)(((uint64_t)voice_samples * 10) / samples);
+            Serial.printf("  L%d (core %u): voices %u.%u | load %u.%u%% | max %u μs/block",
+                          k, g_perf.layer_core[k], voices_x10 / 10, voices_x10 % 10,
+                          load_x10 / 10, load_x10 % 10, g_perf.max_layer_render_us[k]);
+            if (voice_samples > 0) {
+                // ns / (ボイス × サンプル)
+                uint32_t voice_ns = (uint32_t)(((uint64_t)g_perf.layer_busy_us[k] * 1000) / voice_samples);
+                Serial.printf(" | %u ns/voice-sample | capacity ~%u voices", voice_ns, (uint32_t)(18141 / max(voice_ns, (uint32_t)1)));
+            }
+            Serial.println();
+            g_perf.layer_busy_us[k] = 0;
+            g_perf.layer_voice_samples[k] = 0;
+            g_perf.layer_samples[k] = 0;
+            g_perf.max_layer_render_us[k] = 0;
+        }
+        Serial.printf("  Core 1 waited for core 0: %u μs total (max %u μs/block)\n",
+                      g_perf.layer_wait_us, g_perf.max_layer_wait_us);
+        g_perf.layer_wait_us = 0;
+        g_perf.max_layer_wait_us = 0;
+    }
+
+    // リバーブ（参照実装との一致とコスト比）
+    Serial.println(F("\n[Reverb]"));
+    Serial.printf("  per-sample: %u.%u cycles | block: %u.%u cycles | bit-exact: %s\n",
+                  g_perf.reverb_ref_cycles_x10 / 10, g_perf.reverb_ref_cycles_x10 % 10,
+                  g_perf.reverb_block_cycles_x10 / 10, g_perf.reverb_block_cycles_x10 % 10,
+                  g_perf.reverb_bit_exact ? "yes" : "NO");
+    Serial.printf("  FDN4: %u.%u cycles | FDN8: %u.%u cycles\n",
+                  g_perf.reverb_fdn_cycles_x10[0] / 10, g_perf.reverb_fdn_cycles_x10[0] % 10,
+                  g_perf.reverb_fdn_cycles_x10[1] / 10, g_perf.reverb_fdn_cycles_x10[1] % 10);
+    Serial.printf("  DSP math self-test: %s (%u mismatches)\n",
+                  g_perf.dsp_math_mismatches == 0 ? "OK" : "FAIL", g_perf.dsp_math_mismatches);
 
     // 実行回数
     Serial.println(F("\n[Call Counts]"));
     Serial.printf("  Audio samples processed: %u\n", g_perf.processAudioSample_count);
     Serial.printf("  Grains rendered: %u\n", g_perf.renderGrain_count);
     Serial.printf("  Grains triggered: %u\n", g_perf.grainTrigger_count);
+    Serial.printf("  Cloud grains: %u (dropped: %u)\n", g_perf.cloud_grain_count, g_perf.cloud_dropped_count);
+#ifdef GRAIN_TIERED_ENABLED
+    Serial.printf("  Archive-tier grains: %u\n", g_perf.archive_grain_count);
+#endif
+    Serial.printf("  Bypassed blocks: grains %u | reverb %u | feedback %u\n",
+                  g_perf.grain_bypass_blocks, g_perf.reverb_bypass_blocks, g_perf.feedback_bypass_blocks);
 
     // オーディオバッファ状態
     Serial.println(F("\n[Audio Buffer Status]"));
@@ -188,6 +438,7 @@ inline void resetPerformanceCounters() {
 inline void printPerformanceReport() {}
 inline void resetPerformanceCounters() {}
 inline void updateCpuUsage() {}
+inline void profileRecordFrame(uint32_t frame_us) {}
 inline void updateMemoryStats() {}
 
 #endif // PROFILE_ENABLED
@@ -0,0 +1,343 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Reverb Engines (Freeverb / FDN, int16)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// リバーブの構造体と処理。ディレイメモリは持たず、呼び出し側が渡した領域を切り分けて使う
+// （本体は Freeverb と FDN で同じ g_reverbMem を共用する）。
+//   - Freeverb: process()（サンプル単位の参照実装）と processBlock()（ブロック版）はビット一致
+//     （test/test_reverb で確認）
+//   - FDN: 4 / 8ライン、ブロック単位の LFO でタップを揺らす
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#ifndef REVERB_H
+#define REVERB_H
+
+#include <stdint.h>
+#include <string.h>
+#include "dsp_math.h"
+
+// ================================================================
+// 定数
+// ================================================================
+constexpr uint16_t REVERB_COMB_LENGTHS[8] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};  // L1-4, R1-4
+constexpr uint16_t REVERB_AP_LENGTHS[4] = {225, 341, 441, 556};                                // L1-2, R1-2
+constexpr int sumReverbLengths(const uint16_t* len, int n) { return n == 0 ? 0 : len[n - 1] + sumReverbLengths(len, n - 1); }
+constexpr int REVERB_FREEVERB_SAMPLES = sumReverbLengths(REVERB_COMB_LENGTHS, 8) + sumReverbLengths(REVERB_AP_LENGTHS, 4);
+// FDN（フィードバック・ディレイ・ネットワーク）: 4本なら1本おきの基準長を使う。実長は予算に比例配分
+constexpr int FDN_MAX_LINES = 8;
+constexpr uint16_t FDN_BASE_LENGTHS[FDN_MAX_LINES] = {1009, 1151, 1297, 1439, 1583, 1733, 1877, 2029};  // 素数
+constexpr int FDN_MOD_DEPTH = 12;          // タップ位置の揺れ幅（サンプル）
+constexpr uint32_t FDN_LFO_INC = 48695;    // 0.5Hz（Q32位相/サンプル）
+
+// ================================================================
+// 構造体
+// ================================================================
+// コムフィルタ（ディレイ + フィードバック + ローパス）
+struct CombFilter {
+    int16_t* buffer;
+    uint16_t bufferSize;
+    uint16_t writePos;
+    int16_t feedback_q15;
+    int16_t damping_q15;
+    int16_t filterState;  // 1次ローパスフィルタの状態変数
+
+    void init(int16_t* buf, uint16_t size) {
+        buffer = buf;
+        bufferSize = size;
+        writePos = 0;
+        feedback_q15 = 0;
+        damping_q15 = 16384;  // 0.5
+        filterState = 0;
+    }
+
+    int16_t process(int16_t input) {
+        int16_t output = buffer[writePos];
+        // ローパスフィルタ: filterState = filterState * (1-damp) + output * damp
+        filterState = (int16_t)onePoleQ15(filterState, output, damping_q15);
+        // フィードバック: input + filterState * feedback（int16 で飽和。折り返すと大音量で破綻する）
+        buffer[writePos] = addSat16(input, mulQ15(filterState, feedback_q15));
+        writePos = (writePos + 1) % bufferSize;
+        return output;
+    }
+
+    // ブロック処理（process() とビット一致）。折り返しまでの区間ごとにポインタで回して剰余をなくし、
+    // 係数とフィルタ状態はブロックの間ローカル変数に置く。出力は acc に加算する
+    void processBlock(const int16_t* in, int32_t* acc, int n) {
+        const int32_t fb = feedback_q15;
+        const int32_t damp = damping_q15;
+        int32_t state = filterState;
+        int pos = writePos;
+        while (n > 0) {
+            int run = (n < (int)bufferSize - pos) ? n : (int)bufferSize - pos;
+            int16_t* p = buffer + pos;
+            for (int i = 0; i < run; i++) {
+                int16_t output = p[i];
+                state = (int16_t)onePoleQ15(state, output, damp);
+                p[i] = addSat16(in[i], mulQ15(state, fb));
+                acc[i] += output;
+            }
+            in += run;
+            acc += run;
+            n -= run;
+            pos += run;
+            if (pos == bufferSize) pos = 0;
+        }
+        writePos = pos;
+        filterState = (int16_t)state;
+    }
+};
+
+// オールパスフィルタ（拡散処理）
+struct AllpassFilter {
+    int16_t* buffer;
+    uint16_t bufferSize;
+    uint16_t writePos;
+
+    void init(int16_t* buf, uint16_t size) {
+        buffer = buf;
+        bufferSize = size;
+        writePos = 0;
+    }
+
+    int16_t process(int16_t input) {
+        int16_t bufout = buffer[writePos];
+        // オールパス: output = -input + bufout + input * 0.5（どちらも int16 で飽和）
+        int16_t output = addSat16(bufout, -input + (input >> 1));
+        buffer[writePos] = addSat16(input, bufout >> 1);
+        writePos = (writePos + 1) % bufferSize;
+        return output;
+    }
+
+    // ブロック処理（process() とビット一致、io をその場で書き換える）
+    void processBlock(int16_t* io, int n) {
+        int pos = writePos;
+        while (n > 0) {
+            int run = (n < (int)bufferSize - pos) ? n : (int)bufferSize - pos;
+            int16_t* p = buffer + pos;
+            for (int i = 0; i < run; i++) {
+                int16_t input = io[i];
+                int16_t bufout = p[i];
+                io[i] = addSat16(bufout, -input + (input >> 1));
+                p[i] = addSat16(input, bufout >> 1);
+            }
+            io += run;
+            n -= run;
+            pos += run;
+            if (pos == bufferSize) pos = 0;
+        }
+        writePos = pos;
+    }
+};
+
+// ルームサイズ (0-32767) → コムのフィードバックとダンピング（Freeverb と FDN のダンピングで共用）
+//   フィードバック: 0.70 → 0.95
+//   ダンピング: 0.80 → 0.20（小さいルームほど高域減衰大）
+inline void reverbRoomCoefs(int16_t roomSize_q15, int16_t& feedback_q15, int16_t& damping_q15) {
+    feedback_q15 = 22937 + ((int32_t)roomSize_q15 * 8192 >> 15);
+    damping_q15 = 26214 - ((int32_t)roomSize_q15 * 19661 >> 15);
+}
+
+// リバーブエンジン（Freeverb: 4コム並列 → 2オールパス直列、L/R 独立）
+struct Reverb {
+    CombFilter combL[4];
+    CombFilter combR[4];
+    AllpassFilter apL[2];
+    AllpassFilter apR[2];
+    int16_t feedback_q15;  // setParams() の値（init() で切り直したコムに再適用）
+    int16_t damping_q15;
+
+    // mem にコム（L1-4, R1-4）→ オールパス（L1-2, R1-2）の順に詰める（mem のクリアは呼び出し側）
+    void init(int16_t* mem) {
+        for (int i = 0; i < 4; i++) {
+            combL[i].init(mem, REVERB_COMB_LENGTHS[i]);
+            mem += REVERB_COMB_LENGTHS[i];
+        }
+        for (int i = 0; i < 4; i++) {
+            combR[i].init(mem, REVERB_COMB_LENGTHS[4 + i]);
+            mem += REVERB_COMB_LENGTHS[4 + i];
+        }
+        for (int i = 0; i < 2; i++) {
+            apL[i].init(mem, REVERB_AP_LENGTHS[i]);
+            mem += REVERB_AP_LENGTHS[i];
+        }
+        for (int i = 0; i < 2; i++) {
+            apR[i].init(mem, REVERB_AP_LENGTHS[2 + i]);
+            mem += REVERB_AP_LENGTHS[2 + i];
+        }
+        setParams(feedback_q15, damping_q15);
+    }
+
+    void setParams(int16_t fb_q15, int16_t damp_q15) {
+        feedback_q15 = fb_q15;
+        damping_q15 = damp_q15;
+        for (int i = 0; i < 4; i++) {
+            combL[i].feedback_q15 = fb_q15;
+            combL[i].damping_q15 = damp_q15;
+            combR[i].feedback_q15 = fb_q15;
+            combR[i].damping_q15 = damp_q15;
+        }
+    }
+
+    // サンプル単位の参照実装（ブロック版のビット一致確認とサイクル比較用）
+    void process(int16_t inL, int16_t inR, int16_t& outL, int16_t& outR) {
+        // 1. コムフィルタ処理（並列）
+        int32_t combOutL = 0;
+        int32_t combOutR = 0;
+        for (int i = 0; i < 4; i++) {
+            combOutL += combL[i].process(inL);
+            combOutR += combR[i].process(inR);
+        }
+
+        // 4で割る（4つのコムフィルタの平均）
+        int16_t apOutL = (int16_t)(combOutL >> 2);
+        int16_t apOutR = (int16_t)(combOutR >> 2);
+
+        // 2. オールパス処理（直列）
+        apOutL = apL[0].process(apOutL);
+        apOutL = apL[1].process(apOutL);
+        apOutR = apR[0].process(apOutR);
+        apOutR = apR[1].process(apOutR);
+
+        outL = apOutL;
+        outR = apOutR;
+    }
+
+    // ブロック処理（process() とビット一致）。n ≤ MAX_N
+    template <int MAX_N>
+    void processBlock(const int16_t* inL, const int16_t* inR, int16_t* outL, int16_t* outR, int n) {
+        // 1. コムフィルタ処理（並列）: フィルタごとにブロック全体を回して加算
+        int32_t combOutL[MAX_N];
+        int32_t combOutR[MAX_N];
+        memset(combOutL, 0, n * sizeof(int32_t));
+        memset(combOutR, 0, n * sizeof(int32_t));
+        for (int i = 0; i < 4; i++) {
+            combL[i].processBlock(inL, combOutL, n);
+            combR[i].processBlock(inR, combOutR, n);
+        }
+
+        // 4で割る（4つのコムフィルタの平均）
+        for (int i = 0; i < n; i++) {
+            outL[i] = (int16_t)(combOutL[i] >> 2);
+            outR[i] = (int16_t)(combOutR[i] >> 2);
+        }
+
+        // 2. オールパス処理（直列）
+        apL[0].processBlock(outL, n);
+        apL[1].processBlock(outL, n);
+        apR[0].processBlock(outR, n);
+        apR[1].processBlock(outR, n);
+    }
+};
+
+// FDN リバーブ: N本のディレイを Hadamard 行列で混ぜて戻す。行列が直交なのでライン毎のゲイン
+// （ライン長から求めた減衰）だけで残響時間が決まり、コムの並列より短いメモリで密な残響になる。
+// タップ位置は LFO でゆっくり揺らして（ブロック単位、線形補間）金属的な共振を崩す
+struct FdnLine {
+    int16_t* buffer;
+    uint16_t size;
+    uint16_t writePos;
+    int16_t lpState;     // ダンピング（1次ローパス）
+};
+
+struct FdnReverb {
+    FdnLine line[FDN_MAX_LINES];
+    uint8_t lines;       // 4 or 8
+    int16_t damping_q15;
+    // 減衰ゲイン×√N（Hadamard の 1/N 正規化と合わせて 1/√N になる）。[0] = 4ライン, [1] = 8ライン
+    // ライン長は予算から決まるので両構成ぶんを先に用意しておく（本体では updateReverbParams()）
+    int16_t gain_q13[2][FDN_MAX_LINES];
+    uint32_t lfo_phase;
+
+    // n 本構成の i 本目の長さ: mem を予算いっぱいまで比例配分する（奇数長に揃える）
+    static uint16_t lineLength(int budget, int n, int i) {
+        const int step = FDN_MAX_LINES / n;
+        uint32_t base_sum = 0;
+        for (int k = 0; k < n; k++) base_sum += FDN_BASE_LENGTHS[k * step];
+        const uint32_t avail = budget - FDN_MAX_LINES;  // |1 で伸びる分
+        return (uint16_t)(((uint32_t)FDN_BASE_LENGTHS[i * step] * avail / base_sum) | 1);
+    }
+
+    // ラインの切り分けと状態のクリア（係数はそのまま）
+    void init(int16_t* mem, int budget, int n) {
+        lines = n;
+        for (int i = 0; i < n; i++) {
+            FdnLine& l = line[i];
+            l.buffer = mem;
+            l.size = lineLength(budget, n, i);
+            l.writePos = 0;
+            l.lpState = 0;
+            mem += l.size;
+        }
+        lfo_phase = 0;
+    }
+
+    template <int N>
+    void processBlock(const int16_t* inL, const int16_t* inR, int16_t* outL, int16_t* outR, int n) {
+        constexpr int OUT_SHIFT = (N == 8) ? 2 : 1;  // N/2 本の和を平均
+        const int32_t damp = damping_q15;
+        const int32_t damp_inv = 32767 - damping_q15;
+        int16_t* buf[N];
+        int size[N], w[N], dInt[N];
+        int32_t frac[N], lp[N];
+        const int16_t* gain = gain_q13[N == 8 ? 1 : 0];
+        for (int i = 0; i < N; i++) {
+            // 三角波 LFO（ライン毎に位相をずらす）: 遅延 = size-2-深さ .. size-2（補間で1つ古い側も読む）
+            uint32_t ph = lfo_phase + (uint32_t)i * (0xFFFFFFFFu / N);
+            uint32_t tri = (ph & 0x80000000u) ? ~ph : ph;
+            uint32_t delay_q16 = ((uint32_t)(line[i].size - 2 - FDN_MOD_DEPTH) << 16) + (tri >> 15) * FDN_MOD_DEPTH;
+            buf[i] = line[i].buffer;
+            size[i] = line[i].size;
+            w[i] = line[i].writePos;
+            dInt[i] = delay_q16 >> 16;
+            frac[i] = (delay_q16 & 0xFFFF) >> 1;
+            lp[i] = line[i].lpState;
+        }
+        lfo_phase += FDN_LFO_INC * (uint32_t)n;
+
+        for (int s = 0; s < n; s++) {
+            int32_t x[N];
+            for (int i = 0; i < N; i++) {
+                int r = w[i] - dInt[i];
+                if (r < 0) r += size[i];
+                int r1 = (r == 0) ? size[i] - 1 : r - 1;
+                int32_t a = buf[i][r];
+                int32_t tap = lerpQ15(a, buf[i][r1], frac[i]);
+                // 帰還路の丸めは 0 方向（割り算。>> の負方向への偏りだと直流のリミットサイクルが残る）
+                lp[i] = (int16_t)((lp[i] * damp_inv + tap * damp) / 32768);
+                x[i] = lp[i];
+            }
+            // 出力: 偶数ラインを L、奇数ラインを R に
+            int32_t accL = 0, accR = 0;
+            for (int i = 0; i < N; i += 2) {
+                accL += x[i];
+                accR += x[i + 1];
+            }
+            outL[s] = (int16_t)sat16(accL >> OUT_SHIFT);
+            outR[s] = (int16_t)sat16(accR >> OUT_SHIFT);
+            // 高速 Walsh-Hadamard 変換（加減算のみ、N log N）
+            for (int h = 1; h < N; h <<= 1) {
+                for (int i = 0; i < N; i += 2 * h) {
+                    for (int j = i; j < i + h; j++) {
+                        int32_t a = x[j], b = x[j + h];
+                        x[j] = a + b;
+                        x[j + h] = a - b;
+                    }
+                }
+            }
+            // 書き戻し: 入力（L→偶数, R→奇数）+ 混合結果×ゲイン
+            for (int i = 0; i < N; i++) {
+                int32_t v = ((i & 1) ? inR[s] : inL[s]) + (((x[i] / N) * gain[i]) / 8192);
+                buf[i][w[i]] = (int16_t)sat16(v);
+                if (++w[i] == size[i]) w[i] = 0;
+            }
+        }
+
+        for (int i = 0; i < N; i++) {
+            line[i].writePos = (uint16_t)w[i];
+            line[i].lpState = (int16_t)lp[i];
+        }
+    }
+};
+
+#endif // REVERB_H
@@ -20,6 +20,13 @@
 #include "freertos/task.h"
 #include <math.h>
 #include <TFT_eSPI.h>
+#include "performance.h"
+#include "dsp_math.h"
+#include "lut_gen.h"
+#include "grain_math.h"
+#include "reverb.h"
+#include "grain_codec.h"
+#include "deja_vu.h"
 
 // ================================================================= //
 // SECTION: Pin Definitions
@@ -47,6 +54,7 @@ constexpr int BPM_LED_PIN = 2;
 // ================================================================= //
 constexpr unsigned long ADC_UPDATE_INTERVAL_MS = 55;
 constexpr unsigned long DISPLAY_UPDATE_INTERVAL_MS = 16;  // 60fps (was 33ms/30fps)
+constexpr unsigned long FRAME_SCHED_EVAL_INTERVAL_MS = 500;  // フレームレート再評価の周期
 constexpr unsigned long BUTTON_LONG_PRESS_MS = 800;
 constexpr unsigned long BUTTON_DEBOUNCE_MS = 15;
 constexpr unsigned long RANDOMIZE_FLASH_DURATION_MS = 200;
@@ -54,17 +62,31 @@ constexpr unsigned long TAP_TEMPO_TIMEOUT_US = 2000000;
 constexpr unsigned long BPM_LED_PULSE_DURATION_MS = 20;
 // ← この値を短くする（例: 20ミリ秒）
 
+// Display task (Core 0, below the BT stack and the audio task)
+constexpr int DISPLAY_TASK_STACK_SIZE = 6144;
+constexpr UBaseType_t DISPLAY_TASK_PRIORITY = 1;
+#ifdef DSP_PIPELINE_ENABLED
+// パイプライン（前段 = グレイン: コア1、後段 = リバーブ・出力: コア0）
+constexpr int PIPELINE_DEPTH = 2;                // ダブルバッファ（前段が次を作る間に後段が1つ前を処理）
+constexpr int OUTPUT_TASK_STACK_SIZE = 6144;
+constexpr UBaseType_t OUTPUT_TASK_PRIORITY = 3;  // 表示タスク・loop() より上、BTスタックより下
+constexpr uint8_t PIPELINE_CORE0_HIGH_PCT = 75;  // 後段を除いたコア0負荷がこれを超えたらシングルコアへ
+constexpr uint8_t PIPELINE_CORE0_LOW_PCT = 55;   // これを下回ったらパイプラインに戻す
+#endif
+// Load-adaptive visualizer frame rate (hysteresis between HIGH/LOW thresholds)
+constexpr uint8_t CORE0_LOAD_HIGH_PCT = 85;      // これを超えたらビジュアライザを間引く
+constexpr uint8_t CORE0_LOAD_LOW_PCT = 65;       // これを下回ったら元に戻す
+constexpr uint8_t AUDIO_HEADROOM_LOW_PCT = 25;   // オーディオ締切までの余裕がこれ未満で間引く
+constexpr uint8_t AUDIO_HEADROOM_OK_PCT = 45;    // 余裕がこれ以上なら元に戻す
+constexpr uint8_t VIZ_DIVIDER_MAX = 4;           // 最低 60/4 = 15fps
+
 // ================================================================= //
 // SECTION: ADC & Parameter Constants
 // ================================================================= //
 constexpr float ADC_MAX_VALUE = 4095.0f;
 constexpr int ADC_CHANGE_THRESHOLD = 40;
 constexpr int ADC_SMOOTHING_SAMPLES = 32;
-constexpr float PITCH_RANGE_SEMITONES = 48.0f;
-constexpr float PITCH_CHANGE_THRESHOLD = 0.05f;
-// ★★★ 変更点：ピッチ計算の割り算を事前に計算しておくための定数 ★★★
-constexpr float PITCH_RANGE_SEMITONES_HALF = PITCH_RANGE_SEMITONES / 2.0f;
-constexpr float PITCH_LUT_SCALE = (float)(257 - 1) / PITCH_RANGE_SEMITONES; // PITCH_LUT_SIZE is 257
+// ピッチ範囲・Q8.8表現・トリガー経路の乗数は grain_math.h
 
 // Pitch randomization range
 constexpr float PITCH_RANDOM_MIN = -20.0f;
@@ -73,8 +95,6 @@ constexpr float PITCH_RANDOM_RANGE = PITCH_RANDOM_MAX - PITCH_RANDOM_MIN; // 27.
 
 // Grain calculation constants
 constexpr float POSITION_TEXTURE_SCALE = 0.6f;  // 3/5 ratio for position randomization
-constexpr float PITCH_TEXTURE_VARIANCE = 0.2f;   // Pitch variation from texture
-constexpr float STEREO_SPREAD_SCALE = 0.5f;      // Stereo spread scaling factor
 constexpr int16_t MIN_SIZE_Q15 = 3277;           // Minimum grain size in Q15 (~10% of range)
 
 // Soft takeover parameters
@@ -94,10 +114,92 @@ constexpr int16_t PAN_CENTER_Q15 = 23170;  // ~0.707 in Q15 format for center pa
 // ================================================================= //
 // SECTION: Audio Engine Constants
 // ================================================================= //
+#if defined(GRAIN_STEREO_ENABLED) && defined(GRAIN_MIPMAP_ENABLED)
+#error "GRAIN_STEREO_ENABLED and GRAIN_MIPMAP_ENABLED cannot be combined (mip levels are mono)"
+#endif
+#if defined(GRAIN_COMPRESSED_ENABLED) && (defined(GRAIN_STEREO_ENABLED) || defined(GRAIN_MIPMAP_ENABLED))
+#error "GRAIN_COMPRESSED_ENABLED is mono-only and cannot be combined with GRAIN_STEREO_ENABLED or GRAIN_MIPMAP_ENABLED"
+#endif
+#if defined(GRAIN_TIERED_ENABLED) && (defined(GRAIN_STEREO_ENABLED) || defined(GRAIN_MIPMAP_ENABLED) || defined(GRAIN_COMPRESSED_ENABLED))
+#error "GRAIN_TIERED_ENABLED cannot be combined with GRAIN_STEREO_ENABLED, GRAIN_MIPMAP_ENABLED or GRAIN_COMPRESSED_ENABLED"
+#endif
+#if defined(GRAIN_COMPRESSED_ENABLED) || defined(GRAIN_TIERED_ENABLED)
+#define GRAIN_ULAW_ENABLED 1  // μ-law のエンコーダ・デコード表を使う
+#endif
+// グラニュラーレイヤー数（取り込みバッファを共有する独立したエンジン）。-DGRAIN_LAYERS=2..4 で増やす
+#ifndef GRAIN_LAYERS
+#define GRAIN_LAYERS 1
+#endif
+#if GRAIN_LAYERS < 1 || GRAIN_LAYERS > 4
+#error "GRAIN_LAYERS must be 1..4"
+#endif
+#if GRAIN_LAYERS > 1 && defined(DSP_PIPELINE_ENABLED)
+#error "GRAIN_LAYERS > 1 cannot be combined with DSP_PIPELINE_ENABLED (both run DSP on core 0)"
+#endif
+#if GRAIN_LAYERS > 1
+// 偶数番のレイヤーはオーディオタスク（コア1）、奇数番はレイヤータスク（コア0）が同じブロックを並列に処理する
+constexpr int LAYER_TASK_STACK_SIZE = 6144;
+constexpr UBaseType_t LAYER_TASK_PRIORITY = 3;  // 表示タスク・loop() より上、BTスタックより下
+#endif
+#ifdef GRAIN_STEREO_ENABLED
+// ステレオ: 入力リング・グレインバッファとも L/R を1フレーム(32bit)に詰めて持つ
+constexpr int GRAIN_CHANNELS = 2;
+constexpr int GRAIN_FRAME_BYTES = 4;
+constexpr int RING_BUFFER_SIZE = 2048;  // フレーム数（8KB、モノラル4096サンプルと同じ容量）
+#else
+constexpr int GRAIN_CHANNELS = 1;
+#ifdef GRAIN_COMPRESSED_ENABLED
+// 圧縮履歴: 8bit μ-law（1サンプル1バイト、ブロック情報なしでどこからでも1回の表引きで読める）
+// ブロック圧縮（ADPCM + キーフレーム）をボイス間で共有デコードする案は採らず、サンプル単位の表引きにした:
+// グレインは速度・位置がばらばらで同じブロックを読むボイスがほとんどなく、共有デコードの作業領域と
+// キーフレームからの復号遅延が増えるだけ。μ-law なら補間1点 = バイト読み1回 + DRAM の256エントリ表1回で済む
+constexpr int GRAIN_FRAME_BYTES = 1;
+#else
+constexpr int GRAIN_FRAME_BYTES = 2;
+#endif
 constexpr int RING_BUFFER_SIZE = 4096;
+#endif
+// 履歴長（1チャンネルあたりのサンプル数、2の累乗）。-DGRAIN_BUFFER_SIZE=... で上書きできる
+#ifndef GRAIN_BUFFER_SIZE
+#if defined(GRAIN_MIPMAP_ENABLED)
+// ミップ段（1/2・1/4）を合わせて 128+64+32 = 224KB に収めるため原音段は半分の長さ
+#define GRAIN_BUFFER_SIZE 65536   // 128KB + mip 96KB in internal SRAM
+#elif defined(GRAIN_STEREO_ENABLED)
+#define GRAIN_BUFFER_SIZE 65536   // 65536フレーム × 4B = 256KB（~1.5秒）
+#elif defined(GRAIN_COMPRESSED_ENABLED)
+#define GRAIN_BUFFER_SIZE 262144  // 262144 × 1B = 256KB（~5.9秒）
+#elif defined(GRAIN_TIERED_ENABLED)
+#define GRAIN_BUFFER_SIZE 524288  // 届く履歴の長さ（~11.9秒、アーカイブ段が全体を持つ）
+#else
 #define GRAIN_BUFFER_SIZE 131072  // 256KB buffer in internal SRAM (tight!)
-#define MAX_GRAIN_SIZE    131072  // Max ~3 seconds at 44.1kHz
+#endif
+#endif
 #define GRAIN_BUFFER_MASK (GRAIN_BUFFER_SIZE - 1)
+static_assert((GRAIN_BUFFER_SIZE & GRAIN_BUFFER_MASK) == 0, "GRAIN_BUFFER_SIZE must be a power of two");
+#ifdef GRAIN_TIERED_ENABLED
+// 2段の履歴: 直近は原音（int16）のリング、全体は 1/4 レートの μ-law アーカイブ。
+// 位置はどちらも履歴全体の座標（GRAIN_BUFFER_MASK）で持ち、段ごとにマスク・シフトして読む
+#ifndef GRAIN_RECENT_SIZE
+#define GRAIN_RECENT_SIZE 65536   // 128KB（~1.5秒）
+#endif
+#define GRAIN_RECENT_MASK (GRAIN_RECENT_SIZE - 1)
+constexpr int GRAIN_ARCHIVE_SHIFT = 2;  // 1/4 レート（帯域 ~5.5kHz）
+constexpr uint32_t GRAIN_ARCHIVE_SIZE = GRAIN_BUFFER_SIZE >> GRAIN_ARCHIVE_SHIFT;  // 128KB
+constexpr uint32_t GRAIN_HISTORY_BYTES = GRAIN_RECENT_SIZE * sizeof(int16_t) + GRAIN_ARCHIVE_SIZE;
+static_assert((GRAIN_RECENT_SIZE & GRAIN_RECENT_MASK) == 0 && GRAIN_RECENT_SIZE <= GRAIN_BUFFER_SIZE,
+              "GRAIN_RECENT_SIZE must be a power of two no larger than GRAIN_BUFFER_SIZE");
+#define MAX_GRAIN_SIZE    131072  // Max ~3 seconds（モノラル既定と同じ。位置で11.9秒まで遡れる）
+#else
+constexpr uint32_t GRAIN_HISTORY_BYTES = (uint32_t)GRAIN_BUFFER_SIZE * GRAIN_FRAME_BYTES;
+#define MAX_GRAIN_SIZE    GRAIN_BUFFER_SIZE  // Max = 履歴全体（モノラル既定で ~3秒）
+#endif
+static_assert(GRAIN_HISTORY_BYTES <= 262144u, "grain history exceeds the 256KB internal SRAM budget");
+#ifdef GRAIN_MIPMAP_ENABLED
+// 速い再生はハーフバンドで帯域制限した 1/2・1/4 レートの段から読む（上方向ピッチのエイリアス対策）
+constexpr int GRAIN_MIP_LEVELS = 3;
+constexpr int32_t GRAIN_MIP_SPEED_L1_Q16 = 98304;   // 1.5倍以上は1/2段
+constexpr int32_t GRAIN_MIP_SPEED_L2_Q16 = 196608;  // 3倍以上は1/4段
+#endif
 constexpr int MAX_GRAINS = 10;  // Increased from 6 for richer visuals
 constexpr int MIN_GRAIN_SIZE = 512;  // Min ~11.6ms (was 128)
 constexpr int FEEDBACK_BUFFER_SIZE = 512;
@@ -118,7 +220,50 @@ constexpr int16_t GRAIN_GAIN_SCALE_Q15[MAX_GRAINS + 1] = {
     10362   // 10 grains ≈ 0.316x (1/√10)
 };
 constexpr int I2S_BUFFER_SAMPLES = 128;
-constexpr int DEJA_VU_BUFFER_SIZE = 16;
+// オーディオ処理ブロック（グレインはこの単位でまとめてレンダリング）
+// フィードバック経路は FEEDBACK_BUFFER_SIZE サンプル遅れで読むので、それ以下なら1ブロック内で循環しない
+// -DAUDIO_BLOCK_SAMPLES=16/32/64 で変更できる（パイプライン時の追加遅延はこの1ブロック分）
+#ifndef AUDIO_BLOCK_SAMPLES
+#define AUDIO_BLOCK_SAMPLES 32
+#endif
+constexpr int AUDIO_BLOCK_SIZE = AUDIO_BLOCK_SAMPLES;
+static_assert(AUDIO_BLOCK_SIZE <= FEEDBACK_BUFFER_SIZE, "feedback delay must cover one audio block");
+static_assert(I2S_BUFFER_SAMPLES % AUDIO_BLOCK_SIZE == 0, "I2S block must be a multiple of the audio block");
+constexpr uint8_t INTERP_HERMITE_MAX_VOICES = 6;  // INTERP_AUTO: この発音数まではHermite、超えたらリニア
+// 密度駆動クラウド（POT4 = DENS）
+constexpr int CLOUD_HEAP_SIZE = 16;          // 予約済みオンセットの最大数
+constexpr uint32_t CLOUD_MIN_RATE_HZ = 2;
+constexpr uint32_t CLOUD_MAX_RATE_HZ = 400;  // 周期110サンプル > 1ブロック → 1ブロックに積む格子点は高々1つ
+constexpr int16_t CLOUD_OFF_Q15 = 328;       // これ未満はクラウド停止（クロック駆動のみ、約1%）
+// クラウドのグレイン長の上限 = ボイス数 × 周期 × 3/4。SIZE の最短（~0.3秒）のままだと
+// MAX_GRAINS 個が埋まって毎秒30個ほどで頭打ちになるので、密度が上がるほど短くする
+// （3/4 はジッタで発音が寄っても空きボイスが残るように）
+constexpr uint32_t CLOUD_VOICE_FILL_Q8 = 192;
+constexpr unsigned long CLOUD_RATE_WINDOW_MS = 500;  // 画面の達成レートの集計間隔
+static_assert(44100 / CLOUD_MAX_RATE_HZ > AUDIO_BLOCK_SIZE, "cloud grid must be coarser than one block");
+// リバーブのディレイメモリ（Freeverb と FDN が同じ領域を切り分けて使う、サンプル数）
+// FDN の各ラインはこの予算に合わせて伸縮する。Freeverb の配置より小さくはできない
+#ifndef REVERB_MEM_SAMPLES
+#define REVERB_MEM_SAMPLES 12587  // Freeverb配置ちょうど（約24.6KB）
+#endif
+// Freeverb のライン長・FDN の基準長は reverb.h
+static_assert(REVERB_MEM_SAMPLES >= REVERB_FREEVERB_SAMPLES, "reverb memory must hold the Freeverb layout");
+// 無音の段を飛ばす（|x| がこれ以下 ≈ -84dBFS を無音とみなす）
+constexpr int32_t SILENCE_THRESHOLD = 2;
+// リバーブは入出力ともに無音がこれだけ続いたら止める（どのエンジンでも最長ラインより長い）
+constexpr uint32_t REVERB_TAIL_HOLD_SAMPLES = REVERB_MEM_SAMPLES / 2;
+// 停止中のブロックごとにクリアするディレイメモリ（既定の約24.6KBを13ブロック ≈ 10ms で）
+constexpr uint32_t REVERB_CLEAR_CHUNK_SAMPLES = 1024;
+// マスターのルックアヘッド・リミッター: ゲインは LIMITER_SEGMENT サンプルごとに計算し、
+// 先読み (W+1) 区間の最大値 → リリース → W 区間の平均で滑らかにする（区間内は直線補間）
+constexpr int LIMITER_SEGMENT = 8;
+constexpr int LIMITER_SMOOTH_SEGMENTS = 3;   // W
+constexpr int LIMITER_LOOKAHEAD = (LIMITER_SMOOTH_SEGMENTS + 1) * LIMITER_SEGMENT;  // 32サンプル ≈ 0.73ms
+constexpr int32_t LIMITER_CEILING = 32112;   // ≈ -0.18dBFS
+constexpr int32_t LIMITER_RELEASE_Q16 = 149; // 区間ごとに残りの 149/65536 だけ戻す（時定数 ≈ 80ms）
+static_assert(LIMITER_LOOKAHEAD * 1000 <= 44100, "limiter look-ahead must stay within 1 ms");
+static_assert((LIMITER_LOOKAHEAD & (LIMITER_LOOKAHEAD - 1)) == 0, "limiter delay is a power-of-two ring");
+// DEJA_VU_BUFFER_SIZE は deja_vu.h
 // ================================================================= //
 // SECTION: UI Constants
 // ================================================================= //
@@ -138,6 +283,18 @@ constexpr int UI_TRIGGER_LED_X = 310;
 constexpr int UI_TRIGGER_LED_Y = 10;
 constexpr int UI_TRIGGER_LED_RADIUS = 4;
 constexpr unsigned long UI_TRIGGER_LED_DURATION_MS = 50;
+// Widget layer
+constexpr int UI_CHAR_W = 6;                 // GLCDフォント（textSize 1）
+constexpr int UI_CHAR_H = 8;
+constexpr int UI_TEXT_MAX_CHARS = 14;
+constexpr int UI_BIPOLAR_HALF_WIDTH = UI_BAR_WIDTH / 2 - 2;  // 中央線と枠を除いた片側の塗り幅
+constexpr uint32_t UI_SPI_BYTE_BUDGET = 4096;        // 1フレームあたりのパネル転送上限（40MHzで約0.8ms）
+constexpr uint32_t UI_SPI_RECT_OVERHEAD_BYTES = 11;  // CASET/RASET/RAMWR のコマンド+引数
+// Flash banner (RANDOM! / SNAPSHOT SAVED!)
+constexpr int UI_FLASH_X = 40;
+constexpr int UI_FLASH_Y = 80;
+constexpr int UI_FLASH_W = 240;
+constexpr int UI_FLASH_H = 80;
 
 // Particle Visualizer Constants
 constexpr int VIZ_AREA_Y_START = 95;   // BPM/Grain display: below parameter area
@@ -148,23 +305,86 @@ constexpr int VIZ_BUFFER_BAR_AREA_Y = VIZ_PARTICLE_Y_START + VIZ_PARTICLE_HEIGHT
 constexpr int VIZ_BUFFER_BAR_HEIGHT = 6;  // Half height (was 12)
 constexpr int VIZ_BUFFER_BAR_WIDTH = 320;  // Full width (restored)
 constexpr int VIZ_BUFFER_BAR_X_OFFSET = 0;  // Left aligned
+constexpr int VIZ_BUFFER_BAR_Y = VIZ_BUFFER_BAR_AREA_Y + 8;  // Segments (below scale labels)
+constexpr int VIZ_BUFFER_SEGMENT_COUNT = 32;  // Battery-style segments
+constexpr int VIZ_BUFFER_SEGMENT_WIDTH = 9;
+constexpr int VIZ_BUFFER_SEGMENT_TOTAL_WIDTH = VIZ_BUFFER_SEGMENT_WIDTH + 1;  // 1px gap
 constexpr int VIZ_PARTICLE_MAX_SIZE = 20;  // 2.5x larger (was 8)
 constexpr int VIZ_PARTICLE_MIN_SIZE = 5;   // 2.5x larger (was 2)
+// Off-screen particle sprite (4-bit palettized, 320x67 = ~10.5KB)
+constexpr int VIZ_SPRITE_WIDTH = 320;
+constexpr int VIZ_SPRITE_COLOR_DEPTH = 4;
+constexpr int VIZ_DMA_STRIP_LINES = 4;     // 16bpp展開→DMA転送の単位（2本でピンポン、計5KB）
+constexpr int VIZ_ENV_LUT_SIZE = 64;       // パーティクルサイズ用エンベロープLUT
+// Waveform overview (grain buffer min/max per sprite column, ~410 samples/column)
+constexpr int VIZ_WAVE_COLUMNS = VIZ_SPRITE_WIDTH;
+constexpr int VIZ_WAVE_DIRTY_WORDS = (VIZ_WAVE_COLUMNS + 31) / 32;
+// Sprite palette indices
+enum VizPaletteIndex : uint8_t {
+    VIZ_PAL_BG = 0,
+    VIZ_PAL_CYAN = 1,
+    VIZ_PAL_YELLOW = 2,
+    VIZ_PAL_MAGENTA = 3,
+    VIZ_PAL_TRAIL_OFFSET = 3,   // パーティクル色 + 3 = 60%白ブレンドのトレイル色
+    VIZ_PAL_TRAIL_CYAN = 4,
+    VIZ_PAL_TRAIL_YELLOW = 5,
+    VIZ_PAL_TRAIL_MAGENTA = 6,
+    VIZ_PAL_WAVE = 7            // グレインバッファ波形（パーティクルの下に描く）
+};
+// RGB565を60%白とブレンド（旧トレイル描画のfloat計算と同じ結果になる整数版）
+constexpr int vizLighten8(int v) { return v + ((255 - v) * 3) / 5; }
+constexpr uint16_t vizLighten565(uint16_t c) {
+    return (uint16_t)(((vizLighten8(((c >> 11) & 0x1F) * 8) >> 3) << 11) |
+                      ((vizLighten8(((c >> 5) & 0x3F) * 4) >> 2) << 5) |
+                       (vizLighten8((c & 0x1F) * 8) >> 3));
+}
+constexpr uint16_t VIZ_PALETTE[16] = {
+    TFT_WHITE, TFT_CYAN, TFT_YELLOW, TFT_MAGENTA,
+    vizLighten565(TFT_CYAN), vizLighten565(TFT_YELLOW), vizLighten565(TFT_MAGENTA),
+    TFT_LIGHTGREY, TFT_BLACK, TFT_BLACK, TFT_BLACK, TFT_BLACK,
+    TFT_BLACK, TFT_BLACK, TFT_BLACK, TFT_BLACK
+};
 // ================================================================= //
 // SECTION: Look-Up Table (LUT) Sizes
 // ================================================================= //
-constexpr int WINDOW_LUT_SIZE = 128;
-constexpr int PITCH_LUT_SIZE = 257;
-constexpr int PAN_LUT_SIZE = 257;
+constexpr int ENV_LUT_BITS = 9;
+constexpr int ENV_LUT_SIZE = 1 << ENV_LUT_BITS;  // グレイン窓テーブル（+1は補間用ガード）
+// PITCH_LUT_SIZE / PAN_LUT_SIZE は grain_math.h
 constexpr int MIX_LUT_SIZE = 256;
 constexpr int FEEDBACK_LUT_SIZE = 256;
-constexpr int RECIPROCAL_LUT_SIZE = 256;
-constexpr int RANDOM_PAN_LUT_SIZE = 128;
-constexpr int RANDOM_LUT_SIZE = 256;
+constexpr int SINC_PHASE_BITS = 7;
+constexpr int SINC_PHASES = 1 << SINC_PHASE_BITS;  // ポリフェーズsincの位相数（小数部の上位7bit）
+constexpr int SINC_TAPS = 4;                       // x[-1], x[0], x[1], x[2]
 // ================================================================= //
 // SECTION: Type Definitions & Enums
 // ================================================================= //
-enum PlayMode : uint8_t { MODE_GRANULAR = 0, MODE_REVERSE = 1 };
+enum PlayMode : uint8_t { MODE_GRANULAR = 0, MODE_REVERSE = 1, MODE_RANDOM_DIR = 2, PLAY_MODE_COUNT = 3 };
+// グレイン窓の形状
+enum EnvShape : uint8_t {
+    ENV_HANN2 = 0,       // Hann²（従来の窓）
+    ENV_TUKEY = 1,       // 両端1/8がcosテーパー、中央は平坦
+    ENV_TRAPEZOID = 2,   // 両端1/8が直線ランプ、中央は平坦
+    ENV_EXP_DECAY = 3,   // 短いアタック → -60dBまで指数減衰
+    ENV_SHAPE_COUNT = 4
+};
+// グレインの補間方式（エンジン単位で選択。AUTO は発音数に応じてHermite/リニアを切り替える）
+enum InterpMode : uint8_t {
+    INTERP_LINEAR = 0,
+    INTERP_HERMITE = 1,   // 4点3次Hermite
+    INTERP_SINC = 2,      // 4タップ・ポリフェーズ窓付きsinc
+    INTERP_AUTO = 3,
+    INTERP_KERNEL_COUNT = 3
+};
+// リバーブエンジン（POT4ボタン長押しで切り替え。ディレイメモリは共用なので切り替え時にクリアする）
+enum ReverbEngine : uint8_t {
+    REVERB_FREEVERB = 0,  // 4コム+2オールパス×ステレオ
+    REVERB_FDN4 = 1,      // 4ライン FDN（長いライン）
+    REVERB_FDN8 = 2,      // 8ライン FDN（高密度）
+    REVERB_ENGINE_COUNT = 3
+};
+#ifdef PROFILE_ENABLED
+static_assert(REVERB_ENGINE_COUNT + 1 == PROFILE_REVERB_SLOTS, "PROFILE_REVERB_SLOTS must cover every engine plus the bypass slot");
+#endif
 enum Pot4Mode : uint8_t {
     MODE_TEXTURE = 0,
     MODE_SPREAD = 1,
@@ -173,7 +393,8 @@ enum Pot4Mode : uint8_t {
     MODE_CLK_RESOLUTION = 4,
     MODE_REVERB_MIX = 5,      // リバーブMIX
     MODE_REVERB_ROOM = 6,     // ルームサイズ
-    POT4_MODE_COUNT = 7
+    MODE_DENSITY = 7,         // クラウド密度（0 = クロック駆動のみ）
+    POT4_MODE_COUNT = 8
 };
 struct FullParamSnapshot {
     int16_t position_q15;
@@ -183,63 +404,144 @@ struct FullParamSnapshot {
     int16_t stereoSpread_q15;
     int16_t feedback_q15;
     int16_t dryWet_q15;
-    float pitch_f;
+    int16_t pitch_q8;         // Q8.8 semitones
     int8_t loop_length;
     PlayMode mode;
     Pot4Mode pot4_mode;
     int resolution_index;
     int16_t reverb_mix_q15;   // リバーブMIX
     int16_t reverb_room_q15;  // ルームサイズ
+    int16_t density_q15;      // クラウド密度
+    uint32_t rng_seed;        // グレイン乱数のシード
+    ParamSnapshot deja_vu[DEJA_VU_BUFFER_SIZE];  // 保存時の Deja Vu ループ（シードと一緒に戻す → 同じつまみ・クロック列なら同じトリガー列）
 };
-struct UIDisplayCache {
-    int16_t position_q15, size_q15, deja_vu_q15, dryWet_q15;
-    float   pitch_f;
-    PlayMode mode;
-    Pot4Mode pot4_mode;
-    Pot4Mode pot4_mode_for_text_update;
-    int16_t texture_q15, stereoSpread_q15, feedback_q15;
-    int8_t loop_length;
-    bool   bt_connected;
-    int    resolution_index;
-    uint8_t active_grains;
-    int16_t reverb_mix_q15;   // リバーブMIX
-    int16_t reverb_room_q15;  // ルームサイズ
-    float   bpm;
+// 差分描画ウィジェット（表示済みの状態を保持し、変化分だけを描く）
+enum UiWidgetKind : uint8_t { UI_WIDGET_BAR = 0, UI_WIDGET_BIPOLAR_BAR = 1, UI_WIDGET_TEXT = 2 };
+struct UiWidget {
+    UiWidgetKind kind;
+    int16_t x, y, w, h;
+    uint16_t fg, bg, border;
+    bool full_redraw;        // 枠・背景を含めて描き直す
+    int16_t fill_px;         // バー: 目標の塗り幅（バイポーラは符号付き）
+    int16_t drawn_fill_px;   // バー: 画面上の塗り幅
+    uint8_t chars;           // テキスト: 桁数（固定幅）
+    char text[UI_TEXT_MAX_CHARS + 1];
+    char drawn_text[UI_TEXT_MAX_CHARS + 1];
+};
+// バーの直後に値表示テキストを置く（uiSetParam が id + 1 を使う）
+enum UiWidgetId : uint8_t {
+    UIW_POS_BAR, UIW_POS_VALUE,
+    UIW_PIT_BAR, UIW_PIT_VALUE,
+    UIW_SIZ_BAR, UIW_SIZ_VALUE,
+    UIW_MIX_BAR, UIW_MIX_VALUE,
+    UIW_DEJA_BAR, UIW_DEJA_VALUE,
+    UIW_RVB_BAR, UIW_RVB_VALUE,
+    UIW_TEX_BAR, UIW_TEX_VALUE,
+    UIW_ROOM_BAR, UIW_ROOM_VALUE,
+    UIW_FBK_BAR, UIW_FBK_VALUE,
+    UIW_SPR_BAR, UIW_SPR_VALUE,
+    UIW_CLK_TEXT, UIW_BT_TEXT, UIW_LOOP_TEXT, UIW_POT4_TEXT,
+    UIW_BPM_TEXT, UIW_GRAIN_TEXT,
+    UIW_LABEL_FIRST,
+    UIW_COUNT = UIW_LABEL_FIRST + 14
+};
+constexpr int UI_LABEL_COUNT = 14;
+// 左列7行 → 右列7行。POT4に割り当てられているパラメータのラベルを強調する
+const char* const UI_LABEL_TEXT[UI_LABEL_COUNT] = {
+    "POS", "SIZ", "DEJA", "TEX", "FBK", "CLK", "LOOP",
+    "PIT", "MIX", "RVB", "ROOM", "SPR", "BT", "POT4"
+};
+constexpr uint8_t UI_LABEL_NO_MODE = 0xFF;
+constexpr uint8_t UI_LABEL_POT4_MODE[UI_LABEL_COUNT] = {
+    UI_LABEL_NO_MODE, UI_LABEL_NO_MODE, UI_LABEL_NO_MODE, MODE_TEXTURE, MODE_FEEDBACK, MODE_CLK_RESOLUTION, MODE_LOOP_LENGTH,
+    UI_LABEL_NO_MODE, UI_LABEL_NO_MODE, MODE_REVERB_MIX, MODE_REVERB_ROOM, MODE_SPREAD, UI_LABEL_NO_MODE, UI_LABEL_NO_MODE
 };
 
+// 1フレーム分の入力。ステレオ時は L/R を32bitに詰める（A2DP の PCM の並びそのままで下位16bitが L。
+// 1回のロードで両チャンネルが読める）。モノラル時は int16 で、frameL/frameR は同じ値を返す
+#ifdef GRAIN_STEREO_ENABLED
+typedef uint32_t AudioFrame;
+inline int16_t frameL(AudioFrame f) { return (int16_t)(f & 0xFFFF); }
+inline int16_t frameR(AudioFrame f) { return (int16_t)(f >> 16); }
+inline AudioFrame packFrame(int32_t l, int32_t r) { return (uint32_t)(uint16_t)l | ((uint32_t)(uint16_t)r << 16); }
+#else
+typedef int16_t AudioFrame;
+inline int16_t frameL(AudioFrame f) { return f; }
+inline int16_t frameR(AudioFrame f) { return f; }
+#endif
+
+// グレインバッファの1要素（ステレオ: AudioFrame、圧縮: μ-law コード、それ以外: int16）
+#if defined(GRAIN_STEREO_ENABLED)
+typedef AudioFrame GrainFrame;
+#elif defined(GRAIN_COMPRESSED_ENABLED)
+typedef uint8_t GrainFrame;
+#else
+typedef int16_t GrainFrame;
+#endif
+
 struct AudioRingBuffer {
-    int16_t data[RING_BUFFER_SIZE];
+    AudioFrame data[RING_BUFFER_SIZE];
     volatile uint16_t writePos = 0, readPos = 0;
     void init() { writePos = 0; readPos = 0; }
-    bool write(int16_t sample) {
+    bool write(AudioFrame sample) {
         uint16_t nextPos = (writePos + 1) & (RING_BUFFER_SIZE - 1);
         if (nextPos == readPos) return false;
         data[writePos] = sample;
         writePos = nextPos;
         return true;
     }
-    bool read(int16_t& sample) {
+    bool read(AudioFrame& sample) {
         if (readPos == writePos) return false;
         sample = data[readPos];
         readPos = (readPos + 1) & (RING_BUFFER_SIZE - 1);
         return true;
     }
 };
+// グレイン生成用の乱数（GrainRng）はホストテストでも使うので deja_vu.h
 struct Grain {
     bool active;
-    uint16_t startPos, length;
-    int32_t position_q16, speed_q16;
-    uint32_t reciprocal_length_q32;
+    uint32_t startPos, length;   // バッファ全長(131072)を扱えるよう32bit
+    int64_t position_q16;        // Q16で65536サンプル超のグレインを表すため64bit
+    int32_t speed_q16;           // 符号付き（負 = 逆再生）。方向はトリガー時に確定する
+    uint32_t env_phase;          // 窓の位相（Q32、1周 = グレイン1つ）
+    uint32_t env_inc;            // 1サンプルあたりの位相増分（トリガー時に1回だけ計算）
+    EnvShape env_shape;
     int16_t panL_q15, panR_q15;
+    uint8_t start_delay;         // ブロック内の発音オフセット（クラウドのサンプル精度オンセット）
+    uint8_t mip_level;           // 読み出す段（0 = 原音、GRAIN_MIPMAP_ENABLED 時のみ 1/2 で1段ずつ）
+    bool archive;                // アーカイブ段から読む（GRAIN_TIERED_ENABLED 時のみ、トリガー時に決める）
     void reset() {
         active = false;
+        start_delay = 0;
+        mip_level = 0;
+        archive = false;
         position_q16 = 0;
         speed_q16 = 1 << 16;
-        reciprocal_length_q32 = 0; panL_q15 = PAN_CENTER_Q15; panR_q15 = PAN_CENTER_Q15;
+        env_phase = 0; env_inc = 0; env_shape = ENV_HANN2;
+        panL_q15 = PAN_CENTER_Q15; panR_q15 = PAN_CENTER_Q15;
+    }
+};
+#if defined(GRAIN_MIPMAP_ENABLED) || defined(GRAIN_TIERED_ENABLED)
+// 7タップ・ハーフバンドFIR (-1, 0, 9, 16, 9, 0, -1)/32 による1/2デシメータ
+// 奇数タップは中央以外0で、係数は全部シフト加算で済む。群遅延3サンプル
+struct HalfBandDecimator {
+    int16_t hist[8];  // 直近の入力（リング、使うのは7タップ）
+    uint8_t head;
+    void init() { memset(hist, 0, sizeof(hist)); head = 0; }
+    inline void push(int16_t x) { head = (head + 1) & 7; hist[head] = x; }
+    // 3サンプル前を中心とする出力
+    inline int16_t output() const {
+        int32_t y = 16 * hist[(head - 3) & 7]
+                  + 9 * (hist[(head - 2) & 7] + hist[(head - 4) & 7])
+                  - (hist[head] + hist[(head - 6) & 7]);
+        y >>= 5;
+        return (int16_t)constrain(y, -32768, 32767);
     }
 };
+#endif
+// μ-law のエンコード・デコード式（encodeGrainSample / decodeGrainSampleRef）はホストテストでも使うので grain_codec.h
 struct GranParams {
-    float pitch_f;
+    int16_t pitch_q8;         // Q8.8 semitones (±24.0 = ±6144)
     PlayMode mode;
     int16_t position_q15;
     int16_t size_q15;
@@ -251,6 +553,199 @@ struct GranParams {
     int8_t loop_length;
     int16_t reverb_mix_q15;   // リバーブMIX (0-32767)
     int16_t reverb_room_q15;  // ルームサイズ (0-32767)
+    InterpMode interp_mode;   // グレイン補間方式
+    EnvShape env_shape;       // グレイン窓の形状（トリガー時にグレインへコピー）
+    int16_t reverse_prob_q15; // MODE_RANDOM_DIR で逆再生になる確率
+    int16_t density_q15;      // クラウド密度（CLOUD_OFF_Q15 未満で停止）
+    ReverbEngine reverb_engine; // 要求されたリバーブエンジン（オーディオタスクがブロック境界で反映）
+};
+
+// 段ごとの活動状態（オーディオタスクだけが触る）。寄与が無音以下と言える段は処理を飛ばす
+struct StageActivity {
+    uint32_t grain_quiet;     // グレインバッファへ無音を書き続けたサンプル数（バッファ長で飽和）
+    uint32_t reverb_quiet;    // リバーブの入出力がともに無音だったサンプル数（保持時間で飽和）
+    uint32_t feedback_zero;   // フィードバック量0が続いたサンプル数
+    uint32_t reverb_cleared;  // 停止中にクリアし終えたディレイメモリ（サンプル）
+    bool reverb_idle;         // リバーブ停止中（停止中にディレイをクリアし、再開時は位置だけ戻して0から立ち上げる）
+    bool feedback_idle;       // フィードバック書き込み停止中（バッファは全部0のまま）
+    void init() {
+        grain_quiet = 0;
+        reverb_quiet = 0;
+        feedback_zero = 0;
+        reverb_cleared = 0;
+        reverb_idle = false;
+        feedback_idle = false;
+    }
+};
+
+// 表示タスクのフレームスケジューラ状態
+struct FrameScheduler {
+    uint8_t  viz_divider;            // ビジュアライザを何フレームに1回描くか（1=60fps, 2=30fps...）
+    uint8_t  frame_counter;
+    uint32_t frame_cost_avg_us;      // フレーム処理時間の移動平均（1/8 IIR）
+    uint16_t frames_in_window;
+    uint16_t viz_frames_in_window;
+    unsigned long window_start_ms;
+    uint16_t fps_x10;                // 達成fps ×10
+    uint16_t viz_fps_x10;
+    void init() {
+        viz_divider = 1;
+        frame_counter = 0;
+        frame_cost_avg_us = 0;
+        frames_in_window = 0;
+        viz_frames_in_window = 0;
+        window_start_ms = millis();
+        fps_x10 = 0;
+        viz_fps_x10 = 0;
+    }
+};
+
+// オーディオタスクの処理時間計測（I2Sブロック締切に対する余裕）
+// i2s_write / vTaskDelay で待っている時間は除外し、実処理時間のみを積算する
+struct AudioDeadlineMeter {
+    int64_t  segment_start_us;
+    uint32_t busy_us;
+    uint32_t total_us;  // 累積（コアごとの負荷用。読み出し側が差分を取る）
+    void resume() { segment_start_us = esp_timer_get_time(); }
+    void pause() {
+        uint32_t d = (uint32_t)(esp_timer_get_time() - segment_start_us);
+        busy_us += d;
+        total_us += d;
+    }
+};
+
+// 起動の各段階の時刻（micros()、電源投入からの経過）。first_* はオーディオ側が一度だけ書き、
+// loop() が最初の出力を見てからまとめて表示する
+struct BootTimeline {
+    uint32_t audio_start_us;            // A2DP シンク + オーディオタスク起動完了
+    uint32_t ui_start_us;               // 画面の枠を描き、表示タスクを起動した
+    uint32_t setup_done_us;
+    volatile uint32_t first_input_us;   // A2DP から最初のサンプルが届いた
+    volatile uint32_t first_output_us;  // 処理済みの最初のブロックを I2S へ書いた
+    bool reported;
+};
+
+// 前段（グレイン）→ 後段（リバーブ・出力）に渡す1ブロック。ドライ/ウェットミックス後の32bitステレオ
+struct StageBlock {
+    int32_t granL32[AUDIO_BLOCK_SIZE], granR32[AUDIO_BLOCK_SIZE];
+    int n;
+    int16_t fb_q15;
+};
+
+#ifdef DSP_PIPELINE_ENABLED
+// 前段（コア1）→ 後段（コア0）のロックフリー単一生産者・単一消費者キュー。
+// head は前段だけ、tail は後段だけが進める（どちらも単調増加、スロットは % PIPELINE_DEPTH）
+struct PipelineQueue {
+    StageBlock slot[PIPELINE_DEPTH];
+    volatile uint32_t head, tail;
+    volatile bool request;  // 表示タスクが決める希望モード（true = パイプライン）
+    bool active;            // 前段が実際に使っているモード（前段だけが書く）
+    uint32_t switches;
+    void init() { head = 0; tail = 0; request = true; active = false; switches = 0; }
+};
+#endif
+
+#if GRAIN_LAYERS > 1
+// コア0のレイヤーへの1ブロック分の依頼（fork-join）。オーディオタスクが seq を進めて起こし、
+// レイヤータスクがレンダリングを終えたら done を追いつかせる（seq - done は常に 0 か 1）
+struct LayerJob {
+    int32_t wetL[AUDIO_BLOCK_SIZE], wetR[AUDIO_BLOCK_SIZE];
+    int n;
+    bool audible;
+    volatile uint32_t seq, done;
+    void init() { n = 0; audible = false; seq = 0; done = 0; }
+};
+#endif
+
+// マスターバスのルックアヘッド・リミッター（ステレオリンク）。入力は32bitのミックス結果。
+// 区間 j のゲインは G(j-1) → G(j) の直線で、G は区間 j を含む窓の最大値からしか作らないので
+// 先読み内のピークは必ず LIMITER_CEILING 以下に収まる。1サンプルの処理は遅延線1回と乗算だけ
+struct PeakLimiter {
+    int32_t delayL[LIMITER_LOOKAHEAD], delayR[LIMITER_LOOKAHEAD];
+    uint8_t pos;
+    int32_t seg_peak;
+    uint8_t seg_count;
+    uint32_t seg_index;
+    // 先読み窓の最大値（単調減少の両端キュー: 後ろから小さいピークを捨て、窓外を前から捨てる）
+    int32_t dq_peak[LIMITER_SMOOTH_SEGMENTS + 1];
+    uint32_t dq_seg[LIMITER_SMOOTH_SEGMENTS + 1];
+    uint8_t dq_head, dq_len;
+    int32_t hold_q16;                         // リリースをかけたゲイン
+    int32_t box_q16[LIMITER_SMOOTH_SEGMENTS];  // 平均用の履歴
+    int32_t box_sum;
+    uint8_t box_pos;
+    int32_t gain_q16, gain_step;
+    int32_t end_q16;                          // 今出している区間の終点ゲイン
+    int32_t min_gain_q16;                     // テレメトリ（読み出し側がリセット）
+
+    void init() {
+        memset(delayL, 0, sizeof(delayL));
+        memset(delayR, 0, sizeof(delayR));
+        pos = 0;
+        seg_peak = 0;
+        seg_count = 0;
+        seg_index = 0;
+        dq_head = 0;
+        dq_len = 0;
+        hold_q16 = 65536;
+        for (int i = 0; i < LIMITER_SMOOTH_SEGMENTS; i++) box_q16[i] = 65536;
+        box_sum = 65536 * LIMITER_SMOOTH_SEGMENTS;
+        box_pos = 0;
+        gain_q16 = 65536;
+        gain_step = 0;
+        end_q16 = 65536;
+        min_gain_q16 = 65536;
+    }
+
+    // 1区間ぶんの入力が揃ったら、これから出る区間のゲインの終点を決める
+    void pushSegment(int32_t peak) {
+        constexpr int DQ_MASK = LIMITER_SMOOTH_SEGMENTS;  // 容量 W+1 = 4
+        static_assert(((LIMITER_SMOOTH_SEGMENTS + 1) & LIMITER_SMOOTH_SEGMENTS) == 0, "deque size must be a power of two");
+        // 窓（直近 W+1 区間）から外れるものを先に捨ててから積む（容量 W+1 を超えない）
+        while (dq_len > 0 && seg_index - dq_seg[dq_head] > (uint32_t)LIMITER_SMOOTH_SEGMENTS) {
+            dq_head = (dq_head + 1) & DQ_MASK;
+            dq_len--;
+        }
+        while (dq_len > 0 && dq_peak[(dq_head + dq_len - 1) & DQ_MASK] <= peak) dq_len--;
+        dq_peak[(dq_head + dq_len) & DQ_MASK] = peak;
+        dq_seg[(dq_head + dq_len) & DQ_MASK] = seg_index;
+        dq_len++;
+        seg_index++;
+
+        const int32_t window_peak = dq_peak[dq_head];
+        int32_t target_q16 = (window_peak > LIMITER_CEILING)
+            ? (int32_t)(((int64_t)LIMITER_CEILING << 16) / window_peak) : 65536;
+        int32_t released = hold_q16 + mulQ16(65536 - hold_q16, LIMITER_RELEASE_Q16);
+        hold_q16 = min(target_q16, released);
+
+        box_sum += hold_q16 - box_q16[box_pos];
+        box_q16[box_pos] = hold_q16;
+        box_pos = (box_pos + 1 == LIMITER_SMOOTH_SEGMENTS) ? 0 : box_pos + 1;
+
+        // 直線補間の丸め誤差を持ち越さないよう、始点は前の区間の終点に揃える
+        gain_q16 = end_q16;
+        end_q16 = box_sum / LIMITER_SMOOTH_SEGMENTS;
+        gain_step = (end_q16 - gain_q16) / LIMITER_SEGMENT;
+        if (end_q16 < min_gain_q16) min_gain_q16 = end_q16;
+    }
+
+    inline void process(int32_t inL, int32_t inR, int16_t& outL, int16_t& outR) {
+        const int32_t dl = delayL[pos], dr = delayR[pos];
+        delayL[pos] = inL;
+        delayR[pos] = inR;
+        pos = (pos + 1) & (LIMITER_LOOKAHEAD - 1);
+
+        outL = (int16_t)clamp32(mulQ16(dl, gain_q16), -32767, 32767);
+        outR = (int16_t)clamp32(mulQ16(dr, gain_q16), -32767, 32767);
+        gain_q16 += gain_step;
+
+        seg_peak = max(seg_peak, (int32_t)max(abs(inL), abs(inR)));
+        if (++seg_count == LIMITER_SEGMENT) {
+            pushSegment(seg_peak);
+            seg_peak = 0;
+            seg_count = 0;
+        }
+    }
 };
 
 struct ButtonState {
@@ -266,120 +761,217 @@ struct ButtonState {
 // ================================================================= //
 // SECTION: Reverb Engine Structures
 // ================================================================= //
-// コムフィルタ（ディレイ + フィードバック + ローパス）
-struct CombFilter {
-    int16_t* buffer;
-    uint16_t bufferSize;
-    uint16_t writePos;
-    int16_t feedback_q15;
-    int16_t damping_q15;
-    int16_t filterState;  // 1次ローパスフィルタの状態変数
-
-    void init(int16_t* buf, uint16_t size) {
-        buffer = buf;
-        bufferSize = size;
-        writePos = 0;
-        feedback_q15 = 0;
-        damping_q15 = 16384;  // 0.5
-        filterState = 0;
-    }
-
-    int16_t process(int16_t input) {
-        int16_t output = buffer[writePos];
-        // ローパスフィルタ: filterState = filterState * (1-damp) + output * damp
-        filterState = (int16_t)(((int32_t)filterState * (32767 - damping_q15) +
-                                 (int32_t)output * damping_q15) >> 15);
-        // フィードバック: input + filterState * feedback
-        buffer[writePos] = (int16_t)(input + (((int32_t)filterState * feedback_q15) >> 15));
-        writePos = (writePos + 1) % bufferSize;
-        return output;
-    }
-};
+// CombFilter / AllpassFilter / Reverb（Freeverb）/ FdnReverb はホストテストでも使うので reverb.h
 
-// オールパスフィルタ（拡散処理）
-struct AllpassFilter {
-    int16_t* buffer;
-    uint16_t bufferSize;
-    uint16_t writePos;
+// クロック分解能: 1拍あたり num/den 回。間隔 = 拍 × den / num（オーディオタスクで整数だけで求める）
+struct ClockDivision {
+    uint8_t num;
+    uint8_t den;
+};
 
-    void init(int16_t* buf, uint16_t size) {
-        buffer = buf;
-        bufferSize = size;
-        writePos = 0;
+// ParamSnapshot / DejaVuLoop（Deja Vu の1ステップ）は deja_vu.h
+
+// 密度駆動のグレインクラウド。格子点 k×period に ±period/2×TEX のジッタを足した発音時刻を
+// 最小ヒープに積み、各ブロックでそのブロックに入るものをサンプル精度で発音する
+// （ジッタで前後が入れ替わるので到着順のキューでは足りない）
+struct CloudScheduler {
+    uint32_t heap[CLOUD_HEAP_SIZE];  // 発音時刻（サンプルカウンタ、ラップあり）
+    uint8_t count;
+    uint32_t now;                    // 現在ブロック先頭のサンプル時刻
+    uint32_t next_grid;              // まだヒープに積んでいない次の格子点
+    ParamSnapshot center;            // クロックごとに更新される中心パラメータ（Deja Vu の結果）
+    bool center_valid;
+    volatile uint32_t spawned;       // 発音できたグレインの数（表示タスクが差分から達成レートを出す）
+    void init() { count = 0; now = 0; next_grid = 0; center_valid = false; spawned = 0; }
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+    void push(uint32_t t) {
+        if (count >= CLOUD_HEAP_SIZE) return;
+        int i = count++;
+        while (i > 0) {
+            int parent = (i - 1) >> 1;
+            if (!before(t, heap[parent])) break;
+            heap[i] = heap[parent];
+            i = parent;
+        }
+        heap[i] = t;
+    }
+    void pop() {
+        uint32_t t = heap[--count];
+        int i = 0;
+        while (true) {
+            int c = 2 * i + 1;
+            if (c >= count) break;
+            if (c + 1 < count && before(heap[c + 1], heap[c])) c++;
+            if (!before(heap[c], t)) break;
+            heap[i] = heap[c];
+            i = c;
+        }
+        heap[i] = t;
     }
+};
 
-    int16_t process(int16_t input) {
-        int16_t bufout = buffer[writePos];
-        // オールパス: output = -input + bufout + input * 0.5
-        int16_t output = (int16_t)(-input + bufout + (input >> 1));
-        buffer[writePos] = (int16_t)(input + (bufout >> 1));
-        writePos = (writePos + 1) % bufferSize;
-        return output;
+// グラニュラーエンジン1つ分（レイヤー）。取り込みバッファは全レイヤーで共有し、
+// グレイン・乱数・クラウド・Deja Vu・クロックはレイヤーごとに持つ
+struct GranularEngine {
+    Grain grains[MAX_GRAINS];
+    uint8_t activeGrainIndices[MAX_GRAINS];
+    uint8_t activeGrainCount;
+    GrainRng rng;                          // オーディオタスクとレイヤータスクだけが使う（ブロック単位で交互。ボタン等は保留フラグ経由）
+    CloudScheduler cloud;
+    DejaVuLoop deja_vu;
+    GranParams* params;                    // レイヤー0は g_params（つまみ・画面と共有）
+    unsigned long next_trigger_time_us;    // 分解能を適用したクロック（テンポは全レイヤー共通）
+    int resolution_index;
+    // loopTask からの保留要求。乱数・Deja Vu・分解能はオーディオタスクだけが書くので、ボタン・つまみは
+    // ここに置き、granularTask がブロックの先頭で applyLayerRequests() で適用する
+    volatile bool save_pending;            // 今のループを g_snapshots[save_slot] へ写し、save_seed で再シード
+    volatile bool load_pending;            // g_snapshots[load_slot] の乱数・ループ・分解能に戻す
+    volatile bool randomize_pending;       // ループを randomize_seed の乱数で埋め直す
+    volatile int8_t resolution_pending;    // クロック分解能（-1 = 要求なし）
+    volatile uint8_t save_slot, load_slot;
+    volatile uint32_t save_seed, randomize_seed;
+    uint8_t index;
+    uint8_t core;                          // レンダリングするコア
+#ifdef PROFILE_ENABLED
+    LayerPerfCounters perf;                // publishLayerPerf() で g_perf へ移す
+#endif
+    void init(uint8_t layer, GranParams* p) {
+        for (int i = 0; i < MAX_GRAINS; i++) grains[i].reset();
+        activeGrainCount = 0;
+        cloud.init();
+        memset(&deja_vu, 0, sizeof(deja_vu));
+        save_pending = load_pending = randomize_pending = false;
+        resolution_pending = -1;
+        params = p;
+        next_trigger_time_us = 0;
+        resolution_index = 3;
+        index = layer;
+        core = (layer & 1) ? 0 : 1;
+#ifdef PROFILE_ENABLED
+        memset(&perf, 0, sizeof(perf));
+#endif
     }
 };
 
-// リバーブエンジン
-struct Reverb {
-    CombFilter combL[4];
-    CombFilter combR[4];
-    AllpassFilter apL[2];
-    AllpassFilter apR[2];
-};
+// ================================================================= //
+// SECTION: Look-Up Table Generators (compile time)
+// ================================================================= //
+// 各テーブルの i 番目の値。以前 initAllLuts() が起動時に float で計算していたのと同じ式を
+// double で評価する（float の丸めの差で、数点だけ 1LSB 違うことがある）。乱数は使わない
+constexpr double lutHann(double t) { return 0.5 * (1.0 - lutgen::lutCos(2.0 * lutgen::PI_D * t)); }
 
-struct ParamSnapshot {
-    int16_t position_q15;
-    int16_t size_q15;
-    float pitch_f;
-    int16_t texture_q15;
-};
+// グレイン窓（Hann²、指数減衰、Tukeyの立ち上がり）。最後の要素は補間用ガード
+constexpr int32_t envHann2Q15(int i) {
+    return (int32_t)(lutHann((double)i / ENV_LUT_SIZE) * lutHann((double)i / ENV_LUT_SIZE) * 32767.0);
+}
+// 1/64のアタックとリリースでクリックを避け、その間は -60dB まで指数減衰
+constexpr int32_t envExpQ15(int i) {
+    return (int32_t)(lutgen::lutExp(-6.9078 * i / ENV_LUT_SIZE)
+                     * lutgen::lutMin(1.0, 64.0 * i / ENV_LUT_SIZE)
+                     * lutgen::lutMin(1.0, 64.0 * (ENV_LUT_SIZE - i) / ENV_LUT_SIZE) * 32767.0);
+}
+constexpr int32_t envTaperQ15(int i) {
+    return (int32_t)(0.5 * (1.0 - lutgen::lutCos(lutgen::PI_D * i / ENV_LUT_SIZE)) * 32767.0);
+}
+
+// ピッチ（pitchQ16）と等パワーパン（panQ15）はホストテストでも使うので grain_math.h
+
+// ドライ/ウェット（直線）とフィードバック量（0.1〜0.6）
+constexpr int32_t mixQ15(int i) { return (int32_t)((i * 32767L) / (MIX_LUT_SIZE - 1)); }
+constexpr int32_t feedbackQ15(int i) {
+    return (int32_t)((FEEDBACK_LUT_MIN + (double)i / (FEEDBACK_LUT_SIZE - 1) * FEEDBACK_LUT_RANGE) * 32767.0);
+}
+
+// ポリフェーズsinc（4タップ・Hann窓、位相 p のタップは x[-1..2]）。DCゲインが1になるよう正規化し、
+// 丸め誤差は主タップ（位相が前半なら x[0]、後半なら x[1]）に寄せる
+constexpr double sincTapWeight(double x) {
+    return ((x < 1e-6 && x > -1e-6) ? 1.0 : lutgen::lutSin(lutgen::PI_D * x) / (lutgen::PI_D * x))
+           * 0.5 * (1.0 + lutgen::lutCos(lutgen::PI_D * x / 2.0));  // |x| <= 2 のHann窓
+}
+constexpr double sincTap(int p, int k) { return sincTapWeight((double)(k - 1) - (double)p / SINC_PHASES); }
+constexpr int32_t sincResidual(int32_t r0, int32_t r1, int32_t r2, int32_t r3) { return 32767 - (r0 + r1 + r2 + r3); }
+constexpr lutgen::LutTable<int16_t, SINC_TAPS> sincPhaseRounded(int p, int32_t r0, int32_t r1, int32_t r2, int32_t r3) {
+    return lutgen::LutTable<int16_t, SINC_TAPS>{{
+        (int16_t)r0,
+        (int16_t)(r1 + (p < SINC_PHASES / 2 ? sincResidual(r0, r1, r2, r3) : 0)),
+        (int16_t)(r2 + (p < SINC_PHASES / 2 ? 0 : sincResidual(r0, r1, r2, r3))),
+        (int16_t)r3 }};
+}
+constexpr lutgen::LutTable<int16_t, SINC_TAPS> sincPhaseNormalized(int p, double sum) {
+    return sincPhaseRounded(p, lutgen::lutRound(sincTap(p, 0) / sum * 32767.0), lutgen::lutRound(sincTap(p, 1) / sum * 32767.0),
+                               lutgen::lutRound(sincTap(p, 2) / sum * 32767.0), lutgen::lutRound(sincTap(p, 3) / sum * 32767.0));
+}
+constexpr lutgen::LutTable<int16_t, SINC_TAPS> sincPhaseQ15(int p) {
+    return sincPhaseNormalized(p, sincTap(p, 0) + sincTap(p, 1) + sincTap(p, 2) + sincTap(p, 3));
+}
 
 // ================================================================= //
 // SECTION: Global Variables
 // ================================================================= //
 TFT_eSPI tft = TFT_eSPI();
+TFT_eSprite g_vizSprite = TFT_eSprite(&tft);
+bool g_vizSpriteReady = false;
+// スプライト(4bpp)→RGB565展開用: 1バイト(2ピクセル) → バイトスワップ済み2ピクセル
+uint32_t g_viz_pixel_pair_lut[256];
+uint16_t g_viz_dma_buf[2][VIZ_SPRITE_WIDTH * VIZ_DMA_STRIP_LINES] __attribute__((aligned(4)));
+uint8_t g_viz_radius_lut[VIZ_ENV_LUT_SIZE];  // 進行度 → パーティクル半径（Hann窓）
 BluetoothA2DPSink a2dp_sink;
 bool g_inverse_mode = false;
 // Audio Buffers
 AudioRingBuffer g_ringBuffer;
-int16_t g_grainBuffer[GRAIN_BUFFER_SIZE];  // 256KB in internal SRAM (ESP32-WROOM-32)
-volatile uint16_t g_grainWritePos = 0;
-bool g_grainBufferReady = false;
-
-// Reverb Buffers (Freeverb-style, ~24.6KB total)
-// コムフィルタディレイライン（ステレオ4ペア）
-int16_t g_reverbCombL1[1116];
-int16_t g_reverbCombL2[1188];
-int16_t g_reverbCombL3[1277];
-int16_t g_reverbCombL4[1356];
-int16_t g_reverbCombR1[1422];
-int16_t g_reverbCombR2[1491];
-int16_t g_reverbCombR3[1557];
-int16_t g_reverbCombR4[1617];
-// オールパスディレイライン（ステレオ2ペア）
-int16_t g_reverbApL1[225];
-int16_t g_reverbApL2[341];
-int16_t g_reverbApR1[441];
-int16_t g_reverbApR2[556];
+AudioFrame g_feedbackBuffer[FEEDBACK_BUFFER_SIZE];  // 出力 → 取り込みへ FEEDBACK_BUFFER_SIZE サンプル遅れで戻す
+#ifdef GRAIN_TIERED_ENABLED
+GrainFrame g_grainBuffer[GRAIN_RECENT_SIZE];  // 原音段 128KB（直近 ~1.5秒）
+uint8_t g_grainArchive[GRAIN_ARCHIVE_SIZE];   // アーカイブ段 128KB（1/4レート μ-law、履歴全体）
+HalfBandDecimator g_archiveDecim[GRAIN_ARCHIVE_SHIFT];
+#else
+GrainFrame g_grainBuffer[GRAIN_BUFFER_SIZE];  // 256KB in internal SRAM (ESP32-WROOM-32)
+#endif
+volatile uint32_t g_grainWritePos = 0;
+#ifdef GRAIN_MIPMAP_ENABLED
+int16_t g_grainMip1[GRAIN_BUFFER_SIZE / 2];  // 1/2レート（64KB）
+int16_t g_grainMip2[GRAIN_BUFFER_SIZE / 4];  // 1/4レート（32KB）
+int16_t* const g_grainMipBuffers[GRAIN_MIP_LEVELS] = {g_grainBuffer, g_grainMip1, g_grainMip2};
+HalfBandDecimator g_mipDecim[GRAIN_MIP_LEVELS - 1];
+#endif
+volatile uint32_t g_grainHistorySamples = 0;  // 書き込んだ履歴の長さ（GRAIN_BUFFER_SIZE で飽和）
+// Waveform overview: 書き込みと同時にオーディオタスクが更新する列ごとのmin/max
+int16_t g_wave_min[VIZ_WAVE_COLUMNS];
+int16_t g_wave_max[VIZ_WAVE_COLUMNS];
+uint32_t g_wave_dirty[VIZ_WAVE_DIRTY_WORDS];  // 前回描画以降に変化した列（表示タスクが回収）
+
+// Reverb Buffers（Freeverb: コム8本+オールパス4本、FDN: 4/8ライン。アクティブなエンジンが切り分けて使う）
+int16_t g_reverbMem[REVERB_MEM_SAMPLES];
 
 // Reverb Engine
 Reverb g_reverb;
-
-// Grain Management
-Grain g_grains[MAX_GRAINS];
-uint8_t g_activeGrainIndices[MAX_GRAINS];
-uint8_t g_activeGrainCount = 0;
-
-// Look-Up Tables
-int16_t g_window_lut_q15[WINDOW_LUT_SIZE];
-int32_t g_pitch_lut_q16[PITCH_LUT_SIZE];
-int16_t g_pan_lut_q15[PAN_LUT_SIZE];
-int16_t g_mix_lut_q15[MIX_LUT_SIZE];
-int16_t g_feedback_lut_q15[FEEDBACK_LUT_SIZE];
-uint32_t g_reciprocal_lut_q32[RECIPROCAL_LUT_SIZE];
-float g_random_pan_lut[RANDOM_PAN_LUT_SIZE];
-int16_t g_random_lut_q15[RANDOM_LUT_SIZE];
-uint8_t g_random_pan_index = 0;
-uint8_t g_random_index = 0;
+FdnReverb g_fdn;
+ReverbEngine g_reverb_engine_active = REVERB_FREEVERB;  // オーディオタスクが処理中のエンジン
+StageActivity g_stage;
+
+// Grain Management（レイヤー0 = つまみで操作するメインのエンジン）
+GranularEngine g_layers[GRAIN_LAYERS];
+#if GRAIN_LAYERS > 1
+GranParams g_layer_params[GRAIN_LAYERS];  // レイヤー1以降のパラメータ（[0] は未使用、レイヤー0は g_params）
+LayerJob g_layer_job;
+bool g_mode_chord_used = false;           // MODE を押したままスナップショットを押した（MODE 離し時の動作を飛ばす）
+#endif
+
+// Look-Up Tables（すべてコンパイル時に生成、起動時の計算なし）
+// 毎サンプル・毎グレインで読むものは DRAM_ATTR で内部RAM、つまみ操作時にしか読まないものは
+// const のままフラッシュ（.rodata、キャッシュ経由）に置いて DRAM を空ける
+DRAM_ATTR constexpr lutgen::LutTable<int16_t, ENV_LUT_SIZE + 1> g_env_hann2_lut_q15 = lutgen::makeLut<int16_t, ENV_LUT_SIZE + 1>(envHann2Q15);
+DRAM_ATTR constexpr lutgen::LutTable<int16_t, ENV_LUT_SIZE + 1> g_env_exp_lut_q15 = lutgen::makeLut<int16_t, ENV_LUT_SIZE + 1>(envExpQ15);
+DRAM_ATTR constexpr lutgen::LutTable<int16_t, ENV_LUT_SIZE + 1> g_env_taper_lut_q15 = lutgen::makeLut<int16_t, ENV_LUT_SIZE + 1>(envTaperQ15);  // Tukeyの立ち上がり（半周期cos）
+DRAM_ATTR constexpr lutgen::LutTable<int32_t, PITCH_LUT_SIZE> g_pitch_lut_q16 = lutgen::makeLut<int32_t, PITCH_LUT_SIZE>(pitchQ16);
+DRAM_ATTR constexpr lutgen::LutTable<lutgen::LutTable<int16_t, SINC_TAPS>, SINC_PHASES> g_sinc_lut_q15 =
+    lutgen::makeLut<lutgen::LutTable<int16_t, SINC_TAPS>, SINC_PHASES>(sincPhaseQ15);
+#ifdef GRAIN_ULAW_ENABLED
+DRAM_ATTR constexpr lutgen::LutTable<int16_t, 256> g_grain_decode_lut = lutgen::makeLut<int16_t, 256>(decodeGrainSampleRef);  // μ-law コード → int16
+#endif
+constexpr lutgen::LutTable<int16_t, PAN_LUT_SIZE> g_pan_lut_q15 = lutgen::makeLut<int16_t, PAN_LUT_SIZE>(panQ15);
+constexpr lutgen::LutTable<int16_t, MIX_LUT_SIZE> g_mix_lut_q15 = lutgen::makeLut<int16_t, MIX_LUT_SIZE>(mixQ15);
+constexpr lutgen::LutTable<int16_t, FEEDBACK_LUT_SIZE> g_feedback_lut_q15 = lutgen::makeLut<int16_t, FEEDBACK_LUT_SIZE>(feedbackQ15);
 
 // Button States
 ButtonState g_button, g_pot4_button, g_mode_button;
@@ -389,35 +981,37 @@ GranParams g_params;
 Pot4Mode g_pot4_mode = MODE_TEXTURE;
 
 // UI
-UIDisplayCache g_display_cache;
+UiWidget g_ui_widgets[UIW_COUNT];
+int g_ui_next_widget = 0;  // 予算切れで打ち切った位置（次フレームはここから描く）
+bool g_buffer_bar_static_drawn = false;  // drawUiFrame() で画面全体を塗った後は描き直す
+volatile bool g_display_cache_invalid = true;  // 他タスクからの再描画要求
+FrameScheduler g_frame_sched;
 bool g_randomize_flash_active = false;
 unsigned long g_randomize_flash_start = 0;
 bool g_snapshot_flash_active = false;
 unsigned long g_snapshot_flash_start = 0;
 int g_snapshot_flash_number = 0;
 
-// Deja Vu
-ParamSnapshot g_deja_vu_buffer[DEJA_VU_BUFFER_SIZE];
-int g_deja_vu_step = 0;
-
 // Trigger LED
 volatile bool g_trigger_led_on = false;
 volatile unsigned long g_trigger_led_start_time = 0;
 // Clock & Trigger
 volatile bool g_trigger_received_isr = false;
 volatile unsigned long g_last_trigger_time_isr = 0;
+// 手動タップ（loopTask → granularTask）。ISR と同じく1枠の保留で渡し、テンポ・クロック・
+// Deja Vu の状態はオーディオタスクだけが書く（次のブロックの先頭で適用）
+volatile bool g_manual_tap_pending = false;
+volatile bool g_manual_tap_restart = false;   // しばらく空いた後の最初のタップ → レイヤー0を即トリガー
+volatile unsigned long g_manual_tap_time_us = 0;
 unsigned long g_beat_interval_us = 500000;
-unsigned long g_next_internal_trigger_time_us = 0;
 // ★★★ ここから追加 ★★★
 // 物理LEDを点滅させるための、素のBPM用タイマー
 unsigned long g_next_raw_beat_time_us = 0;
 // ★★★ ここまで追加 ★★★
 
-const float g_resolutions[] = {0.25f, 0.3333333f, 0.5f, 1.0f, 2.0f, 3.0f, 4.0f};
+const ClockDivision g_resolutions[] = {{1, 4}, {1, 3}, {1, 2}, {1, 1}, {2, 1}, {3, 1}, {4, 1}};
 const char* g_resolution_names[] = {"1/4", "1/3", "1/2", " x1", " x2", " x3", " x4"};
-int g_current_resolution_index = 3;
 unsigned long g_last_manual_tap_time_us = 0;
-float g_current_bpm = 120.0f;
 
 // Snapshot Storage
 FullParamSnapshot g_snapshots[4];
@@ -426,6 +1020,31 @@ bool g_snapshots_initialized[4] = {false, false, false, false};
 // 物理BPM LEDの状態を管理する変数
 volatile bool g_raw_beat_led_on = false;
 volatile unsigned long g_raw_beat_led_start_time = 0;
+// Load monitoring
+CoreLoadMeter g_coreLoad[2];
+volatile uint8_t g_audio_headroom_min_pct = 100;  // オーディオタスクが書き込み、表示タスクが読み出してリセット
+AudioDeadlineMeter g_audio_meter;
+BootTimeline g_boot;
+#if defined(DSP_PIPELINE_ENABLED) || GRAIN_LAYERS > 1
+TaskHandle_t g_granularTaskHandle = NULL;
+#endif
+#ifdef DSP_PIPELINE_ENABLED
+PipelineQueue g_pipeline;
+AudioDeadlineMeter g_output_meter;  // 後段（出力タスク）の処理時間
+TaskHandle_t g_outputTaskHandle = NULL;
+#endif
+#if GRAIN_LAYERS > 1
+TaskHandle_t g_layerTaskHandle = NULL;
+#endif
+// Master limiter
+PeakLimiter g_limiter;
+volatile int32_t g_limiter_min_gain_q16 = 65536;  // 最小ゲイン（同上: オーディオタスクが書き、表示タスクがリセット）
+#ifdef PROFILE_ENABLED
+PerformanceCounters g_perf;
+// 実際の音声経路で持続した発音数（同上: 表示タスクが窓ごとに読み出してリセット）
+volatile uint8_t g_audio_grains_min = 255;  // 前段: ブロックごとの発音数の最小（グレインを描かなかったブロックは0）
+volatile uint8_t g_audio_reverb_mask = 0;   // 後段: 窓の間に通ったリバーブ構成（bit = ReverbEngine、REVERB_ENGINE_COUNT = 停止）
+#endif
 // --- Soft Takeover for Pitch (POT index 4) ---
 bool  g_soft_takeover_active_pitch = false;  // ピッチ用テイクオーバー有効フラグ
 float g_soft_takeover_target_pitch = 0.5f;
@@ -435,21 +1054,46 @@ float g_soft_takeover_target_pitch = 0.5f;
 // SECTION: Forward Declarations
 // ================================================================= //
 void granularTask(void* param);
-void processAudioSample(int16_t inputSample);
+void displayTask(void* param);
+void processAudioBlock(const AudioFrame* input, int n);
+#ifdef DSP_PIPELINE_ENABLED
+void outputTask(void* param);
+void updatePipelineMode();
+void processPipelinedBlock(const AudioFrame* input, int n);
+#endif
+#if GRAIN_LAYERS > 1
+void layerTask(void* param);
+#endif
 void a2dp_data_callback(const uint8_t *data, uint32_t length);
-void triggerGrain(int idx, const ParamSnapshot& params);
-int16_t renderGrain(Grain& g);
-void renderAllGrains(int32_t& wetL, int32_t& wetR);
-void handleDejaVuTrigger();
+void initGranularLayers();
+void renderLayer(GranularEngine& e, int32_t* wetL, int32_t* wetR, int n, bool audible);
+bool triggerGrain(GranularEngine& e, int idx, const ParamSnapshot& params, uint32_t max_length = MAX_GRAIN_SIZE);
+void renderGrainBlock(Grain& g, InterpMode mode, int16_t gain_q15, int32_t* wetL, int32_t* wetR, int n);
+void renderAllGrains(GranularEngine& e, int32_t* wetL, int32_t* wetR, int n, bool audible);
+void advanceGrainBlock(Grain& g, int n);
+#ifdef PROFILE_ENABLED
+void benchmarkInterpolation();
+#endif
+void handleDejaVuTrigger(GranularEngine& e);
+uint32_t cloudRateHz(int16_t density_q15);
+void runCloudScheduler(GranularEngine& e, int n);
+void spawnCloudGrain(GranularEngine& e, int offset, uint32_t max_length);
+void requestSnapshotSave(GranularEngine& e, int slot, uint32_t seed);
+void requestSnapshotLoad(GranularEngine& e, int slot);
+void requestDejaVuRandomize(GranularEngine& e, uint32_t seed);
+void requestClockResolution(GranularEngine& e, int index);
+void applyLayerRequests(GranularEngine& e);
+void randomizeDejaVuSteps(ParamSnapshot* steps, GrainRng& rng);
 void randomizeDejaVuBuffer();
 void randomizeClockResolution();
 void enablePitchSoftTakeover(float pitchSemitones);
+int16_t pitchSemitonesToQ8(float semitones);
 void updateTempo(unsigned long tap_time_us);
 void IRAM_ATTR triggerISR();
-uint16_t calculateGrainLength(int16_t base_size, int16_t texture);
-uint16_t calculateGrainStartPosition(int16_t base_pos, int16_t texture);
-int32_t calculateGrainSpeed(float base_pitch, int16_t texture);
-void calculateGrainPanning(int16_t& panL, int16_t& panR);
+uint32_t calculateGrainLength(GranularEngine& e, int16_t base_size, int16_t texture);
+uint32_t calculateGrainStartPosition(GranularEngine& e, int16_t base_pos, int16_t texture);
+int32_t calculateGrainSpeed(GranularEngine& e, int16_t base_pitch_q8, int16_t texture);
+void calculateGrainPanning(GranularEngine& e, int16_t& panL, int16_t& panR);
 void updateAllButtons();
 void updateMainButton();
 void updatePot4Button();
@@ -457,25 +1101,53 @@ void updateModeButton();
 void updateSnapshotButtons();
 void saveSnapshot(int slot);
 void loadSnapshot(int slot);
+void applySnapshotToLayer(int slot, GranularEngine& e);
+#if GRAIN_LAYERS > 1
+void loadSnapshotToLayer(int slot, GranularEngine& e);
+#endif
 void initializeSnapshots();
 void updateParametersFromPots();
-void updateDisplay();
+void updateDisplay(bool draw_visualizer);
+void updateFrameScheduler(uint32_t frame_us, bool drew_visualizer);
 bool updateFlashScreens();
-void updatePot4ModeLabels(uint16_t txt_color, uint16_t bg_color, uint16_t highlight_color);
+void restoreFlashRegion();
 void updateTriggerLED();
 void drawUiFrame();
-void drawParameterBar(int x, int y, int16_t val, int16_t& lastVal, uint16_t color);
-void drawPitchBar(int x, int y, float val, float& lastVal, uint16_t color);
+// UI Widget Layer
+void initUiWidgets();
+void uiInitBar(UiWidget& w, int x, int y, uint16_t fill, uint16_t bg, uint16_t border, bool bipolar);
+void uiInitText(UiWidget& w, int x, int y, uint8_t chars, uint16_t fg, uint16_t bg);
+void uiSetText(UiWidget& w, const char* s);
+void uiSetTextColor(UiWidget& w, uint16_t fg);
+void uiSetParam(UiWidgetId bar_id, int16_t val_q15);
+void uiSetPitch(UiWidgetId bar_id, float val);
+uint32_t uiRenderWidgets(uint32_t byte_budget);
+void uiInvalidateRect(int x, int y, int w, int h);
+void invalidateAllWidgets();
 void drawParticleVisualizer();
+void drawBufferBarStatic();
+void updateBufferBar();
+void initParticleVisualizer();
+void pushVisualizerSprite();
+void redrawVisualizerColumns(const uint32_t* columns);
+void markVisualizerColumns(uint32_t* columns, int x0, int x1);
 // Reverb Functions
 void initReverb();
+void layoutReverb();
 void updateReverbParams(int16_t roomSize_q15);
+void processReverbBlock(const int16_t* inL, const int16_t* inR, int16_t* outL, int16_t* outR, int n);
+#ifdef PROFILE_ENABLED
 void processReverb(int16_t inL, int16_t inR, int16_t& outL, int16_t& outR);
-void initAllLuts();
+void benchmarkReverb();
+void dspMathSelfTest();
+#endif
 const char* getModeString(PlayMode mode);
 const char* getPot4ModeString(Pot4Mode mode);
+const char* getReverbEngineString(ReverbEngine e);
 bool handleButtonDebounce(ButtonState& b, int pin);
 void invalidateDisplayCache();
+void printLutFootprint();
+void printBootTimeline();
 
 // ================================================================= //
 // SECTION: Main Setup & Loop
@@ -484,46 +1156,34 @@ void setup() {
     Serial.begin(115200);
 
     // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-    // メモリ診断（起動時）ESP32-WROOM-32 (PSRAMなし)
+    // 起動順: オーディオ経路（A2DP + オーディオタスク）→ UI → 診断表示
     // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-    delay(1000);  // シリアルモニタ接続待ち
-    Serial.println("\n========================================");
-    Serial.println("ESP32-WROOM-32 Memory Status");
-    Serial.println("========================================");
-
-    // 内部SRAMの状況（256KBバッファ使用中）
-    Serial.printf("📊 Internal SRAM:\n");
-    Serial.printf("   Total Heap:  %u bytes (%.2f KB)\n",
-        ESP.getHeapSize(), ESP.getHeapSize() / 1024.0);
-    Serial.printf("   Free Heap:   %u bytes (%.2f KB) ⚠️ Tight!\n",
-        ESP.getFreeHeap(), ESP.getFreeHeap() / 1024.0);
-    Serial.printf("   Min Free:    %u bytes (%.2f KB)\n",
-        ESP.getMinFreeHeap(), ESP.getMinFreeHeap() / 1024.0);
-
-    // グレインバッファ情報
-    Serial.printf("\n🎵 Audio Buffer (in internal SRAM):\n");
-    Serial.printf("   g_grainBuffer: %u bytes (%.2f KB)\n",
-        sizeof(g_grainBuffer), sizeof(g_grainBuffer) / 1024.0);
-    Serial.printf("   Address: %p\n", (void*)g_grainBuffer);
-    Serial.printf("   Duration: ~%.1f seconds at 44.1kHz\n",
-        GRAIN_BUFFER_SIZE / 44100.0);
-
-    Serial.println("========================================\n");
-    // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-
-    tft.init();
-    tft.setRotation(1);
-    initAllLuts();
+    // シリアルモニタ待ちなどの delay は置かない。グローバル配列は .bss で0クリア済みなので
+    // グレイン履歴の memset も不要。setup() は loopTask（コア1、優先度1）で動くため、
+    // UI の初期化中もオーディオタスク（優先度2）が先に走る
+    // コア負荷メーターの校正は、入力待ちで空いているコア1のアイドル率でも行う（updateCoreLoad）
+    initCoreLoadMeters();
+
+    // ── 1) オーディオ経路 ──
+    initParticleVisualizer();  // スプライトは A2DP より先に確保する（BTスタックのヒープ確保の前）
     initReverb();  // リバーブエンジン初期化
+    updateReverbParams(16384);  // 50%のルームサイズ
+#ifdef PROFILE_ENABLED
+    // グレイン・リバーブの状態を使うので、オーディオタスクの起動前に済ませる
+    benchmarkInterpolation();
+    benchmarkReverb();
+    dspMathSelfTest();
+#endif
 
     g_ringBuffer.init();
-    for(int i = 0; i < MAX_GRAINS; i++) g_grains[i].reset();
-    memset(g_grainBuffer, 0, sizeof(g_grainBuffer));
-    // ★ 修正点: 安全なキャッシュ初期化関数を呼び出す
-    invalidateDisplayCache();
-    
-    g_display_cache.bt_connected = !a2dp_sink.is_connected();
-    
+    g_limiter.init();
+#ifdef GRAIN_TIERED_ENABLED
+    for (int i = 0; i < GRAIN_ARCHIVE_SHIFT; i++) g_archiveDecim[i].init();
+#endif
+#ifdef GRAIN_MIPMAP_ENABLED
+    for (int i = 0; i < GRAIN_MIP_LEVELS - 1; i++) g_mipDecim[i].init();
+#endif
+
     analogReadResolution(12);
     analogSetAttenuation(ADC_11db);
 
@@ -553,73 +1213,106 @@ void setup() {
     g_params.loop_length = 16;
     g_params.reverb_mix_q15 = 0;       // 初期値: リバーブオフ
     g_params.reverb_room_q15 = 16384;  // 初期値: 50%のルームサイズ
+    g_params.interp_mode = INTERP_AUTO;
+    g_params.env_shape = ENV_HANN2;
+    g_params.reverse_prob_q15 = 16384;
+    g_params.density_q15 = 0;
+    g_params.reverb_engine = REVERB_FREEVERB;
+    initGranularLayers();
+    g_stage.init();
     // 起動時にランダムなパラメータでスナップショットを初期化
     initializeSnapshots();
-    
-    drawUiFrame();
 
+#ifdef DSP_PIPELINE_ENABLED
+    g_pipeline.init();
+    xTaskCreatePinnedToCore(granularTask, "Granular", 8192, NULL, 2, &g_granularTaskHandle, 1);
+    xTaskCreatePinnedToCore(outputTask, "DSP-Out", OUTPUT_TASK_STACK_SIZE, NULL, OUTPUT_TASK_PRIORITY, &g_outputTaskHandle, 0);
+#elif GRAIN_LAYERS > 1
+    // レイヤータスクを先に作る（オーディオタスクは最初のブロックから起こしにいく）
+    g_layer_job.init();
+    xTaskCreatePinnedToCore(layerTask, "Layer", LAYER_TASK_STACK_SIZE, NULL, LAYER_TASK_PRIORITY, &g_layerTaskHandle, 0);
+    xTaskCreatePinnedToCore(granularTask, "Granular", 8192, NULL, 2, &g_granularTaskHandle, 1);
+#else
     xTaskCreatePinnedToCore(granularTask, "Granular", 8192, NULL, 2, NULL, 1);
-    delay(500);
+#endif
 
     a2dp_sink.set_stream_reader(a2dp_data_callback, false);
     a2dp_sink.start("ESP32-Granular");
+    g_boot.audio_start_us = micros();
+
+    // ── 2) UI（描画は専用タスク: Core 0、低優先度） ──
+    tft.init();
+    tft.setRotation(1);
+    if (g_vizSpriteReady) tft.initDMA();
+    drawUiFrame();
+    g_frame_sched.init();
+    xTaskCreatePinnedToCore(displayTask, "Display", DISPLAY_TASK_STACK_SIZE, NULL, DISPLAY_TASK_PRIORITY, NULL, 0);
+    g_boot.ui_start_us = micros();
+
+    // ── 3) 診断表示（メモリ診断 ESP32-WROOM-32 (PSRAMなし)） ──
+    Serial.println("\n========================================");
+    Serial.println("ESP32-WROOM-32 Memory Status");
+    Serial.println("========================================");
+
+    // 内部SRAMの状況（256KBバッファ使用中）
+    Serial.printf("📊 Internal SRAM:\n");
+    Serial.printf("   Total Heap:  %u bytes (%.2f KB)\n",
+        ESP.getHeapSize(), ESP.getHeapSize() / 1024.0);
+    Serial.printf("   Free Heap:   %u bytes (%.2f KB) ⚠️ Tight!\n",
+        ESP.getFreeHeap(), ESP.getFreeHeap() / 1024.0);
+    Serial.printf("   Min Free:    %u bytes (%.2f KB)\n",
+        ESP.getMinFreeHeap(), ESP.getMinFreeHeap() / 1024.0);
+
+    // グレインバッファ情報
+    Serial.printf("\n🎵 Audio Buffer (in internal SRAM):\n");
+    Serial.printf("   g_grainBuffer: %u bytes (%.2f KB)\n",
+        sizeof(g_grainBuffer), sizeof(g_grainBuffer) / 1024.0);
+    Serial.printf("   Address: %p\n", (void*)g_grainBuffer);
+    Serial.printf("   Duration: ~%.1f seconds at 44.1kHz (%s)\n",
+        GRAIN_BUFFER_SIZE / 44100.0, GRAIN_CHANNELS == 2 ? "stereo" : "mono");
+#ifdef GRAIN_COMPRESSED_ENABLED
+    Serial.printf("   Format: 8-bit mu-law (2x history per byte)\n");
+#endif
+#ifdef GRAIN_TIERED_ENABLED
+    Serial.printf("   Recent tier: %u samples (~%.1f s) | archive: %u bytes (1/%d rate mu-law)\n",
+        (unsigned)GRAIN_RECENT_SIZE, GRAIN_RECENT_SIZE / 44100.0, (unsigned)sizeof(g_grainArchive), 1 << GRAIN_ARCHIVE_SHIFT);
+#endif
+#ifdef GRAIN_MIPMAP_ENABLED
+    Serial.printf("   Mip levels (1/2, 1/4): %u bytes (%.2f KB)\n",
+        sizeof(g_grainMip1) + sizeof(g_grainMip2), (sizeof(g_grainMip1) + sizeof(g_grainMip2)) / 1024.0);
+#endif
+    printLutFootprint();
+
+    Serial.println("========================================\n");
+
+    g_boot.setup_done_us = micros();
+    Serial.printf("⏱  Boot: audio ready %.1f ms | UI %.1f ms | setup done %.1f ms\n",
+        g_boot.audio_start_us / 1000.0, g_boot.ui_start_us / 1000.0, g_boot.setup_done_us / 1000.0);
     Serial.println("\nSetup Complete! (Perf. Fix v2)");
 }
 
 void loop() {
     updateAllButtons();
 
-    // ADC読み取り処理をloop()タスク(Core 0)で実行
+    // ADC読み取り処理はloop()タスク（loopTask: コア1、優先度1。オーディオタスクより低い）で実行
     static unsigned long lastPotUpdateTime = 0;
     if (millis() - lastPotUpdateTime > ADC_UPDATE_INTERVAL_MS) {
         lastPotUpdateTime = millis();
         updateParametersFromPots();
     }
 
-    static unsigned long lastDisplayUpdate = 0;
-    if (millis() - lastDisplayUpdate > DISPLAY_UPDATE_INTERVAL_MS) {
-        lastDisplayUpdate = millis();
-        updateDisplay();
-    }
-
-    if (g_randomize_flash_active && millis() - g_randomize_flash_start > RANDOMIZE_FLASH_DURATION_MS) {
-        g_randomize_flash_active = false;
-        drawUiFrame();
-        // ★ 修正点: memsetを削除 (UI更新はinvalidateDisplayCacheが担当)
-    }
-
-    if (g_snapshot_flash_active && millis() - g_snapshot_flash_start > RANDOMIZE_FLASH_DURATION_MS) {
-        g_snapshot_flash_active = false;
-        drawUiFrame();
-        // ★ 修正点: memsetを削除 (UI更新はinvalidateDisplayCacheが担当)
-    }
+    // 表示更新は displayTask が担当（フラッシュ画面の終了処理も含む）
+    printPerformanceReport();
+    if (!g_boot.reported && g_boot.first_output_us != 0) printBootTimeline();
 
     vTaskDelay(pdMS_TO_TICKS(10));
 }
 
 
-// ★ 追加: 表示キャッシュを安全に無効化する関数
+// 表示キャッシュの無効化を要求する（どのタスクからでも呼べる）
+// 実際の無効化（全ウィジェットの再描画）は displayTask が次のフレーム開始時に行う
 void invalidateDisplayCache() {
-    // 各パラメータを、通常ありえない値に設定することで、次回の描画を強制する
-    g_display_cache.position_q15 = -1;
-    g_display_cache.size_q15 = -1;
-    g_display_cache.deja_vu_q15 = -1;
-    g_display_cache.dryWet_q15 = -1;
-    g_display_cache.pitch_f = -1000.0f; // float型にはレンジ外の値を
-    g_display_cache.mode = (PlayMode)-1;
-    // enum型には無効な値を
-    g_display_cache.pot4_mode = (Pot4Mode)-1;
-    g_display_cache.pot4_mode_for_text_update = (Pot4Mode)-1;
-    g_display_cache.texture_q15 = -1;
-    g_display_cache.stereoSpread_q15 = -1;
-    g_display_cache.feedback_q15 = -1;
-    g_display_cache.loop_length = -1;
-    g_display_cache.resolution_index = -1;
-    g_display_cache.active_grains = 255; // uint8_tには最大値などを
-    g_display_cache.bpm = -1000.0f;
-    g_display_cache.reverb_mix_q15 = -1;   // リバーブMIX
-    g_display_cache.reverb_room_q15 = -1;  // ルームサイズ
-    // g_display_cache.bt_connected はsetupで初期化されるのでここでは不要
+    g_display_cache_invalid = true;
 }
 
 // ================================================================= //
@@ -672,6 +1365,8 @@ void granularTask(void* param) {
     }
 
     i2s_zero_dma_buffer(I2S_NUM_1);
+    g_audio_meter.busy_us = 0;
+    g_audio_meter.resume();
 
     while (true) {
         unsigned long current_time_us = micros();
@@ -680,12 +1375,26 @@ void granularTask(void* param) {
             g_trigger_received_isr = false;
             updateTempo(isr_time);
         }
+        // ボタン・つまみからの要求（スナップショット・ランダマイズ・分解能）。レイヤータスクは待機中
+        for (int k = 0; k < GRAIN_LAYERS; k++) applyLayerRequests(g_layers[k]);
+        if (g_manual_tap_pending) {
+            unsigned long tap_time = g_manual_tap_time_us;
+            bool restart = g_manual_tap_restart;
+            g_manual_tap_pending = false;
+            updateTempo(tap_time);
+            if (restart) handleDejaVuTrigger(g_layers[0]);
+        }
 
-        // 分解能が適用されたクロック（画面LEDやエフェクトのトリガー用）
-        if (current_time_us >= g_next_internal_trigger_time_us && g_next_internal_trigger_time_us > 0) {
-            handleDejaVuTrigger();
-            unsigned long internal_interval = g_beat_interval_us / g_resolutions[g_current_resolution_index];
-            g_next_internal_trigger_time_us += internal_interval;
+        // 分解能が適用されたクロック（レイヤーごと。画面LEDやエフェクトのトリガー用）
+        // ブロックの合間なので、コア0のレイヤーもここで触ってよい（レイヤータスクは待機中）
+        for (int k = 0; k < GRAIN_LAYERS; k++) {
+            GranularEngine& layer = g_layers[k];
+            if (current_time_us >= layer.next_trigger_time_us && layer.next_trigger_time_us > 0) {
+                handleDejaVuTrigger(layer);
+                const ClockDivision& r = g_resolutions[layer.resolution_index];
+                unsigned long internal_interval = g_beat_interval_us * r.den / r.num;
+                layer.next_trigger_time_us += internal_interval;
+            }
         }
 
         // 分解能適用前の「素のBPM」クロック（物理LED用）
@@ -707,147 +1416,658 @@ void granularTask(void* param) {
             }
         }
 
-        int16_t inputSample;
-        if (g_ringBuffer.read(inputSample)) {
-            processAudioSample(inputSample);
+        // 溜まっている分を最大1ブロックまとめて処理（入力を待って遅延を増やすことはしない）
+        AudioFrame inputBlock[AUDIO_BLOCK_SIZE];
+        int n = 0;
+        while (n < AUDIO_BLOCK_SIZE && g_ringBuffer.read(inputBlock[n])) n++;
+        if (n > 0) {
+            processAudioBlock(inputBlock, n);
         } else {
+            // 入力待ちは処理時間に含めない
+            g_audio_meter.pause();
             vTaskDelay(1);
+            g_audio_meter.resume();
         }
     }
 }
 
-// ソフトクリッピング関数（高速tanh近似）
-// 入力範囲: -32768 ~ 32767
-// 出力範囲: -32767 ~ 32767（滑らかに飽和）
-inline int16_t softClip(int32_t x) {
-    // 範囲内ならそのまま
-    if (x >= -24576 && x <= 24576) {
-        return (int16_t)x;
+// ソフトクリッピング（softClip）は dsp_math.h
+
+// ステレオブロックの最大絶対値（無音判定用）
+inline int32_t blockPeak(const int16_t* l, const int16_t* r, int n) {
+    int32_t peak = 0;
+    for (int i = 0; i < n; i++) {
+        peak = max(peak, (int32_t)abs(l[i]));
+        peak = max(peak, (int32_t)abs(r[i]));
     }
+    return peak;
+}
 
-    // 3次多項式による滑らかなクリッピング
-    if (x > 24576) {
-        int32_t excess = x - 24576;
-        if (excess > 8191) return 32767;
-        // 滑らかな遷移領域
-        int32_t soft = 24576 + excess - ((excess * excess) >> 13);
-        return (int16_t)min(soft, 32767);
-    } else {
-        int32_t excess = -24576 - x;
-        if (excess > 8191) return -32767;
-        // 滑らかな遷移領域
-        int32_t soft = -24576 - excess + ((excess * excess) >> 13);
-        return (int16_t)max(soft, -32767);
+// グレインバッファの波形サマリ（表示1列 ≈ 410サンプルのmin/max）を書き込みと同時に更新する。
+// 1サンプルあたりO(1)で再走査はしない。書き込みヘッドが新しい列に入った時点でその列を
+// リセットし、列を移る時だけ dirty を立てる（直前の列はこの時点で確定値になる）
+inline void updateWaveOverview(uint32_t write_pos, int16_t sample) {
+    static uint16_t current_col = 0;
+    uint16_t col = (write_pos * VIZ_WAVE_COLUMNS) / GRAIN_BUFFER_SIZE;
+    if (col != current_col) {
+        __atomic_fetch_or(&g_wave_dirty[current_col >> 5], 1u << (current_col & 31), __ATOMIC_RELAXED);
+        __atomic_fetch_or(&g_wave_dirty[col >> 5], 1u << (col & 31), __ATOMIC_RELAXED);
+        current_col = col;
+        g_wave_min[col] = sample;
+        g_wave_max[col] = sample;
+        return;
     }
+    if (sample < g_wave_min[col]) g_wave_min[col] = sample;
+    if (sample > g_wave_max[col]) g_wave_max[col] = sample;
 }
 
-void processAudioSample(int16_t inputSample) {
-    static int16_t i2s_buffer[I2S_BUFFER_SAMPLES * 2];
-    static int16_t feedbackBuffer[FEEDBACK_BUFFER_SIZE];
-    static int i2s_buffer_pos = 0;
-    static uint16_t fbWritePos = 0;
+#ifdef GRAIN_MIPMAP_ENABLED
+// 書き込み1サンプルごとにミップ段を更新する。段 L のインデックス j は原音インデックス j << L に対応し、
+// デシメータの群遅延（3サンプル）ぶん遅れて、中心が偶数位置になった時だけ1つ書く
+inline void updateGrainMips(uint32_t write_pos, int16_t sample) {
+    g_mipDecim[0].push(sample);
+    uint32_t c1 = (write_pos - 3) & GRAIN_BUFFER_MASK;
+    if (c1 & 1) return;
+    int16_t y1 = g_mipDecim[0].output();
+    uint32_t j = c1 >> 1;
+    g_grainMip1[j] = y1;
+
+    g_mipDecim[1].push(y1);
+    uint32_t c2 = (j - 3) & (GRAIN_BUFFER_MASK >> 1);
+    if (c2 & 1) return;
+    g_grainMip2[c2 >> 1] = g_mipDecim[1].output();
+}
+#endif
+
+#ifdef GRAIN_TIERED_ENABLED
+// アーカイブ段の更新（ミップ段と同じ2段のハーフバンドで 1/4 にして μ-law で書く）。
+// インデックス j は履歴座標 j << 2 に対応する
+inline void updateGrainArchive(uint32_t write_pos, int16_t sample) {
+    g_archiveDecim[0].push(sample);
+    uint32_t c1 = (write_pos - 3) & GRAIN_BUFFER_MASK;
+    if (c1 & 1) return;
+    int16_t y1 = g_archiveDecim[0].output();
+
+    g_archiveDecim[1].push(y1);
+    uint32_t c2 = ((c1 >> 1) - 3) & (GRAIN_BUFFER_MASK >> 1);
+    if (c2 & 1) return;
+    g_grainArchive[c2 >> 1] = encodeGrainSample(g_archiveDecim[1].output());
+}
+#endif
+
+// I2Sブロック1つ分の処理ごとに締切（128サンプル ≈ 2.9ms）に対する余裕を記録し、計測をリセットする
+inline void recordAudioHeadroom(AudioDeadlineMeter& meter) {
+    constexpr uint32_t I2S_BLOCK_DEADLINE_US = (uint32_t)(I2S_BUFFER_SAMPLES * 1000000ULL / 44100);
+    uint32_t busy_us = meter.busy_us;
+    uint8_t headroom_pct = (busy_us >= I2S_BLOCK_DEADLINE_US) ? 0 : (uint8_t)(100 - (busy_us * 100) / I2S_BLOCK_DEADLINE_US);
+    if (headroom_pct < g_audio_headroom_min_pct) g_audio_headroom_min_pct = headroom_pct;
+    meter.busy_us = 0;
+}
 
-    int16_t fbSample = feedbackBuffer[fbWritePos];
-    int32_t mixed = inputSample + (((int32_t)fbSample * g_params.feedback_q15) >> 15);
-    mixed = softClip(mixed);  // ソフトクリッピングに変更
+// 1レイヤー分のクラウド発音とグレインのレンダリング（wetL/R に足し込む）
+void renderLayer(GranularEngine& e, int32_t* wetL, int32_t* wetR, int n, bool audible) {
+#ifdef PROFILE_ENABLED
+    const int64_t layer_start_us = esp_timer_get_time();
+#endif
+    // クラウドの発音（このブロック内のオンセットをサンプル精度で割り当てる）
+    runCloudScheduler(e, n);
+#ifdef PROFILE_ENABLED
+    e.perf.cloud_us = (uint32_t)(esp_timer_get_time() - layer_start_us);
+    const uint8_t voices = e.activeGrainCount;
+    if (!audible && voices > 0) e.perf.grain_bypass_blocks++;
+#endif
+    renderAllGrains(e, wetL, wetR, n, audible);
+#ifdef PROFILE_ENABLED
+    // 平均発音数・1ボイスのコストはレポート側で積算値から出す
+    e.perf.busy_us = (uint32_t)(esp_timer_get_time() - layer_start_us);
+    e.perf.voice_samples += (uint32_t)voices * n;
+    e.perf.samples += n;
+#endif
+}
 
-    g_grainBuffer[g_grainWritePos] = (int16_t)mixed;
-    g_grainWritePos = (g_grainWritePos + 1) & GRAIN_BUFFER_MASK;
+#ifdef PROFILE_ENABLED
+// ブロックの合流後（全レイヤーのレンダリングが終わってから）オーディオタスクが呼ぶ。
+// g_perf のレイヤー関連フィールドを書くのはここだけ
+void publishLayerPerf() {
+    uint32_t cloud_us = 0;
+    g_perf.layer_count = GRAIN_LAYERS;
+    g_perf.interp_mode_active = g_layers[0].perf.interp_mode;
+    for (int k = 0; k < GRAIN_LAYERS; k++) {
+        LayerPerfCounters& lp = g_layers[k].perf;
+        g_perf.layer_core[k] = g_layers[k].core;
+        g_perf.layer_busy_us[k] += lp.busy_us;
+        g_perf.layer_voice_samples[k] += lp.voice_samples;
+        g_perf.layer_samples[k] += lp.samples;
+        if (lp.busy_us > g_perf.max_layer_render_us[k]) g_perf.max_layer_render_us[k] = lp.busy_us;
+        g_perf.cloud_grain_count += lp.cloud_grain_count;
+        g_perf.cloud_dropped_count += lp.cloud_dropped_count;
+        g_perf.archive_grain_count += lp.archive_grain_count;
+        g_perf.grain_bypass_blocks += lp.grain_bypass_blocks;
+        cloud_us += lp.cloud_us;
+        memset(&lp, 0, sizeof(lp));
+    }
+    g_perf.cloudScheduler_us = cloud_us;
+    if (cloud_us > g_perf.max_cloudScheduler_us) g_perf.max_cloudScheduler_us = cloud_us;
+}
+#endif
+
+#if GRAIN_LAYERS > 1
+// コア0のレイヤーにこのブロックを依頼する（依頼内容を書いてから seq を進める）
+inline void startLayerJob(int n, bool audible) {
+    g_layer_job.n = n;
+    g_layer_job.audible = audible;
+    __atomic_store_n(&g_layer_job.seq, g_layer_job.seq + 1, __ATOMIC_RELEASE);
+    xTaskNotifyGive(g_layerTaskHandle);
+}
 
-    if (!g_grainBufferReady && g_grainWritePos > GRAIN_BUFFER_SIZE / 2) {
-        g_grainBufferReady = true;
+// コア0のレイヤーの完了を待ってウェットに足し込む。
+// 待ち時間も締切に対しては処理時間なので、オーディオの計測からは除かない
+inline void finishLayerJob(int32_t* wetL, int32_t* wetR, int n) {
+    const uint32_t seq = g_layer_job.seq;
+    if (__atomic_load_n(&g_layer_job.done, __ATOMIC_ACQUIRE) != seq) {
+#ifdef PROFILE_ENABLED
+        const int64_t wait_start_us = esp_timer_get_time();
+#endif
+        while (__atomic_load_n(&g_layer_job.done, __ATOMIC_ACQUIRE) != seq) {
+            ulTaskNotifyTake(pdTRUE, 1);
+        }
+#ifdef PROFILE_ENABLED
+        const uint32_t wait_us = (uint32_t)(esp_timer_get_time() - wait_start_us);
+        g_perf.layer_wait_us += wait_us;
+        if (wait_us > g_perf.max_layer_wait_us) g_perf.max_layer_wait_us = wait_us;
+#endif
     }
+    for (int i = 0; i < n; i++) {
+        wetL[i] += g_layer_job.wetL[i];
+        wetR[i] += g_layer_job.wetR[i];
+    }
+}
 
-    int32_t wetL_accumulator = 0, wetR_accumulator = 0;
-    renderAllGrains(wetL_accumulator, wetR_accumulator);
-
-    int16_t wetL = softClip(wetL_accumulator);  // ソフトクリッピングに変更
-    int16_t wetR = softClip(wetR_accumulator);  // ソフトクリッピングに変更
-
+// レイヤータスク（コア0）。依頼されたブロックでコア0のレイヤーを処理し、終わったらオーディオタスクを起こす
+void layerTask(void* param) {
+    Serial.println("Granular layer task started on Core 0");
+    uint32_t done = 0;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (done != __atomic_load_n(&g_layer_job.seq, __ATOMIC_ACQUIRE)) {
+            const int n = g_layer_job.n;
+            memset(g_layer_job.wetL, 0, n * sizeof(int32_t));
+            memset(g_layer_job.wetR, 0, n * sizeof(int32_t));
+            for (int k = 0; k < GRAIN_LAYERS; k++) {
+                if (g_layers[k].core == 0) renderLayer(g_layers[k], g_layer_job.wetL, g_layer_job.wetR, n, g_layer_job.audible);
+            }
+            __atomic_store_n(&g_layer_job.done, ++done, __ATOMIC_RELEASE);
+            xTaskNotifyGive(g_granularTaskHandle);
+        }
+    }
+}
+#endif
+
+// 前段: 取り込み・クラウド・グレイン・ドライ/ウェットミックス（1〜4）。結果は blk に書く
+void processGrainStage(const AudioFrame* input, int n, StageBlock& blk) {
+    static uint16_t fbReadPos = 0;
+    static int32_t wetL_block[AUDIO_BLOCK_SIZE];
+    static int32_t wetR_block[AUDIO_BLOCK_SIZE];
+    AudioFrame* const feedbackBuffer = g_feedbackBuffer;
+
+    // 1) 入力+フィードバックをグレインバッファへ書き込む
+    //    フィードバックは FEEDBACK_BUFFER_SIZE サンプル前の出力なので、このブロックの出力より先に読める
+    //    フィードバック量0の間は読み出しを飛ばす（掛けても0）
+    //    帰還の乗算は最近接丸め（切り捨てだと周回ごとに負方向へ偏りが溜まる）
+    const int16_t fb_q15 = g_params.feedback_q15;
+    int32_t capture_peak = 0;
+    for (int i = 0; i < n; i++) {
+#ifdef GRAIN_STEREO_ENABLED
+        // L/R それぞれに同じチャンネルのフィードバックを戻す
+        int32_t mixedL = frameL(input[i]);
+        int32_t mixedR = frameR(input[i]);
+        if (fb_q15 != 0) {
+            AudioFrame fbFrame = feedbackBuffer[(fbReadPos + i) & (FEEDBACK_BUFFER_SIZE - 1)];
+            mixedL += mulQ15Round(frameL(fbFrame), fb_q15);
+            mixedR += mulQ15Round(frameR(fbFrame), fb_q15);
+        }
+        mixedL = softClip(mixedL);
+        mixedR = softClip(mixedR);
+        capture_peak = max(capture_peak, (int32_t)max(abs(mixedL), abs(mixedR)));
+
+        g_grainBuffer[g_grainWritePos] = packFrame(mixedL, mixedR);
+        updateWaveOverview(g_grainWritePos, (int16_t)((mixedL + mixedR) >> 1));
+#else
+        int32_t mixed = input[i];
+        if (fb_q15 != 0) {
+            int16_t fbSample = feedbackBuffer[(fbReadPos + i) & (FEEDBACK_BUFFER_SIZE - 1)];
+            mixed += mulQ15Round(fbSample, fb_q15);
+        }
+        mixed = softClip(mixed);
+        capture_peak = max(capture_peak, (int32_t)abs(mixed));
+
+#if defined(GRAIN_COMPRESSED_ENABLED)
+        g_grainBuffer[g_grainWritePos] = encodeGrainSample(mixed);
+#elif defined(GRAIN_TIERED_ENABLED)
+        g_grainBuffer[g_grainWritePos & GRAIN_RECENT_MASK] = (int16_t)mixed;
+        updateGrainArchive(g_grainWritePos, (int16_t)mixed);
+#else
+        g_grainBuffer[g_grainWritePos] = (int16_t)mixed;
+#endif
+        updateWaveOverview(g_grainWritePos, (int16_t)mixed);
+#endif
+#ifdef GRAIN_MIPMAP_ENABLED
+        updateGrainMips(g_grainWritePos, (int16_t)mixed);
+#endif
+        g_grainWritePos = (g_grainWritePos + 1) & GRAIN_BUFFER_MASK;
+    }
+    if (g_grainHistorySamples < GRAIN_BUFFER_SIZE) {
+        g_grainHistorySamples = min(g_grainHistorySamples + (uint32_t)n, (uint32_t)GRAIN_BUFFER_SIZE);
+    }
+
+    fbReadPos = (fbReadPos + n) & (FEEDBACK_BUFFER_SIZE - 1);
+
+    // バッファ全体が無音になったら、どのグレインが読んでも無音
+    g_stage.grain_quiet = (capture_peak <= SILENCE_THRESHOLD) ? min(g_stage.grain_quiet + n, (uint32_t)GRAIN_BUFFER_SIZE) : 0;
+
+    // 2) 3) レイヤーごとにクラウドの発音とグレインのレンダリング
+    //    ウェット0・バッファ全体が無音のときは状態だけ進める（再開しても窓・位置はそのまま続く）
+    //    コア0のレイヤーは先にレイヤータスクへ渡し、コア1のレイヤーと並列に処理してから足し込む
     int16_t wet_q15 = g_params.dryWet_q15;
     int16_t dry_q15 = 32767 - wet_q15;
-    int16_t granOutL = softClip(((int32_t)inputSample*dry_q15+(int32_t)wetL*wet_q15)>>15);  // グラニュラーエフェクト出力
-    int16_t granOutR = softClip(((int32_t)inputSample*dry_q15+(int32_t)wetR*wet_q15)>>15);
-
-    // リバーブ処理
-    int16_t reverbOutL, reverbOutR;
-    processReverb(granOutL, granOutR, reverbOutL, reverbOutR);
+    const bool grains_audible = (wet_q15 != 0) && (g_stage.grain_quiet < (uint32_t)GRAIN_BUFFER_SIZE);
+    memset(wetL_block, 0, n * sizeof(int32_t));
+    memset(wetR_block, 0, n * sizeof(int32_t));
+#if GRAIN_LAYERS > 1
+    startLayerJob(n, grains_audible);
+#endif
+    for (int k = 0; k < GRAIN_LAYERS; k++) {
+        if (g_layers[k].core == 1) renderLayer(g_layers[k], wetL_block, wetR_block, n, grains_audible);
+    }
+#if GRAIN_LAYERS > 1
+    finishLayerJob(wetL_block, wetR_block, n);
+#endif
+#ifdef PROFILE_ENABLED
+    publishLayerPerf();
+    uint8_t block_grains = 0;
+    if (grains_audible) {
+        for (int k = 0; k < GRAIN_LAYERS; k++) block_grains += g_layers[k].activeGrainCount;
+    }
+    if (block_grains < g_audio_grains_min) g_audio_grains_min = block_grains;
+#endif
+
+    // 4) ドライ/ウェットミックス（グラニュラーエフェクト出力）
+    //    ウェットは32bitのまま混ぜる（グレイン和は ±32767 を超えうるので積は64bit）。
+    //    マスター経路は32bitのままリミッターへ、リバーブ入力だけ16bitに収める
+    //    従来（ウェットを先に softClip してから混ぜる）との差: |ウェット| ≤ 24576 なら 0LSB（ビット一致）。
+    //    それを超えるとウェットを膝で丸めずに線形のまま混ぜる（差 = 膝で削っていた分 × WET）。
+    //    ±32767 を超えた分はリバーブ入力の sat16 と出力のリミッターで抑える（test/test_soft_clip）
+    for (int i = 0; i < n; i++) {
+        blk.granL32[i] = mix2Q15(frameL(input[i]), dry_q15, wetL_block[i], wet_q15);
+        blk.granR32[i] = mix2Q15(frameR(input[i]), dry_q15, wetR_block[i], wet_q15);  // モノラルでは入力は同じ
+    }
+    blk.n = n;
+    blk.fb_q15 = fb_q15;
+}
 
-    // リバーブMIX
+// 後段: リバーブ・リミッター・フィードバック書き込み・I2S出力（5〜6）。
+// meter は I2S 書き込み待ちを除いた処理時間の計測先（呼び出し側のタスクのもの）
+void processOutputStage(const StageBlock& blk, AudioDeadlineMeter& meter) {
+    static int16_t i2s_buffer[I2S_BUFFER_SAMPLES * 2];
+    static int i2s_buffer_pos = 0;
+    static uint16_t fbWritePos = 0;
+    static int16_t granL_block[AUDIO_BLOCK_SIZE], granR_block[AUDIO_BLOCK_SIZE];
+    static int16_t rvbL_block[AUDIO_BLOCK_SIZE], rvbR_block[AUDIO_BLOCK_SIZE];
+    AudioFrame* const feedbackBuffer = g_feedbackBuffer;
+    const int n = blk.n;
+    const int16_t fb_q15 = blk.fb_q15;
+    const int32_t* const granL32_block = blk.granL32;
+    const int32_t* const granR32_block = blk.granR32;
+
+    // リバーブ入力だけ16bitに収める
+    for (int i = 0; i < n; i++) {
+        granL_block[i] = (int16_t)sat16(granL32_block[i]);
+        granR_block[i] = (int16_t)sat16(granR32_block[i]);
+    }
+
+    // 5) リバーブ（ブロック処理）
+    //    MIX 0、または入力が無音で残響も消え切ったら止める。停止中はディレイメモリを
+    //    REVERB_CLEAR_CHUNK_SAMPLES ずつクリアし、再開時は位置と状態だけ戻して0から立ち上げる
+    //    （古い残響が急に出ない。1ブロックで全メモリをクリアしない）。クリアが終わるまでは再開しない
+    //    エンジンの切り替えも同じ経路（停止 → クリア → 新しい配置で再開）
     int16_t rvbMix_q15 = g_params.reverb_mix_q15;
     int16_t rvbDry_q15 = 32767 - rvbMix_q15;
-    int16_t outL = softClip(((int32_t)granOutL*rvbDry_q15+(int32_t)reverbOutL*rvbMix_q15)>>15);
-    int16_t outR = softClip(((int32_t)granOutR*rvbDry_q15+(int32_t)reverbOutR*rvbMix_q15)>>15);
-
-    feedbackBuffer[fbWritePos] = (int16_t)((((long)outL + outR) >> 1) * g_params.feedback_q15 >> 15);
-    fbWritePos = (fbWritePos + 1) & (FEEDBACK_BUFFER_SIZE - 1);
-    i2s_buffer[i2s_buffer_pos++] = outL;
-    i2s_buffer[i2s_buffer_pos++] = outR;
-
-    if (i2s_buffer_pos >= I2S_BUFFER_SAMPLES * 2) {
-        size_t bytes_written;
-        esp_err_t i2s_result = i2s_write(I2S_NUM_1, i2s_buffer, i2s_buffer_pos*sizeof(int16_t), &bytes_written, portMAX_DELAY);
-
-        // Check for I2S write errors (avoid logging in real-time path to prevent performance degradation)
-        if (i2s_result != ESP_OK) {
-            static uint32_t error_count = 0;
-            error_count++;
-            // Only log every 1000th error to avoid flooding serial output
-            if (error_count % 1000 == 0) {
-                Serial.printf("WARNING: I2S write error: %d (count: %u)\n", i2s_result, error_count);
+    bool run_reverb = false;
+    bool rvb_in_quiet = true;
+    if (rvbMix_q15 != 0) {
+        rvb_in_quiet = blockPeak(granL_block, granR_block, n) <= SILENCE_THRESHOLD;
+        if (g_stage.reverb_idle) run_reverb = !rvb_in_quiet && g_stage.reverb_cleared >= (uint32_t)REVERB_MEM_SAMPLES;
+        else                     run_reverb = !(rvb_in_quiet && g_stage.reverb_quiet >= REVERB_TAIL_HOLD_SAMPLES);
+    }
+    if (!g_stage.reverb_idle && g_params.reverb_engine != g_reverb_engine_active) run_reverb = false;
+    if (run_reverb) {
+        if (g_stage.reverb_idle) {
+            layoutReverb();
+            g_stage.reverb_idle = false;
+            g_stage.reverb_quiet = 0;
+        }
+        processReverbBlock(granL_block, granR_block, rvbL_block, rvbR_block, n);
+        bool rvb_out_quiet = blockPeak(rvbL_block, rvbR_block, n) <= SILENCE_THRESHOLD;
+        g_stage.reverb_quiet = (rvb_in_quiet && rvb_out_quiet) ? min(g_stage.reverb_quiet + n, REVERB_TAIL_HOLD_SAMPLES) : 0;
+#ifdef PROFILE_ENABLED
+        g_audio_reverb_mask |= (uint8_t)(1u << g_reverb_engine_active);
+#endif
+    } else {
+        if (!g_stage.reverb_idle) {
+            g_stage.reverb_idle = true;
+            g_stage.reverb_cleared = 0;
+        }
+        if (g_stage.reverb_cleared < (uint32_t)REVERB_MEM_SAMPLES) {
+            const uint32_t len = min(REVERB_CLEAR_CHUNK_SAMPLES, (uint32_t)REVERB_MEM_SAMPLES - g_stage.reverb_cleared);
+            memset(g_reverbMem + g_stage.reverb_cleared, 0, len * sizeof(int16_t));
+            g_stage.reverb_cleared += len;
+        }
+        memset(rvbL_block, 0, n * sizeof(int16_t));
+        memset(rvbR_block, 0, n * sizeof(int16_t));
+#ifdef PROFILE_ENABLED
+        g_perf.reverb_bypass_blocks++;
+        g_audio_reverb_mask |= (uint8_t)(1u << REVERB_ENGINE_COUNT);
+#endif
+    }
+
+    // フィードバックは量0が FEEDBACK_BUFFER_SIZE 続いたらバッファが全部0なので、書き込みも止める
+    // （0を書き続けた場合とビット一致。量が戻ればそのまま書き込みを再開する）
+    g_stage.feedback_zero = (fb_q15 == 0) ? min(g_stage.feedback_zero + n, (uint32_t)FEEDBACK_BUFFER_SIZE) : 0;
+    g_stage.feedback_idle = (g_stage.feedback_zero >= (uint32_t)FEEDBACK_BUFFER_SIZE);
+#ifdef PROFILE_ENABLED
+    if (g_stage.feedback_idle) g_perf.feedback_bypass_blocks++;
+#endif
+
+    // 6) リバーブMIX・リミッター・フィードバック書き込み・出力
+    for (int i = 0; i < n; i++) {
+        int32_t mixL = mulQ15Wide(granL32_block[i], rvbDry_q15) + mulQ15(rvbL_block[i], rvbMix_q15);
+        int32_t mixR = mulQ15Wide(granR32_block[i], rvbDry_q15) + mulQ15(rvbR_block[i], rvbMix_q15);
+        int16_t outL, outR;
+        g_limiter.process(mixL, mixR, outL, outR);
+
+        if (!g_stage.feedback_idle) {
+#ifdef GRAIN_STEREO_ENABLED
+            feedbackBuffer[fbWritePos] = packFrame(mulQ15Round(outL, fb_q15), mulQ15Round(outR, fb_q15));
+#else
+            feedbackBuffer[fbWritePos] = (int16_t)mulQ15Round(((int32_t)outL + outR) >> 1, fb_q15);
+#endif
+        }
+        fbWritePos = (fbWritePos + 1) & (FEEDBACK_BUFFER_SIZE - 1);
+        i2s_buffer[i2s_buffer_pos++] = outL;
+        i2s_buffer[i2s_buffer_pos++] = outR;
+
+        if (i2s_buffer_pos >= I2S_BUFFER_SAMPLES * 2) {
+            meter.pause();
+            recordAudioHeadroom(meter);
+
+            size_t bytes_written;
+            esp_err_t i2s_result = i2s_write(I2S_NUM_1, i2s_buffer, i2s_buffer_pos*sizeof(int16_t), &bytes_written, portMAX_DELAY);
+            if (g_boot.first_output_us == 0) g_boot.first_output_us = micros();
+
+            // Check for I2S write errors (avoid logging in real-time path to prevent performance degradation)
+            if (i2s_result != ESP_OK) {
+                static uint32_t error_count = 0;
+                error_count++;
+                // Only log every 1000th error to avoid flooding serial output
+                if (error_count % 1000 == 0) {
+                    Serial.printf("WARNING: I2S write error: %d (count: %u)\n", i2s_result, error_count);
+                }
             }
+
+            i2s_buffer_pos = 0;
+            meter.resume();
+        }
+    }
+
+    // リミッターのゲインリダクションを表示タスクへ（ウィンドウ内の最小ゲイン）
+    if (g_limiter.min_gain_q16 < g_limiter_min_gain_q16) g_limiter_min_gain_q16 = g_limiter.min_gain_q16;
+    g_limiter.min_gain_q16 = 65536;
+}
+
+#ifdef DSP_PIPELINE_ENABLED
+// 希望モードへの切り替え（前段のブロック先頭で）。シングルコアへ戻すときは後段がキューを
+// 処理し切るのを待つ（後段の状態 = リバーブ・リミッター・I2Sバッファを2つのタスクが同時に触らない）
+void updatePipelineMode() {
+    const bool request = g_pipeline.request;
+    if (request == g_pipeline.active) return;
+    if (!request) {
+        g_audio_meter.pause();
+        while (__atomic_load_n(&g_pipeline.tail, __ATOMIC_ACQUIRE) != g_pipeline.head) {
+            ulTaskNotifyTake(pdTRUE, 1);
         }
+        g_audio_meter.resume();
+    }
+    g_pipeline.active = request;
+    g_pipeline.switches++;
+}
+
+// 前段を処理して空きスロットに積み、出力タスクを起こす。
+// 2スロットとも埋まっている（後段が遅れている）ときは1つ空くまで待つので、遅延は1ブロックで頭打ち
+void processPipelinedBlock(const AudioFrame* input, int n) {
+    static int samples_since_deadline = 0;
+    const uint32_t head = g_pipeline.head;
+    if (head - __atomic_load_n(&g_pipeline.tail, __ATOMIC_ACQUIRE) >= (uint32_t)PIPELINE_DEPTH) {
+        g_audio_meter.pause();
+        while (head - __atomic_load_n(&g_pipeline.tail, __ATOMIC_ACQUIRE) >= (uint32_t)PIPELINE_DEPTH) {
+            ulTaskNotifyTake(pdTRUE, 1);
+        }
+        g_audio_meter.resume();
+    }
+    processGrainStage(input, n, g_pipeline.slot[head % PIPELINE_DEPTH]);
+    __atomic_store_n(&g_pipeline.head, head + 1, __ATOMIC_RELEASE);
+    xTaskNotifyGive(g_outputTaskHandle);
 
-        i2s_buffer_pos = 0;
+    // 前段の締切余裕（I2S書き込みは後段なので、I2Sブロック分の入力を処理するごとに区切る）
+    samples_since_deadline += n;
+    if (samples_since_deadline >= I2S_BUFFER_SAMPLES) {
+        samples_since_deadline -= I2S_BUFFER_SAMPLES;
+        g_audio_meter.pause();
+        recordAudioHeadroom(g_audio_meter);
+        g_audio_meter.resume();
     }
 }
 
+// 後段（コア0）。積まれたブロックを順に処理し、1つ終えるごとにスロットを返して前段を起こす
+void outputTask(void* param) {
+    Serial.println("DSP output task started on Core 0");
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t tail = g_pipeline.tail;
+        while (tail != __atomic_load_n(&g_pipeline.head, __ATOMIC_ACQUIRE)) {
+            g_output_meter.resume();
+            processOutputStage(g_pipeline.slot[tail % PIPELINE_DEPTH], g_output_meter);
+            g_output_meter.pause();
+            __atomic_store_n(&g_pipeline.tail, ++tail, __ATOMIC_RELEASE);
+            xTaskNotifyGive(g_granularTaskHandle);
+        }
+    }
+}
+#endif
+
+// 1ブロック分の処理。DSP_PIPELINE_ENABLED 時はパイプラインが有効なら前段だけ行って後段を
+// コア0の出力タスクへ渡し（1ブロック遅延）、無効なら従来どおり同じタスクで両段を続けて処理する
+void processAudioBlock(const AudioFrame* input, int n) {
+#ifdef DSP_PIPELINE_ENABLED
+    updatePipelineMode();
+    if (g_pipeline.active) {
+        processPipelinedBlock(input, n);
+        return;
+    }
+#endif
+    static StageBlock blk;
+    processGrainStage(input, n, blk);
+    processOutputStage(blk, g_audio_meter);
+}
+
 void a2dp_data_callback(const uint8_t *data, uint32_t length) {
+    if (g_boot.first_input_us == 0) g_boot.first_input_us = micros();
+#ifdef GRAIN_STEREO_ENABLED
+    // L,R 交互の int16 をフレーム(32bit)のまま積む
+    const uint32_t* frames = (const uint32_t*)data;
+    for (uint32_t i = 0; i < length / 4; i++) {
+        g_ringBuffer.write(frames[i]);
+    }
+#else
     int16_t* samples = (int16_t*)data;
     for(uint32_t i=0; i<length/4; i++) {
         // 32ビットアキュムレータで加算してから除算（解像度の損失を防ぐ）
         int32_t sum = (int32_t)samples[i*2] + (int32_t)samples[i*2+1];
         g_ringBuffer.write((int16_t)(sum >> 1));
     }
+#endif
 }
 
 // ================================================================= //
 // SECTION: Grain Generation & Rendering
 // ================================================================= //
-void handleDejaVuTrigger() {
-    if (!g_grainBufferReady) return;
-    g_trigger_led_on = true;
-    g_trigger_led_start_time = millis();
+// loopTask → granularTask の要求。フラグを一度下ろしてから中身を書き、最後に立てる
+// （granularTask は優先度が高いので、書きかけの中身を前の要求として読むことがない）
+void requestSnapshotSave(GranularEngine& e, int slot, uint32_t seed) {
+    e.save_pending = false;
+    e.save_slot = (uint8_t)slot;
+    e.save_seed = seed;
+    e.save_pending = true;
+}
+
+void requestSnapshotLoad(GranularEngine& e, int slot) {
+    e.load_pending = false;
+    e.load_slot = (uint8_t)slot;
+    e.load_pending = true;
+}
+
+void requestDejaVuRandomize(GranularEngine& e, uint32_t seed) {
+    e.randomize_pending = false;
+    e.randomize_seed = seed;
+    e.randomize_pending = true;
+}
+
+void requestClockResolution(GranularEngine& e, int index) {
+    e.resolution_pending = (int8_t)constrain(index, 0, 6);
+}
 
-    bool replay = (esp_random() % 32768) < g_params.deja_vu_q15;
-    ParamSnapshot params_to_use;
-    int current_step_in_loop = g_deja_vu_step % g_params.loop_length;
+// granularTask がブロックの先頭（クロック処理の前）で呼ぶ。同じブロックに重なった要求は
+// 保存 → ロード → ランダマイズ → 分解能 の順に適用する
+void applyLayerRequests(GranularEngine& e) {
+    if (e.save_pending) {
+        // 保存した時点から乱数列を始め直す → ロードすればここからのトリガー列を再現できる
+        FullParamSnapshot& snap = g_snapshots[e.save_slot];
+        memcpy(snap.deja_vu, e.deja_vu.steps, sizeof(snap.deja_vu));
+        snap.rng_seed = e.save_seed;
+        e.rng.seed(snap.rng_seed);
+        e.deja_vu.step = 0;
+        e.save_pending = false;
+    }
+    if (e.load_pending) {
+        const FullParamSnapshot& snap = g_snapshots[e.load_slot];
+        e.rng.seed(snap.rng_seed);
+        e.deja_vu.restore(snap.deja_vu);
+        e.resolution_index = constrain(snap.resolution_index, 0, 6);
+        e.load_pending = false;
+    }
+    if (e.randomize_pending) {
+        GrainRng rng;
+        rng.seed(e.randomize_seed);
+        randomizeDejaVuSteps(e.deja_vu.steps, rng);
+        e.deja_vu.step = 0;
+        e.randomize_pending = false;
+    }
+    if (e.resolution_pending >= 0) {
+        e.resolution_index = e.resolution_pending;
+        e.resolution_pending = -1;
+    }
+}
+
+void handleDejaVuTrigger(GranularEngine& e) {
+    const GranParams& p = *e.params;
+    if (g_grainHistorySamples == 0) return;  // まだ何も届いていない
+    if (e.index == 0) {
+        // トリガーLEDはメインのレイヤーのクロックを表示する
+        g_trigger_led_on = true;
+        g_trigger_led_start_time = millis();
+    }
 
-    if (replay) {
-        params_to_use = g_deja_vu_buffer[current_step_in_loop];
+    const ParamSnapshot knobs = {p.position_q15, p.size_q15, p.pitch_q8, p.texture_q15};
+    ParamSnapshot params_to_use = e.deja_vu.next(e.rng, knobs, p.deja_vu_q15, p.loop_length);
+
+    if (cloudRateHz(p.density_q15) > 0) {
+        // クラウド動作中はクロックでDeja Vuを進め、クラウドの中心パラメータだけを更新する
+        e.cloud.center = params_to_use;
+        e.cloud.center_valid = true;
     } else {
-        int16_t rand_val = (esp_random() % 65535) - 32767;
-        int32_t pos_offset = ((int32_t)g_params.texture_q15 * rand_val) >> 14;
-        params_to_use.position_q15 = constrain(g_params.position_q15 + pos_offset, 0, 32767);
-        rand_val = (esp_random() % 65535) - 32767;
-        int32_t size_offset = ((int32_t)g_params.texture_q15 * rand_val) >> 15;
-        params_to_use.size_q15 = constrain(g_params.size_q15 + size_offset, 1000, 32767);
+        for (int i = 0; i < MAX_GRAINS; i++) {
+            if (!e.grains[i].active) {
+                triggerGrain(e, i, params_to_use);
+                break;
+            }
+        }
+    }
+}
+
+// 密度つまみ → 毎秒のグレイン数（2乗カーブ）。CLOUD_OFF_Q15 未満は 0 = 停止
+uint32_t cloudRateHz(int16_t density_q15) {
+    if (density_q15 < CLOUD_OFF_Q15) return 0;
+    uint32_t sq_q15 = ((uint32_t)density_q15 * density_q15) >> 15;
+    return CLOUD_MIN_RATE_HZ + (((CLOUD_MAX_RATE_HZ - CLOUD_MIN_RATE_HZ) * sq_q15) >> 15);
+}
 
-        rand_val = (esp_random() % 65535) - 32767;
-        float pitch_offset = (g_params.texture_q15 / 32767.0f) * 5.0f * (rand_val / 32767.0f);
-        params_to_use.pitch_f = g_params.pitch_f + pitch_offset;
-        params_to_use.texture_q15 = g_params.texture_q15;
-        g_deja_vu_buffer[current_step_in_loop] = params_to_use;
+// 1ブロックぶんのクラウド処理。格子点は1ブロックに高々1つしか増えず、取り出しもヒープの
+// 大きさで頭打ちなので、ブロックあたりのコストは密度によらずほぼ一定
+void runCloudScheduler(GranularEngine& e, int n) {
+    CloudScheduler& c = e.cloud;
+    const uint32_t block_end = c.now + n;
+    const uint32_t rate = cloudRateHz(e.params->density_q15);
+    if (rate == 0 || g_grainHistorySamples == 0) {
+        c.count = 0;
+        c.next_grid = block_end;
+        c.now = block_end;
+        return;
     }
 
+    const uint32_t period = 44100 / rate;
+    const uint32_t max_length = max((uint32_t)MIN_GRAIN_SIZE, (MAX_GRAINS * period * CLOUD_VOICE_FILL_Q8) >> 8);
+    // 密度を上げた直後に、低密度のときの遠い格子点を待たない
+    if ((int32_t)(c.next_grid - block_end) > (int32_t)period) c.next_grid = block_end + period;
+    // 格子点を1周期先まで積む（ジッタは ±period/2 以内なので、このブロックの発音はすべてヒープにある）
+    while (c.before(c.next_grid, block_end + period) && c.count < CLOUD_HEAP_SIZE) {
+        int32_t spread = (int32_t)(((int64_t)period * e.params->texture_q15) >> 16);
+        int32_t jitter = (spread * e.rng.bipolarQ15()) >> 15;
+        c.push(c.next_grid + jitter);
+        c.next_grid += period;
+    }
+    while (c.count > 0 && c.before(c.heap[0], block_end)) {
+        int32_t offset = (int32_t)(c.heap[0] - c.now);
+        c.pop();
+        spawnCloudGrain(e, offset < 0 ? 0 : offset, max_length);
+    }
+    c.now = block_end;
+}
+
+// 空きボイスにクラウドのグレインを割り当てる（空きがなければ捨てる）
+void spawnCloudGrain(GranularEngine& e, int offset, uint32_t max_length) {
+    ParamSnapshot params;
+    if (e.cloud.center_valid) {
+        params = e.cloud.center;
+    } else {
+        // クロックが来ていない間はつまみの値をそのまま使う
+        params.position_q15 = e.params->position_q15;
+        params.size_q15 = e.params->size_q15;
+        params.pitch_q8 = e.params->pitch_q8;
+        params.texture_q15 = e.params->texture_q15;
+    }
     for (int i = 0; i < MAX_GRAINS; i++) {
-        if (!g_grains[i].active) {
-            triggerGrain(i, params_to_use);
-            break;
+        if (!e.grains[i].active) {
+            if (!triggerGrain(e, i, params, max_length)) break;  // 履歴がまだ足りない
+            e.grains[i].start_delay = (uint8_t)offset;
+            e.cloud.spawned++;
+#ifdef PROFILE_ENABLED
+            e.perf.cloud_grain_count++;
+#endif
+            return;
         }
     }
-
-    g_deja_vu_step = (g_deja_vu_step + 1) % DEJA_VU_BUFFER_SIZE;
+#ifdef PROFILE_ENABLED
+    e.perf.cloud_dropped_count++;
+#endif
 }
 
 // ================================================================= //
@@ -863,14 +2083,27 @@ void enablePitchSoftTakeover(float pitchSemitones) {
     g_soft_takeover_active_pitch = true;
 }
 
-void randomizeDejaVuBuffer() {
-    // Deja Vuバッファのランダマイズ
+// 半音(float) → Q8.8。非有限値・範囲外はクランプ（UI/ADC側 = loopTask（コア1）専用）
+int16_t pitchSemitonesToQ8(float semitones) {
+    if (!isfinite(semitones)) return 0;
+    if (semitones >  PITCH_RANGE_SEMITONES_HALF) semitones =  PITCH_RANGE_SEMITONES_HALF;
+    if (semitones < -PITCH_RANGE_SEMITONES_HALF) semitones = -PITCH_RANGE_SEMITONES_HALF;
+    return (int16_t)lroundf(semitones * PITCH_Q8_ONE);
+}
+
+// Deja Vu ループをランダムな内容で埋める（シードから決まるので、オーディオタスクでもスナップショットでも使える）
+void randomizeDejaVuSteps(ParamSnapshot* steps, GrainRng& rng) {
     for (int i = 0; i < DEJA_VU_BUFFER_SIZE; i++) {
-        g_deja_vu_buffer[i].position_q15 = esp_random() % 32768;
-        g_deja_vu_buffer[i].size_q15     = 1000 + (esp_random() % 31767);
-        g_deja_vu_buffer[i].pitch_f      = (float)((esp_random() % 240) - 120) / 10.0f;
-        g_deja_vu_buffer[i].texture_q15  = esp_random() % 32768;
+        steps[i].position_q15 = rng.uniformQ15();
+        steps[i].size_q15     = 1000 + (rng.next() % 31767);
+        steps[i].pitch_q8     = (int16_t)((((int32_t)(rng.next() % 240) - 120) * PITCH_Q8_ONE) / 10);
+        steps[i].texture_q15  = rng.uniformQ15();
     }
+}
+
+void randomizeDejaVuBuffer() {
+    // Deja Vuバッファのランダマイズ（ループ・ステップ・分解能はオーディオタスクが書く）
+    requestDejaVuRandomize(g_layers[0], esp_random());
 
     // 現在のパラメータもランダマイズ
     g_params.position_q15     = esp_random() % 32768;
@@ -883,150 +2116,446 @@ void randomizeDejaVuBuffer() {
 
     // 0.0f～1.0fのランダムなfloatを生成し、pitch範囲に変換する
     float random_float = (float)esp_random() / (float)UINT32_MAX;
-    g_params.pitch_f = PITCH_RANDOM_MIN + (PITCH_RANDOM_RANGE * random_float);
+    g_params.pitch_q8 = pitchSemitonesToQ8(PITCH_RANDOM_MIN + (PITCH_RANDOM_RANGE * random_float));
 
     g_params.loop_length      = 2 + (esp_random() % (DEJA_VU_BUFFER_SIZE - 1));
-    g_params.mode             = (esp_random() % 2 == 0) ?
-    MODE_GRANULAR : MODE_REVERSE;
+    g_params.mode             = (PlayMode)(esp_random() % PLAY_MODE_COUNT);
     g_pot4_mode               = (Pot4Mode)(esp_random() % POT4_MODE_COUNT);
-    g_current_resolution_index = esp_random() % (sizeof(g_resolutions) / sizeof(g_resolutions[0]));
+    requestClockResolution(g_layers[0], esp_random() % (sizeof(g_resolutions) / sizeof(g_resolutions[0])));
 
-    g_deja_vu_step = 0;
     // ★ ピッチつまみ用ソフトテイクオーバー有効化
-    enablePitchSoftTakeover(g_params.pitch_f);
+    enablePitchSoftTakeover((float)g_params.pitch_q8 / PITCH_Q8_ONE);
     // 演出（フラッシュ表示）
     g_randomize_flash_active = true;
     g_randomize_flash_start  = millis();
     invalidateDisplayCache();
 }
 
-void triggerGrain(int idx, const ParamSnapshot& params) {
-    if (idx < 0 || idx >= MAX_GRAINS) return;
-    Grain& g = g_grains[idx];
-    g.length = calculateGrainLength(params.size_q15, params.texture_q15);
-    g.startPos = calculateGrainStartPosition(params.position_q15, params.texture_q15);
-    g.speed_q16 = calculateGrainSpeed(params.pitch_f, params.texture_q15);
-    calculateGrainPanning(g.panL_q15, g.panR_q15);
-    g.position_q16 = (g_params.mode == MODE_REVERSE) ? (int32_t)(g.length - 1) << 16 : 0;
-    uint16_t lut_idx = ((g.length - MIN_GRAIN_SIZE) * (RECIPROCAL_LUT_SIZE - 1)) / (MAX_GRAIN_SIZE - MIN_GRAIN_SIZE);
-    g.reciprocal_length_q32 = g_reciprocal_lut_q32[min(lut_idx, (uint16_t)(RECIPROCAL_LUT_SIZE - 1))];
+// 窓の位相増分 = |速度| / 長さ（1.0 = 2^32）。除算はトリガー時の1回だけで、
+// 長さのLUT量子化がないので窓はグレインの実際の再生時間にぴったり合う
+inline void initGrainEnvelope(Grain& g, EnvShape shape) {
+    g.env_shape = shape;
+    g.env_phase = 0;
+    g.env_inc = (uint32_t)(((uint64_t)abs(g.speed_q16) << 16) / g.length);
+}
+
+#ifdef GRAIN_TIERED_ENABLED
+// 寿命中に読む範囲がずっと原音段に残っているか。どちらの向きでも最も古い位置 startPos は
+// 寿命の終わりまで読まれうるので、今の遡り量 + 寿命（出力サンプル）+ 補間タップで見積もる
+inline bool grainFitsRecentTier(const Grain& g) {
+    uint32_t lookback = (g_grainWritePos - g.startPos) & GRAIN_BUFFER_MASK;
+    uint32_t life = (uint32_t)(((uint64_t)g.length << 16) / (uint32_t)abs(g.speed_q16));
+    return (uint64_t)lookback + life + 4 < GRAIN_RECENT_SIZE;
+}
+#endif
+
+// 開始位置（補間の1つ前のタップまで）が書き込み済みの履歴に入っているか。
+// 起動直後でも、その位置まで溜まっていればすぐに鳴らせる（位置つまみが手前ほど早い）
+inline bool grainHistoryCovers(const Grain& g) {
+    if (g_grainHistorySamples >= GRAIN_BUFFER_SIZE) return true;
+    uint32_t lookback = (g_grainWritePos - g.startPos) & GRAIN_BUFFER_MASK;
+    return lookback + 1 < g_grainHistorySamples;
+}
+
+// 履歴が足りず発音できなかったときは false（ボイスは空いたまま）
+// max_length はクラウドが密度に合わせて短くするときの上限
+bool triggerGrain(GranularEngine& e, int idx, const ParamSnapshot& params, uint32_t max_length) {
+    if (idx < 0 || idx >= MAX_GRAINS) return false;
+    Grain& g = e.grains[idx];
+    g.length = min(calculateGrainLength(e, params.size_q15, params.texture_q15), max_length);
+    g.startPos = calculateGrainStartPosition(e, params.position_q15, params.texture_q15);
+    g.speed_q16 = calculateGrainSpeed(e, params.pitch_q8, params.texture_q15);
+    calculateGrainPanning(e, g.panL_q15, g.panR_q15);
+    if (!grainHistoryCovers(g)) return false;
+#ifdef GRAIN_MIPMAP_ENABLED
+    // 速度が一定なので段はトリガー時に1回決める
+    g.mip_level = (g.speed_q16 >= GRAIN_MIP_SPEED_L2_Q16) ? 2 : (g.speed_q16 >= GRAIN_MIP_SPEED_L1_Q16) ? 1 : 0;
+#endif
+#ifdef GRAIN_TIERED_ENABLED
+    // 寿命の途中で原音段から押し出される範囲を読むグレインは、最初からアーカイブ段で読む
+    g.archive = !grainFitsRecentTier(g);
+#ifdef PROFILE_ENABLED
+    if (g.archive) e.perf.archive_grain_count++;
+#endif
+#endif
+    initGrainEnvelope(g, e.params->env_shape);
+    g.start_delay = 0;
+
+    // 再生方向はここで確定し、符号付き速度と開始位置に畳み込む
+    // （再生中にモードを切り替えても鳴っているグレインの向きは変わらない）
+    bool reverse = (e.params->mode == MODE_REVERSE);
+    if (e.params->mode == MODE_RANDOM_DIR) {
+        reverse = e.rng.uniformQ15() < e.params->reverse_prob_q15;
+    }
+    if (reverse) {
+        g.speed_q16 = -g.speed_q16;
+        g.position_q16 = (int64_t)(g.length - 1) << 16;
+    } else {
+        g.position_q16 = 0;
+    }
     g.active = true;
 
     bool found = false;
-    for(uint8_t i=0; i<g_activeGrainCount; i++) {
-        if(g_activeGrainIndices[i]==idx) found=true;
+    for(uint8_t i=0; i<e.activeGrainCount; i++) {
+        if(e.activeGrainIndices[i]==idx) found=true;
     }
-    if(!found && g_activeGrainCount<MAX_GRAINS) {
-        g_activeGrainIndices[g_activeGrainCount++]=idx;
+    if(!found && e.activeGrainCount<MAX_GRAINS) {
+        e.activeGrainIndices[e.activeGrainCount++]=idx;
     }
+    return true;
 }
 
-void renderAllGrains(int32_t& wetL, int32_t& wetR) {
-    if (!g_grainBufferReady || g_activeGrainCount == 0) return;
+// INTERP_AUTO を発音数で解決する（ブロック先頭で1回）
+inline InterpMode resolveInterpMode(InterpMode mode, uint8_t voices) {
+    if (mode != INTERP_AUTO) return mode;
+    return (voices <= INTERP_HERMITE_MAX_VOICES) ? INTERP_HERMITE : INTERP_LINEAR;
+}
 
-    // グレイン数に応じたゲイン補正を取得（クリッピング防止）
-    int16_t gain_scale_q15 = GRAIN_GAIN_SCALE_Q15[g_activeGrainCount];
+// audible = false のときは出力を作らずに位置・窓の位相・寿命だけ進める（無音区間・ウェット0）
+void renderAllGrains(GranularEngine& e, int32_t* wetL, int32_t* wetR, int n, bool audible) {
+    if (e.activeGrainCount == 0) return;
 
-    for (uint8_t i = 0; i < g_activeGrainCount; ) {
-        uint8_t grain_idx = g_activeGrainIndices[i];
-        Grain& grain = g_grains[grain_idx];
-        int16_t sample = renderGrain(grain);
+    // グレイン数に応じたゲイン補正を取得（クリッピング防止）
+    // 発音数・補間方式はブロック先頭の値で固定する（途中で終わったグレインもこのブロックは同じゲイン）
+    int16_t gain_scale_q15 = GRAIN_GAIN_SCALE_Q15[e.activeGrainCount];
+    if (e.index > 0) {
+        // レイヤー1以降は dryWet_q15 をレイヤーの音量として掛ける（ドライ/ウェットはレイヤー0の値で全体に）
+        gain_scale_q15 = (int16_t)mulQ15(gain_scale_q15, e.params->dryWet_q15);
+        audible = audible && gain_scale_q15 != 0;
+    }
+    InterpMode interp = resolveInterpMode(e.params->interp_mode, e.activeGrainCount);
+#ifdef PROFILE_ENABLED
+    e.perf.interp_mode = interp;
+#endif
+
+    for (uint8_t i = 0; i < e.activeGrainCount; ) {
+        uint8_t grain_idx = e.activeGrainIndices[i];
+        Grain& grain = e.grains[grain_idx];
+        if (audible) renderGrainBlock(grain, interp, gain_scale_q15, wetL, wetR, n);
+        else         advanceGrainBlock(grain, n);
 
         if (grain.active) {
-            // ゲイン補正を適用してからパンニング
-            int32_t scaled_sample = ((int32_t)sample * gain_scale_q15) >> 15;
-            wetL += (scaled_sample * grain.panL_q15) >> 15;
-            wetR += (scaled_sample * grain.panR_q15) >> 15;
             i++;
         } else {
-            for (uint8_t j = i; j < g_activeGrainCount - 1; j++) {
-                g_activeGrainIndices[j] = g_activeGrainIndices[j+1];
+            for (uint8_t j = i; j < e.activeGrainCount - 1; j++) {
+                e.activeGrainIndices[j] = e.activeGrainIndices[j+1];
             }
-            g_activeGrainCount--;
+            e.activeGrainCount--;
         }
     }
 }
 
-int16_t renderGrain(Grain& g) {
-    uint16_t pos_int = g.position_q16 >> 16;
-    if (pos_int >= g.length) {
-        g.active = false;
-        return 0;
-    }
+// 補間カーネル（固定小数点）。xm1..x2 は idx-1..idx+2 のサンプル、frac は Q16 の小数部
+// （リニアは x0/x1 だけを使う）
+template <InterpMode M>
+inline int32_t interpolateKernel(int32_t xm1, int32_t x0, int32_t x1, int32_t x2, uint32_t frac) {
+    if (M == INTERP_LINEAR) {
+        // リニア補間: x0 + (x1 - x0) * frac（差分が±65535まで振れるのでfracはQ15に落として掛ける）
+        return lerpQ15(x0, x1, (int32_t)(frac >> 1));
+    }
+    if (M == INTERP_HERMITE) {
+        // 4点3次Hermite（Catmull-Rom）。係数は2倍スケールで持ち、最後に1/2する
+        int32_t c1 = x1 - xm1;
+        int32_t c2 = 2 * xm1 - 5 * x0 + 4 * x1 - x2;
+        int32_t c3 = 3 * (x0 - x1) + x2 - xm1;
+        int32_t t = (int32_t)frac;  // 係数は int16 の数倍まで広がるので mulQ16（32×32→上位）で掛ける
+        return x0 + (mulQ16(mulQ16(mulQ16(c3, t) + c2, t) + c1, t) >> 1);
+    }
+
+    // 4タップ・ポリフェーズ窓付きsinc（位相は小数部の上位ビット、係数の和は1.0）
+    const int16_t* h = g_sinc_lut_q15[frac >> (16 - SINC_PHASE_BITS)];
+    return (xm1 * h[0] + x0 * h[1] + x1 * h[2] + x2 * h[3]) >> 15;
+}
+
+// モノラルのリングバッファから読む。4点系は idx-1..idx+2 を読む（マスクで折り返す）
+template <InterpMode M>
+inline int32_t interpolateGrainSample(const int16_t* buf, uint32_t mask, uint32_t idx, uint32_t frac) {
+    int32_t x0 = buf[idx & mask];
+    int32_t x1 = buf[(idx + 1) & mask];
+    if (M == INTERP_LINEAR) return interpolateKernel<M>(0, x0, x1, 0, frac);
+    return interpolateKernel<M>(buf[(idx - 1) & mask], x0, x1, buf[(idx + 2) & mask], frac);
+}
+
+#ifdef GRAIN_ULAW_ENABLED
+// 圧縮履歴版: 1点につきバイトロード + デコード表1回。コード間に依存がないのでブロック単位の
+// 展開は要らず、どのグレインも任意の位置から読める
+template <InterpMode M>
+inline int32_t interpolateGrainCode(const uint8_t* buf, uint32_t mask, uint32_t idx, uint32_t frac) {
+    const int16_t* lut = g_grain_decode_lut;
+    int32_t x0 = lut[buf[idx & mask]];
+    int32_t x1 = lut[buf[(idx + 1) & mask]];
+    if (M == INTERP_LINEAR) return interpolateKernel<M>(0, x0, x1, 0, frac);
+    return interpolateKernel<M>(lut[buf[(idx - 1) & mask]], x0, x1, lut[buf[(idx + 2) & mask]], frac);
+}
+#endif
+
+#ifdef GRAIN_TIERED_ENABLED
+// アーカイブ段から読む。履歴座標 a + frac を段の座標へ（整数部 a >> 2、下位2bitは小数部に繰り込む）
+template <InterpMode M>
+inline int32_t interpolateArchiveSample(uint32_t a, uint32_t frac) {
+    constexpr uint32_t LOW_MASK = (1u << GRAIN_ARCHIVE_SHIFT) - 1;
+    uint32_t f = (((a & LOW_MASK) << 16) | frac) >> GRAIN_ARCHIVE_SHIFT;
+    return interpolateGrainCode<M>(g_grainArchive, GRAIN_ARCHIVE_SIZE - 1, a >> GRAIN_ARCHIVE_SHIFT, f);
+}
 
-    // リニア補間によるアンチエイリアシング
-    uint16_t base_pos = (g_params.mode == MODE_REVERSE) ? g.length-1-pos_int : pos_int;
-    uint16_t read_idx1 = (g.startPos + base_pos) & GRAIN_BUFFER_MASK;
-    uint16_t read_idx2 = (g.startPos + base_pos + 1) & GRAIN_BUFFER_MASK;
+#endif
+
+#ifdef GRAIN_STEREO_ENABLED
+// ステレオ版: 1点につき32bitロード1回で L/R を取り、同じカーネルを両チャンネルに掛ける
+template <InterpMode M>
+inline void interpolateGrainFrame(const AudioFrame* buf, uint32_t mask, uint32_t idx, uint32_t frac,
+                                  int32_t& outL, int32_t& outR) {
+    AudioFrame f0 = buf[idx & mask];
+    AudioFrame f1 = buf[(idx + 1) & mask];
+    if (M == INTERP_LINEAR) {
+        outL = interpolateKernel<M>(0, frameL(f0), frameL(f1), 0, frac);
+        outR = interpolateKernel<M>(0, frameR(f0), frameR(f1), 0, frac);
+        return;
+    }
+    AudioFrame fm1 = buf[(idx - 1) & mask];
+    AudioFrame f2 = buf[(idx + 2) & mask];
+    outL = interpolateKernel<M>(frameL(fm1), frameL(f0), frameL(f1), frameL(f2), frac);
+    outR = interpolateKernel<M>(frameR(fm1), frameR(f0), frameR(f1), frameR(f2), frac);
+}
+#endif
+
+// 窓テーブルの線形補間（上位 ENV_LUT_BITS がインデックス、続く15bitが小数部）
+inline int16_t envLutLookup(const int16_t* lut, uint32_t phase) {
+    uint32_t idx = phase >> (32 - ENV_LUT_BITS);
+    int32_t frac = (phase >> (32 - ENV_LUT_BITS - 15)) & 0x7FFF;
+    int32_t a = lut[idx];
+    return (int16_t)lerpQ15(a, lut[idx + 1], frac);
+}
 
-    int16_t sample1 = g_grainBuffer[read_idx1];
-    int16_t sample2 = g_grainBuffer[read_idx2];
+// 平坦部を持つ形状の区間境界（両端1/8 → 区間内の位置は位相を3bit左シフトするだけで出る）
+constexpr int ENV_EDGE_SHIFT = 3;
+constexpr uint32_t ENV_ATTACK_END = 1u << (32 - ENV_EDGE_SHIFT);
+constexpr uint32_t ENV_RELEASE_START = 0u - ENV_ATTACK_END;
+
+// 1グレイン分の窓を n サンプル書き出して位相を進める（形状の分岐はブロック先頭で1回）
+// Tukey/台形の平坦部は位相の加算と定数の書き込みだけ。終端を越えた分はレンダラ側で使われない
+void fillGrainEnvelope(Grain& g, int16_t* env, int n) {
+    uint32_t phase = g.env_phase;
+    const uint32_t inc = g.env_inc;
+    switch (g.env_shape) {
+        case ENV_TUKEY:
+        case ENV_TRAPEZOID: {
+            const bool tukey = (g.env_shape == ENV_TUKEY);
+            int i = 0;
+            while (i < n) {
+                if (phase < ENV_ATTACK_END) {
+                    uint32_t seg = phase << ENV_EDGE_SHIFT;
+                    env[i++] = tukey ? envLutLookup(g_env_taper_lut_q15, seg) : (int16_t)(seg >> 17);
+                    phase += inc;
+                } else if (phase < ENV_RELEASE_START) {
+                    // 平坦部: 加算のみ
+                    while (i < n && phase >= ENV_ATTACK_END && phase < ENV_RELEASE_START) {
+                        env[i++] = 32767;
+                        phase += inc;
+                    }
+                } else {
+                    uint32_t seg = (~phase) << ENV_EDGE_SHIFT;
+                    env[i++] = tukey ? envLutLookup(g_env_taper_lut_q15, seg) : (int16_t)(seg >> 17);
+                    phase += inc;
+                }
+            }
+            break;
+        }
+        case ENV_EXP_DECAY:
+            for (int i = 0; i < n; i++) { env[i] = envLutLookup(g_env_exp_lut_q15, phase); phase += inc; }
+            break;
+        default:
+            for (int i = 0; i < n; i++) { env[i] = envLutLookup(g_env_hann2_lut_q15, phase); phase += inc; }
+            break;
+    }
+    g.env_phase = phase;
+}
 
-    // Q16フォーマットの小数部分を取得（0-65535の範囲）
-    uint16_t frac = g.position_q16 & 0xFFFF;
+// 1グレインを count サンプル分レンダリングして wetL/wetR に加算する（count 分はすべてグレイン内）
+// 補間方式はテンプレート引数で固定し、方向は符号付きの step に畳み込んであるので
+// ループ内には方向・終端・グローバル設定の分岐がない。ゲイン補正はパン係数に畳み込む
+// （ステレオ時はパンが L/R のバランスになる）
+template <InterpMode M>
+void renderGrainSpan(Grain& g, const int16_t* env, int16_t gain_q15, int32_t* wetL, int32_t* wetR, int count) {
+    const int32_t step = g.speed_q16;
+    const uint32_t start = g.startPos;
+    const int32_t panL = ((int32_t)g.panL_q15 * gain_q15) >> 15;
+    const int32_t panR = ((int32_t)g.panR_q15 * gain_q15) >> 15;
+    int64_t pos = g.position_q16;
+#ifdef GRAIN_MIPMAP_ENABLED
+    const uint32_t level = g.mip_level;
+    const int16_t* buf = g_grainMipBuffers[level];
+    const uint32_t mask = GRAIN_BUFFER_MASK >> level;
+    const uint32_t level_frac_mask = (1u << level) - 1;
+#endif
+#ifdef GRAIN_TIERED_ENABLED
+    const bool archive = g.archive;
+#endif
+
+    for (int i = 0; i < count; i++) {
+        uint32_t a = start + (uint32_t)(pos >> 16);
+#ifdef GRAIN_MIPMAP_ENABLED
+        // 原音位置 a + frac を段の座標へ: 整数部 a >> L、小数部は a の下位Lビットを繰り込んでQ16に戻す
+        uint32_t frac = (((a & level_frac_mask) << 16) | ((uint32_t)pos & 0xFFFF)) >> level;
+        int32_t sample = interpolateGrainSample<M>(buf, mask, a >> level, frac);
+        int32_t windowed_sample = mulQ15(sample, env[i]);
+        wetL[i] = macQ15(wetL[i], windowed_sample, panL);
+        wetR[i] = macQ15(wetR[i], windowed_sample, panR);
+#elif defined(GRAIN_STEREO_ENABLED)
+        int32_t sampleL, sampleR;
+        interpolateGrainFrame<M>(g_grainBuffer, GRAIN_BUFFER_MASK, a, (uint32_t)pos & 0xFFFF, sampleL, sampleR);
+        wetL[i] = macQ15(wetL[i], mulQ15(sampleL, env[i]), panL);
+        wetR[i] = macQ15(wetR[i], mulQ15(sampleR, env[i]), panR);
+#else
+#if defined(GRAIN_COMPRESSED_ENABLED)
+        int32_t sample = interpolateGrainCode<M>(g_grainBuffer, GRAIN_BUFFER_MASK, a, (uint32_t)pos & 0xFFFF);
+#elif defined(GRAIN_TIERED_ENABLED)
+        // 段はトリガー時に決めてあり、ループ中は変わらない
+        int32_t sample = archive ? interpolateArchiveSample<M>(a, (uint32_t)pos & 0xFFFF)
+                                 : interpolateGrainSample<M>(g_grainBuffer, GRAIN_RECENT_MASK, a, (uint32_t)pos & 0xFFFF);
+#else
+        int32_t sample = interpolateGrainSample<M>(g_grainBuffer, GRAIN_BUFFER_MASK, a, (uint32_t)pos & 0xFFFF);
+#endif
+        int32_t windowed_sample = mulQ15(sample, env[i]);
+        wetL[i] = macQ15(wetL[i], windowed_sample, panL);
+        wetR[i] = macQ15(wetR[i], windowed_sample, panR);
+#endif
+        pos += step;
+    }
+    g.position_q16 = pos;
+}
 
-    // リニア補間: sample1 + (sample2 - sample1) * frac
-    int32_t interpolated = (int32_t)sample1 + (((int32_t)(sample2 - sample1) * frac) >> 16);
-    int16_t sample = (int16_t)interpolated;
+// このブロックで鳴らせるサンプル数。方向ごとにブロック末尾の位置を1回見るだけで、
+// 終端を含むブロック（グレインの寿命で1回）だけ残りを数える
+inline int grainRunLength(const Grain& g, int n) {
+    const int64_t pos = g.position_q16;
+    const int32_t step = g.speed_q16;
+    const int64_t last = pos + (int64_t)step * (n - 1);
+    int count = 0;
+    if (step >= 0) {
+        const int64_t end = (int64_t)g.length << 16;
+        if (last < end) return n;
+        for (int64_t p = pos; count < n && p < end; p += step) count++;
+    } else {
+        if (last >= 0) return n;
+        for (int64_t p = pos; count < n && p >= 0; p += step) count++;
+    }
+    return count;
+}
 
-    uint16_t window_idx = ((uint32_t)pos_int * g.reciprocal_length_q32) >> 25;
-    int16_t window_val = g_window_lut_q15[min((uint16_t)window_idx, (uint16_t)(WINDOW_LUT_SIZE-1))];
-    int32_t windowed_sample = (int32_t)sample * window_val;
+void renderGrainBlock(Grain& g, InterpMode mode, int16_t gain_q15, int32_t* wetL, int32_t* wetR, int n) {
+    // ブロック途中で発音したグレインはオフセットまで飛ばす（オフセットは常にブロック長未満）
+    if (g.start_delay > 0) {
+        int d = g.start_delay;
+        g.start_delay = 0;
+        wetL += d;
+        wetR += d;
+        n -= d;
+    }
+    int count = grainRunLength(g, n);
+    if (count > 0) {
+        int16_t env[AUDIO_BLOCK_SIZE];
+        fillGrainEnvelope(g, env, count);
+        switch (mode) {
+            case INTERP_HERMITE: renderGrainSpan<INTERP_HERMITE>(g, env, gain_q15, wetL, wetR, count); break;
+            case INTERP_SINC:    renderGrainSpan<INTERP_SINC>(g, env, gain_q15, wetL, wetR, count); break;
+            default:             renderGrainSpan<INTERP_LINEAR>(g, env, gain_q15, wetL, wetR, count); break;
+        }
+    }
+    if (count < n) g.active = false;
+}
 
-    g.position_q16 += (g_params.mode == MODE_REVERSE) ? -g.speed_q16 : g.speed_q16;
-    if (g.position_q16 < 0) {
-        g.active = false;
+// renderGrainBlock() と同じだけ状態を進める（レンダリングはしない）
+void advanceGrainBlock(Grain& g, int n) {
+    if (g.start_delay > 0) {
+        n -= g.start_delay;
+        g.start_delay = 0;
     }
+    int count = grainRunLength(g, n);
+    g.position_q16 += (int64_t)g.speed_q16 * count;
+    g.env_phase += g.env_inc * (uint32_t)count;
+    if (count < n) g.active = false;
+}
 
-    return (int16_t)(windowed_sample >> 15);
+#if defined(PROFILE_ENABLED) && defined(GRAIN_ULAW_ENABLED)
+// 圧縮履歴の S/N（起動時に1回）。正弦波+ノイズを -6 / -30 dBFS で符号化→復号し、
+// 誤差パワーとの比を dB ×10 で出す。あわせてエンコード1サンプルのサイクル数も測る
+void benchmarkGrainCodec() {
+    constexpr int N = 4096;
+    static const float LEVELS[2] = {0.5f, 0.0316f};  // -6 dBFS, -30 dBFS
+    GrainRng rng;
+    for (int l = 0; l < 2; l++) {
+        rng.seed(0xC0DEC);
+        double sig = 0.0, err = 0.0;
+        uint32_t cycles = 0;
+        for (int i = 0; i < N; i++) {
+            float v = 0.7f * sinf(2.0f * PI * 441.0f * i / 44100.0f) + 0.3f * rng.bipolarQ15() / 32767.0f;
+            int32_t x = (int32_t)(v * LEVELS[l] * 32767.0f);
+            uint32_t start = ESP.getCycleCount();
+            uint8_t code = encodeGrainSample(x);
+            cycles += ESP.getCycleCount() - start;
+            int32_t e = g_grain_decode_lut[code] - x;
+            sig += (double)x * x;
+            err += (double)e * e;
+        }
+        g_perf.grain_codec_snr_db_x10[l] = (int16_t)(100.0 * log10(sig / (err > 0.0 ? err : 1.0)));
+        g_perf.grain_codec_encode_cycles_x10 = (uint16_t)((cycles * 10) / N);
+    }
 }
+#endif
+
+#ifdef PROFILE_ENABLED
+// 補間カーネルのサイクル計測（起動時に1回）。1グレインを非整数速度で数ブロック回し、
+// cycles/sample ×10 をパフォーマンスレポートに出す。1回目はキャッシュを温めるだけで捨てる
+void benchmarkInterpolation() {
+    constexpr int BENCH_BLOCKS = 16;
+    static int32_t wetL[AUDIO_BLOCK_SIZE], wetR[AUDIO_BLOCK_SIZE];
+    for (int pass = 0; pass < 2; pass++) {
+        for (int m = 0; m < INTERP_KERNEL_COUNT; m++) {
+            Grain g;
+            g.reset();
+            g.startPos = 0;
+            g.length = MAX_GRAIN_SIZE;
+            g.speed_q16 = 98304 + 1234;  // ≈1.5倍（小数部が毎サンプル変わる）
+            initGrainEnvelope(g, ENV_HANN2);
+            g.active = true;
+
+            uint32_t start = ESP.getCycleCount();
+            for (int b = 0; b < BENCH_BLOCKS; b++) {
+                renderGrainBlock(g, (InterpMode)m, 32767, wetL, wetR, AUDIO_BLOCK_SIZE);
+            }
+            uint32_t cycles = ESP.getCycleCount() - start;
+            g_perf.interp_cycles_x10[m] = (uint16_t)((cycles * 10) / (BENCH_BLOCKS * AUDIO_BLOCK_SIZE));
+        }
+    }
+#ifdef GRAIN_ULAW_ENABLED
+    benchmarkGrainCodec();
+#endif
+}
+#endif
 
-uint16_t calculateGrainLength(int16_t base_size, int16_t texture) {
-    int16_t rand_val = g_random_lut_q15[(g_random_index++)&(RANDOM_LUT_SIZE-1)];
+uint32_t calculateGrainLength(GranularEngine& e, int16_t base_size, int16_t texture) {
+    int16_t rand_val = e.rng.bipolarQ15();
     int32_t size_rand_comp = ((int32_t)texture * rand_val) >> 15;
     int16_t size_q15 = constrain(base_size + (size_rand_comp >> 1), MIN_SIZE_Q15, 32767);
-    return MIN_GRAIN_SIZE + (((uint32_t)(MAX_GRAIN_SIZE - MIN_GRAIN_SIZE) * size_q15) >> 15);
+    return MIN_GRAIN_SIZE + (uint32_t)(((uint64_t)(MAX_GRAIN_SIZE - MIN_GRAIN_SIZE) * size_q15) >> 15);
 }
 
-uint16_t calculateGrainStartPosition(int16_t base_pos, int16_t texture) {
-    int16_t rand_val = g_random_lut_q15[(g_random_index++)&(RANDOM_LUT_SIZE-1)];
-    int32_t pos_rand_comp = (int32_t)((((int32_t)texture * rand_val) >> 15) * POSITION_TEXTURE_SCALE);
+uint32_t calculateGrainStartPosition(GranularEngine& e, int16_t base_pos, int16_t texture) {
+    int16_t rand_val = e.rng.bipolarQ15();
+    int32_t pos_rand_comp = ((((int32_t)texture * rand_val) >> 15) * 3) / 5;  // POSITION_TEXTURE_SCALE (3/5)
     int16_t pos_q15 = constrain(base_pos + pos_rand_comp, 0, 32767);
-    uint32_t lookback = ((uint32_t)GRAIN_BUFFER_SIZE * pos_q15) >> 15;
+    uint32_t lookback = (uint32_t)(((uint64_t)GRAIN_BUFFER_SIZE * pos_q15) >> 15);
     return (g_grainWritePos - lookback + GRAIN_BUFFER_SIZE) & GRAIN_BUFFER_MASK;
 }
 
-int32_t calculateGrainSpeed(float base_pitch, int16_t texture) {
-    int16_t rand_val = g_random_lut_q15[(g_random_index++)&(RANDOM_LUT_SIZE-1)];
-    float pitch_rand_comp = (texture/32767.0f) * PITCH_TEXTURE_VARIANCE * (rand_val/32767.0f);
-    float pitch = base_pitch + pitch_rand_comp;
-
-    // ★★★ 変更点：事前計算した定数を使って割り算を掛け算に置き換え ★★★
-    float index_f = (pitch + PITCH_RANGE_SEMITONES_HALF) * PITCH_LUT_SCALE;
-
-    index_f = constrain(index_f,0.0f,PITCH_LUT_SIZE-2.0f);
-
-    int index_i = (int)index_f;
-    int32_t frac_q8 = (int32_t)((index_f - index_i) * 256.0f);
-    int32_t y0 = g_pitch_lut_q16[index_i], y1 = g_pitch_lut_q16[index_i+1];
-    int32_t speed = y0 + (((y1 - y0) * frac_q8) >> 8);
-    return constrain(speed, 1<<14, 4<<16);
+// トリガー経路は整数のみ（オーディオタスクでFPUを使わない = FPUコンテキスト退避が起きない）
+int32_t calculateGrainSpeed(GranularEngine& e, int16_t base_pitch_q8, int16_t texture) {
+    return grainSpeedQ16(g_pitch_lut_q16, base_pitch_q8, texture, e.rng.bipolarQ15());
 }
 
-void calculateGrainPanning(int16_t& panL, int16_t& panR) {
-    float pan_random = g_random_pan_lut[(g_random_pan_index++)&(RANDOM_PAN_LUT_SIZE-1)];
-    float pan = 0.5f+(g_params.stereoSpread_q15/32767.0f)*STEREO_SPREAD_SCALE*pan_random;
-    pan = constrain(pan,0.0f,1.0f);
-
-    float pan_index_f = pan*(PAN_LUT_SIZE-1);
-    int pan_index_i = constrain((int)pan_index_f,0,PAN_LUT_SIZE-2);
-    int32_t frac_q8 = (int32_t)((pan_index_f-pan_index_i)*256.0f);
-    panR = g_pan_lut_q15[pan_index_i]+(((g_pan_lut_q15[pan_index_i+1]-g_pan_lut_q15[pan_index_i])*frac_q8)>>8);
-
-    float pan_index_l_f = (PAN_LUT_SIZE-1)-pan_index_f;
-    int pan_index_l_i = constrain((int)pan_index_l_f,0,PAN_LUT_SIZE-2);
-    int32_t frac_l_q8 = (int32_t)((pan_index_l_f-pan_index_l_i)*256.0f);
-    panL = g_pan_lut_q15[pan_index_l_i]+(((g_pan_lut_q15[pan_index_l_i+1]-g_pan_lut_q15[pan_index_l_i])*frac_l_q8)>>8);
+void calculateGrainPanning(GranularEngine& e, int16_t& panL, int16_t& panR) {
+    grainPanQ15(g_pan_lut_q15, e.params->stereoSpread_q15, e.rng.bipolarQ15(), panL, panR);
 }
 
 // ================================================================= //
@@ -1037,13 +2566,13 @@ void updateTempo(unsigned long tap_time_us) {
     if (last_any_tap_time_us > 0) {
         unsigned long interval = tap_time_us - last_any_tap_time_us;
         if (interval > MIN_TEMPO_INTERVAL_US && interval < MAX_TEMPO_INTERVAL_US) {
-            g_beat_interval_us = interval;
-            g_current_bpm = 60000000.0f / g_beat_interval_us;
+            g_beat_interval_us = interval;  // BPM 表示への換算（float）は表示タスク側で行う
         }
     }
 
     last_any_tap_time_us = tap_time_us;
-    g_next_internal_trigger_time_us = tap_time_us;
+    // 全レイヤーのクロックをタップ位置に揃える（分解能はレイヤーごと）
+    for (int k = 0; k < GRAIN_LAYERS; k++) g_layers[k].next_trigger_time_us = tap_time_us;
     // 物理LED用のタイマーも、このタイミングでリセット（同期）する
     g_next_raw_beat_time_us = tap_time_us;
 
@@ -1098,8 +2627,8 @@ void updateParametersFromPots() {
                             break;
                         }
                         case MODE_CLK_RESOLUTION: {
-                            int resolution = map(smoothed_adc_val, 0, 4095, 0, 6);
-                            g_current_resolution_index = constrain(resolution, 0, 6);
+                            int resolution = constrain(map(smoothed_adc_val, 0, 4095, 0, 6), 0, 6);
+                            if (resolution != g_layers[0].resolution_index) requestClockResolution(g_layers[0], resolution);
                             break;
                         }
                         case MODE_REVERB_MIX:
@@ -1109,6 +2638,9 @@ void updateParametersFromPots() {
                             g_params.reverb_room_q15 = (int16_t)(val_f * 32767.0f);
                             updateReverbParams(g_params.reverb_room_q15);
                             break;
+                        case MODE_DENSITY:
+                            g_params.density_q15 = (int16_t)(val_f * 32767.0f);
+                            break;
                     }
                     break;
                 case 4: { // ★ ピッチ（ソフトテイクオーバー対応）
@@ -1135,10 +2667,7 @@ void updateParametersFromPots() {
                         g_soft_takeover_active_pitch = false;
                     }
 
-                    g_params.pitch_f = (val_f - 0.5f) * PITCH_RANGE_SEMITONES;
-                    if (!isfinite(g_params.pitch_f)) g_params.pitch_f = 0.0f;
-                    if (g_params.pitch_f >  PITCH_RANGE_SEMITONES_HALF) g_params.pitch_f =  PITCH_RANGE_SEMITONES_HALF;
-                    if (g_params.pitch_f < -PITCH_RANGE_SEMITONES_HALF) g_params.pitch_f = -PITCH_RANGE_SEMITONES_HALF;
+                    g_params.pitch_q8 = pitchSemitonesToQ8((val_f - 0.5f) * PITCH_RANGE_SEMITONES);
 
                     last_val_f[4] = val_f;
                     break;
@@ -1156,13 +2685,9 @@ void updateParametersFromPots() {
 // ================================================================= //
 void initializeSnapshots() {
     Serial.println("Initializing snapshots with random parameters...");
-    // Deja Vuバッファも起動時にランダム化
-    for (int i = 0; i < DEJA_VU_BUFFER_SIZE; i++) {
-        g_deja_vu_buffer[i].position_q15 = esp_random() % 32768;
-        g_deja_vu_buffer[i].size_q15     = 1000 + (esp_random() % 31767);
-        g_deja_vu_buffer[i].pitch_f      = (float)((esp_random() % 240) - 120) / 10.0f;
-        g_deja_vu_buffer[i].texture_q15  = esp_random() % 32768;
-    }
+    // Deja Vuループもスナップショットごとにランダム化（ロードでレイヤー0へ入る）
+    GrainRng rng;
+    rng.seed(esp_random());
 
     for (int i = 0; i < 4; i++) {
         g_snapshots[i].position_q15     = esp_random() % 32768;
@@ -1173,24 +2698,27 @@ void initializeSnapshots() {
         g_snapshots[i].feedback_q15     = g_feedback_lut_q15[esp_random() % FEEDBACK_LUT_SIZE];
         // 0.0f～1.0fのランダムなfloatを生成し、pitch範囲に変換する
         float random_float = (float)esp_random() / (float)UINT32_MAX;
-        g_snapshots[i].pitch_f = PITCH_RANDOM_MIN + (PITCH_RANDOM_RANGE * random_float);
+        g_snapshots[i].pitch_q8 = pitchSemitonesToQ8(PITCH_RANDOM_MIN + (PITCH_RANDOM_RANGE * random_float));
 
         g_snapshots[i].loop_length  = 2 + (esp_random() % (DEJA_VU_BUFFER_SIZE - 1));
-        g_snapshots[i].mode         = (esp_random() % 2 == 0) ? MODE_GRANULAR : MODE_REVERSE;
+        g_snapshots[i].mode         = (PlayMode)(esp_random() % PLAY_MODE_COUNT);
         g_snapshots[i].pot4_mode    = (Pot4Mode)(esp_random() % POT4_MODE_COUNT);
         g_snapshots[i].resolution_index = 3 + (esp_random() % 4);
         g_snapshots[i].dryWet_q15   = (i < 3) ? 32767 : 0;
         g_snapshots[i].reverb_mix_q15  = esp_random() % 32768;  // リバーブMIX
         g_snapshots[i].reverb_room_q15 = esp_random() % 32768;  // ルームサイズ
+        g_snapshots[i].density_q15     = 0;                     // 起動直後はクロック駆動
+        g_snapshots[i].rng_seed        = esp_random();
+        randomizeDejaVuSteps(g_snapshots[i].deja_vu, rng);
 
         g_snapshots_initialized[i] = true;
     }
 
-    // スナップショット1をロード → この中で g_params.pitch_f が設定される
+    // スナップショット1をロード → この中で g_params.pitch_q8 が設定される
     loadSnapshot(0);
     // ★ ピッチつまみ用ソフトテイクオーバー有効化
-    // ランダムで決まった g_params.pitch_f に対応する物理つまみの正規化位置(0..1)を計算
-    enablePitchSoftTakeover(g_params.pitch_f);
+    // ランダムで決まった g_params.pitch_q8 に対応する物理つまみの正規化位置(0..1)を計算
+    enablePitchSoftTakeover((float)g_params.pitch_q8 / PITCH_Q8_ONE);
 
     Serial.println("Initialization complete. Snapshot 1 loaded.");
 }
@@ -1204,13 +2732,17 @@ void saveSnapshot(int slot) {
     g_snapshots[slot].stereoSpread_q15 = g_params.stereoSpread_q15;
     g_snapshots[slot].feedback_q15 = g_params.feedback_q15;
     g_snapshots[slot].dryWet_q15 = g_params.dryWet_q15;
-    g_snapshots[slot].pitch_f = g_params.pitch_f;
+    g_snapshots[slot].pitch_q8 = g_params.pitch_q8;
     g_snapshots[slot].loop_length = g_params.loop_length;
     g_snapshots[slot].reverb_mix_q15 = g_params.reverb_mix_q15;   // リバーブMIX
     g_snapshots[slot].reverb_room_q15 = g_params.reverb_room_q15; // ルームサイズ
+    g_snapshots[slot].density_q15 = g_params.density_q15;
     g_snapshots[slot].mode = g_params.mode;
     g_snapshots[slot].pot4_mode = g_pot4_mode;
-    g_snapshots[slot].resolution_index = g_current_resolution_index;
+    g_snapshots[slot].resolution_index = g_layers[0].resolution_index;
+    // 乱数のシードと Deja Vu ループはオーディオタスクが次のブロックの先頭で写し、同時に再シードする
+    // （保存した時点から乱数列を始め直す → ロードすればここからのトリガー列を再現できる）
+    requestSnapshotSave(g_layers[0], slot, esp_random());
     g_snapshots_initialized[slot] = true;
     g_snapshot_flash_active = true;
     g_snapshot_flash_start = millis();
@@ -1218,39 +2750,81 @@ void saveSnapshot(int slot) {
 
     Serial.printf("Snapshot %d saved\n", slot + 1);
 }
+// スナップショットのうちレイヤーごとに持つ値を反映する（レイヤー1以降では dryWet_q15 = レイヤーの音量）
+void applySnapshotToLayer(int slot, GranularEngine& e) {
+    const FullParamSnapshot& snap = g_snapshots[slot];
+    GranParams& p = *e.params;
+    p.position_q15     = snap.position_q15;
+    p.size_q15         = snap.size_q15;
+    p.deja_vu_q15      = snap.deja_vu_q15;
+    p.texture_q15      = snap.texture_q15;
+    p.stereoSpread_q15 = snap.stereoSpread_q15;
+    p.dryWet_q15       = snap.dryWet_q15;
+    p.pitch_q8         = snap.pitch_q8;
+    p.loop_length      = snap.loop_length;
+    p.mode             = snap.mode;
+    p.density_q15      = snap.density_q15;
+    // 乱数・Deja Vu ループ・CLK（分解能）はオーディオタスクが次のブロックの先頭で戻す
+    requestSnapshotLoad(e, slot);
+}
+
 void loadSnapshot(int slot) {
     if (slot < 0 || slot >= 4 || !g_snapshots_initialized[slot]) {
         Serial.printf("Snapshot %d not initialized\n", slot + 1);
         return;
     }
 
-    g_params.position_q15     = g_snapshots[slot].position_q15;
-    g_params.size_q15         = g_snapshots[slot].size_q15;
-    g_params.deja_vu_q15      = g_snapshots[slot].deja_vu_q15;
-    g_params.texture_q15      = g_snapshots[slot].texture_q15;
-    g_params.stereoSpread_q15 = g_snapshots[slot].stereoSpread_q15;
+    // グレイン側（位置・サイズ・ピッチ・Deja Vu・クロック分解能・乱数シード）はレイヤー0へ
+    applySnapshotToLayer(slot, g_layers[0]);
     g_params.feedback_q15     = g_snapshots[slot].feedback_q15;
-    g_params.dryWet_q15       = g_snapshots[slot].dryWet_q15;
-    g_params.pitch_f          = g_snapshots[slot].pitch_f;
-    g_params.loop_length      = g_snapshots[slot].loop_length;
-    g_params.mode             = g_snapshots[slot].mode;
     g_params.reverb_mix_q15   = g_snapshots[slot].reverb_mix_q15;   // リバーブMIX
     g_params.reverb_room_q15  = g_snapshots[slot].reverb_room_q15;  // ルームサイズ
     updateReverbParams(g_params.reverb_room_q15);  // リバーブパラメータ更新
-    // ★ ここを追加：CLK（分解能）をスナップショットから復元
-    int idx = g_snapshots[slot].resolution_index;
-    if (!isfinite((float)idx)) idx = 3;
-    // 念のため
-    g_current_resolution_index = constrain(idx, 0, 6);
-    // 安全に丸める（×1以上に限定したいなら 3,6 に）
 
     // ★ ピッチつまみ用ソフトテイクオーバー有効化
-    enablePitchSoftTakeover(g_params.pitch_f);
+    enablePitchSoftTakeover((float)g_params.pitch_q8 / PITCH_Q8_ONE);
 
     invalidateDisplayCache();
     Serial.printf("Snapshot %d loaded\n", slot + 1);
 }
 
+#if GRAIN_LAYERS > 1
+// スナップショットのグレイン側の値だけを上のレイヤーへ（MODE を押したままスナップショットボタン）
+void loadSnapshotToLayer(int slot, GranularEngine& e) {
+    if (slot < 0 || slot >= 4 || !g_snapshots_initialized[slot] || e.index == 0) return;
+    applySnapshotToLayer(slot, e);
+    g_snapshot_flash_active = true;
+    g_snapshot_flash_start = millis();
+    g_snapshot_flash_number = slot + 1;
+    Serial.printf("Snapshot %d loaded into layer %d\n", slot + 1, e.index);
+}
+#endif
+
+// レイヤーの初期化。レイヤー1以降は g_params の既定値から、遅いクロックの逆再生パッドとして始める
+// （ゆっくり長いグレインを1オクターブ下で。音量は dryWet_q15 = 50%）
+void initGranularLayers() {
+    g_layers[0].init(0, &g_params);
+    g_layers[0].rng.seed(esp_random());
+#if GRAIN_LAYERS > 1
+    for (int k = 1; k < GRAIN_LAYERS; k++) {
+        GranParams& p = g_layer_params[k];
+        p = g_params;
+        p.mode = MODE_REVERSE;
+        p.position_q15 = 16384;
+        p.size_q15 = 29491;
+        p.deja_vu_q15 = 0;
+        p.texture_q15 = 6554;
+        p.pitch_q8 = -12 * PITCH_Q8_ONE;
+        p.dryWet_q15 = 16384;
+        g_layers[k].init(k, &p);
+        g_layers[k].rng.seed(esp_random());
+        g_layers[k].resolution_index = 0;  // 1/4（4拍に1回）
+        randomizeDejaVuSteps(g_layers[k].deja_vu.steps, g_layers[k].rng);
+    }
+    Serial.printf("Granular layers: %d (even: Core 1, odd: Core 0)\n", GRAIN_LAYERS);
+#endif
+}
+
 // ================================================================= //
 // SECTION: Button Handling
 // ================================================================= //
@@ -1292,11 +2866,10 @@ void updateMainButton() {
         unsigned long pressDuration = millis() - g_button.pressStartTime;
         if (pressDuration < BUTTON_LONG_PRESS_MS) {
             unsigned long now_us = micros();
-            updateTempo(now_us);
-
-            if (g_last_manual_tap_time_us == 0 || (now_us - g_last_manual_tap_time_us >= TAP_TEMPO_TIMEOUT_US)) {
-                handleDejaVuTrigger();
-            }
+            // 適用は granularTask。フラグは最後に立てる（向こうは優先度が高く、読み取り中にこちらへ戻らない）
+            g_manual_tap_time_us = now_us;
+            g_manual_tap_restart = (g_last_manual_tap_time_us == 0 || (now_us - g_last_manual_tap_time_us >= TAP_TEMPO_TIMEOUT_US));
+            g_manual_tap_pending = true;
 
             g_last_manual_tap_time_us = now_us;
         } else {
@@ -1312,7 +2885,7 @@ void randomizeClockResolution() {
     // ×1以上（1.0, 2.0, 3.0, 4.0）からランダム選択 → インデックス 3..6
     const int min_idx = 3;
     const int max_idx = 6;
-    g_current_resolution_index = min_idx + (esp_random() % (max_idx - min_idx + 1));
+    requestClockResolution(g_layers[0], min_idx + (esp_random() % (max_idx - min_idx + 1)));
 
     g_randomize_flash_active = true;
     g_randomize_flash_start = millis();
@@ -1328,6 +2901,9 @@ void updatePot4Button() {
     if (g_pot4_button.lastState == LOW && g_pot4_button.currentState == HIGH) {
         if (millis() - g_pot4_button.pressStartTime < BUTTON_LONG_PRESS_MS) {
             g_pot4_mode = (Pot4Mode)((g_pot4_mode + 1) % POT4_MODE_COUNT);
+        } else {
+            // 長押し：リバーブエンジン切り替え（Freeverb → FDN4 → FDN8）
+            g_params.reverb_engine = (ReverbEngine)((g_params.reverb_engine + 1) % REVERB_ENGINE_COUNT);
         }
     }
 
@@ -1342,10 +2918,15 @@ void updateModeButton() {
 
     if (g_mode_button.lastState == LOW && g_mode_button.currentState == HIGH) {
         unsigned long pressDuration = millis() - g_mode_button.pressStartTime;
+#if GRAIN_LAYERS > 1
+        if (g_mode_chord_used) {
+            // スナップショットとの同時押しに使っただけなので、MODE 自体の動作はしない
+            g_mode_chord_used = false;
+        } else
+#endif
         if (pressDuration < BUTTON_LONG_PRESS_MS) {
             // 短押し：再生モードを切り替え
-            g_params.mode = (g_params.mode == MODE_GRANULAR) ?
-            MODE_REVERSE : MODE_GRANULAR;
+            g_params.mode = (PlayMode)((g_params.mode + 1) % PLAY_MODE_COUNT);
         } else {
             // 長押し：全スナップショットを再ランダマイズ
             initializeSnapshots();
@@ -1371,6 +2952,12 @@ void updateSnapshotButtons() {
             if (pressDuration >= BUTTON_LONG_PRESS_MS) {
                 // 長押し：現在の設定を押されたボタンのスロットに保存
                 saveSnapshot(i);
+#if GRAIN_LAYERS > 1
+            } else if (g_mode_button.currentState == LOW) {
+                // MODE を押したまま短押し：スナップショットをレイヤー1へロード
+                loadSnapshotToLayer(i, g_layers[1]);
+                g_mode_chord_used = true;
+#endif
             } else {
                 // 短押し：スナップショットをロード
                 loadSnapshot(i);
@@ -1388,98 +2975,204 @@ void updateAllButtons() {
     updateSnapshotButtons();
 }
 
+// ================================================================= //
+// SECTION: Display Task & Frame Scheduler (Core 0)
+// ================================================================= //
+void displayTask(void* param) {
+    Serial.println("Display task started on Core 0");
+    const TickType_t frame_ticks = pdMS_TO_TICKS(DISPLAY_UPDATE_INTERVAL_MS);
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (true) {
+        int64_t frame_start_us = esp_timer_get_time();
+
+        // フラッシュ画面の終了処理（以前は loop() で実施）
+        if (g_randomize_flash_active && millis() - g_randomize_flash_start > RANDOMIZE_FLASH_DURATION_MS) {
+            g_randomize_flash_active = false;
+            if (!g_snapshot_flash_active) restoreFlashRegion();
+        }
+        if (g_snapshot_flash_active && millis() - g_snapshot_flash_start > RANDOMIZE_FLASH_DURATION_MS) {
+            g_snapshot_flash_active = false;
+            if (!g_randomize_flash_active) restoreFlashRegion();
+        }
+        if (g_display_cache_invalid) {
+            g_display_cache_invalid = false;
+            invalidateAllWidgets();
+        }
+
+        // ビジュアライザは負荷に応じて間引く（パラメータ表示は毎フレーム）
+        bool draw_viz = (++g_frame_sched.frame_counter >= g_frame_sched.viz_divider);
+        if (draw_viz) g_frame_sched.frame_counter = 0;
+
+        PROFILE_START(updateDisplay);
+        updateDisplay(draw_viz);
+        PROFILE_END(updateDisplay);
+
+        uint32_t frame_us = (uint32_t)(esp_timer_get_time() - frame_start_us);
+        updateFrameScheduler(frame_us, draw_viz);
+
+        // フレームペーシング: 処理落ちした場合は基準時刻を取り直し、連続描画で追いつこうとしない
+        TickType_t now = xTaskGetTickCount();
+        if (now - last_wake >= frame_ticks) {
+            last_wake = now;
+            vTaskDelay(1);  // 低優先度タスクにも必ず譲る
+        } else {
+            vTaskDelayUntil(&last_wake, frame_ticks);
+        }
+    }
+}
+
+// フレームコストの記録とビジュアライザフレームレートの自動調整
+void updateFrameScheduler(uint32_t frame_us, bool drew_visualizer) {
+    FrameScheduler& fs = g_frame_sched;
+    fs.frame_cost_avg_us += ((int32_t)frame_us - (int32_t)fs.frame_cost_avg_us) >> 3;
+    fs.frames_in_window++;
+    if (drew_visualizer) fs.viz_frames_in_window++;
+    profileRecordFrame(frame_us);
+
+    unsigned long now = millis();
+    unsigned long elapsed = now - fs.window_start_ms;
+    if (elapsed < FRAME_SCHED_EVAL_INTERVAL_MS) return;
+
+    fs.fps_x10 = (uint16_t)((fs.frames_in_window * 10000UL) / elapsed);
+    fs.viz_fps_x10 = (uint16_t)((fs.viz_frames_in_window * 10000UL) / elapsed);
+    fs.frames_in_window = 0;
+    fs.viz_frames_in_window = 0;
+    fs.window_start_ms = now;
+
+    // 負荷指標: コア0負荷（BTスタック + UI）とオーディオ締切までの最小余裕
+    // コア負荷メーターを更新するのはここだけ（パフォーマンスレポートは load_pct を読むだけ）
+    updateCoreLoad();
+    uint8_t core0_load = g_coreLoad[0].load_pct;
+    uint8_t headroom = g_audio_headroom_min_pct;
+    g_audio_headroom_min_pct = 100;
+    int32_t limiter_min_gain_q16 = g_limiter_min_gain_q16;
+    g_limiter_min_gain_q16 = 65536;
+    // DSP の処理時間の割合（I2S待ちを除く。us / (ms × 10) = %）
+    static uint32_t last_dsp1_total_us = 0;
+    uint32_t dsp1_total_us = g_audio_meter.total_us;
+    uint8_t dsp_core1_pct = (uint8_t)min((dsp1_total_us - last_dsp1_total_us) / (elapsed * 10), 100UL);
+    last_dsp1_total_us = dsp1_total_us;
+    uint8_t dsp_core0_pct = 0;
+#ifdef DSP_PIPELINE_ENABLED
+    // パイプラインの可否は後段を除いたコア0負荷（BTスタック + UI）で決める
+    // （後段自身の負荷で切り替えが振動しないように）
+    static uint32_t last_dsp0_total_us = 0;
+    uint32_t dsp0_total_us = g_output_meter.total_us;
+    dsp_core0_pct = (uint8_t)min((dsp0_total_us - last_dsp0_total_us) / (elapsed * 10), 100UL);
+    last_dsp0_total_us = dsp0_total_us;
+    uint8_t core0_other = (core0_load > dsp_core0_pct) ? core0_load - dsp_core0_pct : 0;
+    if (core0_other > PIPELINE_CORE0_HIGH_PCT) g_pipeline.request = false;
+    else if (core0_other < PIPELINE_CORE0_LOW_PCT) g_pipeline.request = true;
+#endif
+    // フレーム自体が周期に収まっていない場合も過負荷とみなす
+    bool frame_overrun = fs.frame_cost_avg_us > DISPLAY_UPDATE_INTERVAL_MS * 1000UL;
+
+    if (core0_load > CORE0_LOAD_HIGH_PCT || headroom < AUDIO_HEADROOM_LOW_PCT || frame_overrun) {
+        if (fs.viz_divider < VIZ_DIVIDER_MAX) fs.viz_divider++;
+    } else if (core0_load < CORE0_LOAD_LOW_PCT && headroom >= AUDIO_HEADROOM_OK_PCT) {
+        if (fs.viz_divider > 1) fs.viz_divider--;
+    }
+
+#ifdef PROFILE_ENABLED
+    g_perf.display_fps_x10 = fs.fps_x10;
+    g_perf.viz_fps_x10 = fs.viz_fps_x10;
+    g_perf.viz_divider = fs.viz_divider;
+    g_perf.audio_headroom_min_pct = headroom;
+    g_perf.dsp_core1_pct = dsp_core1_pct;
+    g_perf.dsp_core0_pct = dsp_core0_pct;
+    uint8_t active_grains = 0;
+    for (int k = 0; k < GRAIN_LAYERS; k++) active_grains += g_layers[k].activeGrainCount;
+    g_perf.dsp_active_grains = active_grains;
+#ifdef DSP_PIPELINE_ENABLED
+    const bool mode_changed = g_pipeline.switches != g_perf.pipeline_switches;
+    g_perf.pipeline_active = g_pipeline.active;
+    g_perf.pipeline_switches = g_pipeline.switches;
+#else
+    const bool mode_changed = false;
+#endif
+    // 持続した発音数: 窓の間ずっと同じ構成（モード × リバーブ）で、最小余裕が0より大きかった窓の
+    // 最小発音数。構成ごとにその最大を残す（起動時ベンチマークからの見積もりではなく実測）
+    uint8_t grains_min = g_audio_grains_min;
+    g_audio_grains_min = 255;
+    uint8_t reverb_mask = g_audio_reverb_mask;
+    g_audio_reverb_mask = 0;
+    if (headroom > 0 && !mode_changed && grains_min != 255 && reverb_mask != 0 && (reverb_mask & (reverb_mask - 1)) == 0) {
+        int slot = __builtin_ctz(reverb_mask);
+        uint8_t& best = g_perf.max_sustained_grains[g_perf.pipeline_active ? 1 : 0][slot];
+        if (grains_min > best) best = grains_min;
+    }
+    // ゲインリダクション [dB ×10]（ウィンドウ内の最大と、レポート間の最大）
+    uint16_t gr_db_x10 = (uint16_t)(-200.0f * log10f(max(limiter_min_gain_q16, (int32_t)1) / 65536.0f));
+    g_perf.limiter_gr_db_x10 = gr_db_x10;
+    if (gr_db_x10 > g_perf.max_limiter_gr_db_x10) g_perf.max_limiter_gr_db_x10 = gr_db_x10;
+#endif
+}
+
 // ================================================================= //
 // SECTION: User Interface
 // ================================================================= //
 
 // Display helper: Handle flash screen messages
-// Returns true if a flash screen was shown (indicating early return)
+// Returns true while a flash banner is shown (indicating early return).
+// バナーは表示開始時に1回だけ描き、終了時は restoreFlashRegion() でその矩形だけを復元する
 bool updateFlashScreens() {
-    if (g_randomize_flash_active) {
-        tft.fillScreen(TFT_WHITE);
+    static int shown_flash = 0;  // 0=なし, 1=RANDOM!, 2..5=SNAPSHOT n
+
+    int flash = 0;
+    if (g_randomize_flash_active) flash = 1;
+    else if (g_snapshot_flash_active) flash = 1 + g_snapshot_flash_number;
+
+    if (flash == 0) {
+        shown_flash = 0;
+        return false;
+    }
+    if (flash == shown_flash) return true;
+    shown_flash = flash;
+
+    if (flash == 1) {
+        tft.fillRect(UI_FLASH_X, UI_FLASH_Y, UI_FLASH_W, UI_FLASH_H, TFT_WHITE);
+        tft.drawRect(UI_FLASH_X, UI_FLASH_Y, UI_FLASH_W, UI_FLASH_H, TFT_RED);
         tft.setTextColor(TFT_RED, TFT_WHITE);
         tft.setTextSize(4);
-        tft.setCursor(50, 100);
+        tft.setCursor(UI_FLASH_X + 36, UI_FLASH_Y + 24);
         tft.print("RANDOM!");
-        return true;
-    }
-
-    if (g_snapshot_flash_active) {
-        tft.fillScreen(TFT_BLACK);
+    } else {
+        tft.fillRect(UI_FLASH_X, UI_FLASH_Y, UI_FLASH_W, UI_FLASH_H, TFT_BLACK);
+        tft.drawRect(UI_FLASH_X, UI_FLASH_Y, UI_FLASH_W, UI_FLASH_H, TFT_GREEN);
         tft.setTextColor(TFT_GREEN, TFT_BLACK);
         tft.setTextSize(3);
-        tft.setCursor(40, 90);
+        tft.setCursor(UI_FLASH_X + 30, UI_FLASH_Y + 12);
         tft.print("SNAPSHOT ");
         tft.print(g_snapshot_flash_number);
-        tft.setCursor(70, 120);
+        tft.setCursor(UI_FLASH_X + 66, UI_FLASH_Y + 44);
         tft.print("SAVED!");
-        return true;
     }
-
-    return false;
+    tft.setTextSize(1);
+    return true;
 }
 
-// Display helper: Update Pot4 mode label highlighting
-void updatePot4ModeLabels(uint16_t txt_color, uint16_t bg_color, uint16_t highlight_color) {
-    if (g_pot4_mode == g_display_cache.pot4_mode) {
-        return;
-    }
-
-    const char* labels1[] = {"POS", "SIZ", "DEJA", "TEX", "FBK", "CLK", "LOOP"};
-    const char* labels2[] = {"PIT", "MIX", "GRNS", "SPR", "MODE", "BT", "POT4"};
+// フラッシュバナーの下にあった背景と区切り線を復元し、重なるウィジェットを再描画対象にする
+// （以前は drawUiFrame() で 320x240 全面を塗り直していた）
+void restoreFlashRegion() {
+    uint16_t bg_color = g_inverse_mode ? TFT_WHITE : TFT_BLACK;
+    uint16_t line_color = g_inverse_mode ? TFT_LIGHTGREY : TFT_DARKGREY;
+    const int x = UI_FLASH_X, y = UI_FLASH_Y, w = UI_FLASH_W, h = UI_FLASH_H;
 
-    // Clear old highlighted label
-    tft.setTextColor(txt_color, bg_color);
-    Pot4Mode old_mode = g_display_cache.pot4_mode;
-    switch(old_mode) {
-        case MODE_TEXTURE:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 3 + 2);
-            tft.print(labels1[3]);
-            break;
-        case MODE_SPREAD:
-            tft.setCursor(UI_COL2_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 3 + 2);
-            tft.print(labels2[3]);
-            break;
-        case MODE_FEEDBACK:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 4 + 2);
-            tft.print(labels1[4]);
-            break;
-        case MODE_CLK_RESOLUTION:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5 + 2);
-            tft.print(labels1[5]);
-            break;
-        case MODE_LOOP_LENGTH:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6 + 2);
-            tft.print(labels1[6]);
-            break;
+    // パラメータ領域（区切り線より上）
+    if (y < VIZ_AREA_Y_START) {
+        tft.fillRect(x, y, w, min(y + h, VIZ_AREA_Y_START) - y, bg_color);
     }
-
-    // Highlight new label
-    tft.setTextColor(highlight_color, bg_color);
-    switch(g_pot4_mode) {
-        case MODE_TEXTURE:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 3 + 2);
-            tft.print(labels1[3]);
-            break;
-        case MODE_SPREAD:
-            tft.setCursor(UI_COL2_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 3 + 2);
-            tft.print(labels2[3]);
-            break;
-        case MODE_FEEDBACK:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 4 + 2);
-            tft.print(labels1[4]);
-            break;
-        case MODE_CLK_RESOLUTION:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5 + 2);
-            tft.print(labels1[5]);
-            break;
-        case MODE_LOOP_LENGTH:
-            tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6 + 2);
-            tft.print(labels1[6]);
-            break;
+    // ビジュアライザ領域（白背景）。パーティクル領域は次のスプライト転送で上書きされる
+    int viz_top = max(y, VIZ_AREA_Y_START + 1);
+    int viz_bottom = min(y + h, VIZ_PARTICLE_Y_START - 1);
+    if (viz_bottom > viz_top) {
+        tft.fillRect(x, viz_top, w, viz_bottom - viz_top, GET_VISUALIZER_BG_COLOR());
     }
+    tft.drawFastHLine(x, VIZ_AREA_Y_START, w, line_color);
+    tft.drawFastHLine(x, VIZ_PARTICLE_Y_START - 1, w, line_color);
 
-    g_display_cache.pot4_mode = g_pot4_mode;
+    uiInvalidateRect(x, y, w, h);
 }
 
 // Display helper: Update trigger LED animation
@@ -1504,79 +3197,77 @@ void updateTriggerLED() {
     }
 }
 
-void updateDisplay() {
+void updateDisplay(bool draw_visualizer) {
     // Handle flash screen messages (RANDOM! / SNAPSHOT SAVED!)
     if (updateFlashScreens()) {
         return;
     }
 
-    tft.setTextSize(1);
+    // 値をウィジェットへ反映（表示が変わるものだけが dirty になる）
+    uiSetParam(UIW_POS_BAR, g_params.position_q15);
+    uiSetPitch(UIW_PIT_BAR, (float)g_params.pitch_q8 / PITCH_Q8_ONE);
+    uiSetParam(UIW_SIZ_BAR, g_params.size_q15);
+    uiSetParam(UIW_MIX_BAR, g_params.dryWet_q15);
+    uiSetParam(UIW_DEJA_BAR, g_params.deja_vu_q15);
+    uiSetParam(UIW_RVB_BAR, g_params.reverb_mix_q15);
+    uiSetParam(UIW_TEX_BAR, g_params.texture_q15);
+    uiSetParam(UIW_ROOM_BAR, g_params.reverb_room_q15);
+    uiSetParam(UIW_FBK_BAR, g_params.feedback_q15);
+    uiSetParam(UIW_SPR_BAR, g_params.stereoSpread_q15);
+
+    char text[UI_TEXT_MAX_CHARS + 1];
+    uiSetText(g_ui_widgets[UIW_CLK_TEXT], g_resolution_names[g_layers[0].resolution_index]);
+    bool is_bt_connected = a2dp_sink.is_connected();
+    uiSetTextColor(g_ui_widgets[UIW_BT_TEXT], is_bt_connected ? TFT_BLUE : TFT_DARKGREY);
+    uiSetText(g_ui_widgets[UIW_BT_TEXT], is_bt_connected ? "CONN" : "----");
+    snprintf(text, sizeof(text), "%d steps", g_params.loop_length);
+    uiSetText(g_ui_widgets[UIW_LOOP_TEXT], text);
+    // クラウドの達成レート（要求値ではなく実際に発音できた数。ボイス不足・履歴不足で下がる）
+    static uint32_t cloud_last_spawned = 0;
+    static unsigned long cloud_last_ms = 0;
+    static uint32_t cloud_achieved_hz = 0;
+    const unsigned long now_ms = millis();
+    if (now_ms - cloud_last_ms >= CLOUD_RATE_WINDOW_MS) {
+        const uint32_t spawned = g_layers[0].cloud.spawned;
+        cloud_achieved_hz = ((spawned - cloud_last_spawned) * 1000 + (now_ms - cloud_last_ms) / 2) / (now_ms - cloud_last_ms);
+        cloud_last_spawned = spawned;
+        cloud_last_ms = now_ms;
+    }
+    if (g_pot4_mode == MODE_DENSITY) {
+        if (cloudRateHz(g_params.density_q15) > 0) snprintf(text, sizeof(text), "DENS %u/s", (unsigned)cloud_achieved_hz);
+        else                                        snprintf(text, sizeof(text), "DENS OFF");
+        uiSetText(g_ui_widgets[UIW_POT4_TEXT], text);
+    } else if (g_pot4_mode == MODE_REVERB_MIX || g_pot4_mode == MODE_REVERB_ROOM) {
+        // リバーブ系はエンジン名も出す（長押しで切り替えたことが分かるように）
+        snprintf(text, sizeof(text), "%s %s", g_pot4_mode == MODE_REVERB_MIX ? "MIX" : "ROOM",
+                 getReverbEngineString(g_params.reverb_engine));
+        uiSetText(g_ui_widgets[UIW_POT4_TEXT], text);
+    } else {
+        uiSetText(g_ui_widgets[UIW_POT4_TEXT], getPot4ModeString(g_pot4_mode));
+    }
+    // Compact BPM / grain count display (white background, black text)
+    snprintf(text, sizeof(text), "%.1fBPM", 60000000.0f / g_beat_interval_us);
+    uiSetText(g_ui_widgets[UIW_BPM_TEXT], text);
+    snprintf(text, sizeof(text), "%d/%dgrn", g_layers[0].activeGrainCount, MAX_GRAINS);
+    uiSetText(g_ui_widgets[UIW_GRAIN_TEXT], text);
+
+    // Pot4 mode label highlighting
     uint16_t txt_color = g_inverse_mode ? TFT_BLACK : TFT_WHITE;
-    uint16_t bg_color = g_inverse_mode ? TFT_WHITE : TFT_BLACK;
-    uint16_t highlight_color = TFT_YELLOW;
-
-    // Update Pot4 mode label highlighting
-    updatePot4ModeLabels(txt_color, bg_color, highlight_color);
-
-    tft.setTextColor(txt_color, bg_color);
-    drawParameterBar(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 0, g_params.position_q15, g_display_cache.position_q15, TFT_SKYBLUE);
-    drawPitchBar(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 0, g_params.pitch_f, g_display_cache.pitch_f, TFT_AQUA);
-    drawParameterBar(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 1, g_params.size_q15, g_display_cache.size_q15, TFT_SKYBLUE);
-    drawParameterBar(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 1, g_params.dryWet_q15, g_display_cache.dryWet_q15, TFT_LIGHTBLUE);
-    drawParameterBar(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 2, g_params.deja_vu_q15, g_display_cache.deja_vu_q15, TFT_SKYBLUE);
-    drawParameterBar(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 2, g_params.reverb_mix_q15, g_display_cache.reverb_mix_q15, 0x0410);  // RVB (teal)
-    drawParameterBar(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 3, g_params.texture_q15, g_display_cache.texture_q15, TFT_AQUA);
-    drawParameterBar(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 3, g_params.reverb_room_q15, g_display_cache.reverb_room_q15, 0x8010);  // ROOM (purple)
-    drawParameterBar(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 4, g_params.feedback_q15, g_display_cache.feedback_q15, TFT_AQUA);
-    drawParameterBar(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 4, g_params.stereoSpread_q15, g_display_cache.stereoSpread_q15, TFT_AQUA);
-    if (g_current_resolution_index != g_display_cache.resolution_index) {
-        g_display_cache.resolution_index = g_current_resolution_index;
-        tft.fillRect(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5, 60, 10, bg_color);
-        tft.setCursor(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5 + 2);
-        tft.print(g_resolution_names[g_current_resolution_index]);
+    for (int i = 0; i < UI_LABEL_COUNT; i++) {
+        bool highlighted = (g_pot4_mode == UI_LABEL_POT4_MODE[i]);
+        uiSetTextColor(g_ui_widgets[UIW_LABEL_FIRST + i], highlighted ? TFT_YELLOW : txt_color);
+    }
+
+    uint32_t spi_bytes = uiRenderWidgets(UI_SPI_BYTE_BUDGET);
+#ifdef PROFILE_ENABLED
+    g_perf.ui_spi_bytes = spi_bytes;
+    if (spi_bytes > g_perf.max_ui_spi_bytes) g_perf.max_ui_spi_bytes = spi_bytes;
+#endif
+
+    // Draw particle visualizer (decimated by the frame scheduler under load)
+    if (draw_visualizer) {
+        drawParticleVisualizer();
     }
-    bool is_bt_connected = a2dp_sink.is_connected();
-    if (is_bt_connected != g_display_cache.bt_connected) {
-        g_display_cache.bt_connected = is_bt_connected;
-        tft.fillRect(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5, 60, 10, bg_color);
-        tft.setCursor(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5 + 2);
-        tft.setTextColor(is_bt_connected ? TFT_BLUE : TFT_DARKGREY, bg_color);
-        tft.print(is_bt_connected ? "CONN" : "----");
-        tft.setTextColor(txt_color, bg_color);
-    }
-    if (g_params.loop_length != g_display_cache.loop_length) {
-        g_display_cache.loop_length = g_params.loop_length;
-        tft.fillRect(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6, 80, 10, bg_color);
-        tft.setCursor(UI_COL1_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6 + 2);
-        tft.printf("%d steps", g_params.loop_length);
-    }
-    if(g_pot4_mode != g_display_cache.pot4_mode_for_text_update) {
-        g_display_cache.pot4_mode_for_text_update = g_pot4_mode;
-        tft.fillRect(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6, 60, 10, bg_color);
-        tft.setCursor(UI_COL2_BAR_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6 + 2);
-        tft.print(getPot4ModeString(g_pot4_mode));
-    }
-    // Compact BPM display (white background, black text)
-    if (abs(g_current_bpm - g_display_cache.bpm) > 0.1f) {
-        g_display_cache.bpm = g_current_bpm;
-        tft.fillRect(5, VIZ_AREA_Y_START + 2, 80, 10, TFT_WHITE);
-        tft.setTextColor(TFT_BLACK, TFT_WHITE);
-        tft.setTextSize(1);
-        tft.setCursor(5, VIZ_AREA_Y_START + 2);
-        tft.printf("%.1fBPM", g_current_bpm);
-    }
-
-    // Grain count display (white background, black text)
-    if (g_activeGrainCount != g_display_cache.active_grains) {
-        g_display_cache.active_grains = g_activeGrainCount;
-        tft.fillRect(240, VIZ_AREA_Y_START + 2, 75, 10, TFT_WHITE);
-        tft.setTextColor(TFT_BLACK, TFT_WHITE);
-        tft.setCursor(240, VIZ_AREA_Y_START + 2);
-        tft.printf("%d/%dgrn", g_activeGrainCount, MAX_GRAINS);
-    }
-
-    // Draw particle visualizer
-    drawParticleVisualizer();
 
     // Update trigger LED animation
     updateTriggerLED();
@@ -1584,432 +3275,776 @@ void updateDisplay() {
 
 void drawUiFrame() {
     uint16_t bg_color = g_inverse_mode ? TFT_WHITE : TFT_BLACK;
-    uint16_t text_color = g_inverse_mode ? TFT_BLACK : TFT_WHITE;
-    constexpr int UI_SEPARATOR_Y_NEW = 95;
     uint16_t line_color = g_inverse_mode ?
     TFT_LIGHTGREY : TFT_DARKGREY;
 
     tft.fillScreen(bg_color);
     tft.setTextSize(1);
-    tft.setTextColor(text_color, bg_color);
-    const char* labels1[] = {"POS", "SIZ", "DEJA", "TEX", "FBK", "CLK", "LOOP"};
-    const char* labels2[] = {"PIT", "MIX", "RVB", "ROOM", "SPR", "BT", "POT4"};
-    for (int i = 0; i < 7; i++) {
-        tft.setCursor(UI_COL1_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * i + 2);
-        tft.print(labels1[i]);
-        if (labels2[i] != "") {
-            tft.setCursor(UI_COL2_LABEL_X, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * i + 2);
-            tft.print(labels2[i]);
-        }
-    }
 
-    tft.drawLine(0, UI_SEPARATOR_Y_NEW, 320, UI_SEPARATOR_Y_NEW, line_color);
-    tft.fillRect(0, UI_SEPARATOR_Y_NEW + 1, 320, 240 - (UI_SEPARATOR_Y_NEW + 1),
+    tft.drawLine(0, VIZ_AREA_Y_START, 320, VIZ_AREA_Y_START, line_color);
+    tft.fillRect(0, VIZ_AREA_Y_START + 1, 320, 240 - (VIZ_AREA_Y_START + 1),
                  GET_VISUALIZER_BG_COLOR());
     tft.drawCircle(UI_TRIGGER_LED_X, UI_TRIGGER_LED_Y, UI_TRIGGER_LED_RADIUS, TFT_DARKGREY);
 
     // Draw visualizer separator line
     tft.drawLine(0, VIZ_PARTICLE_Y_START - 1, 320, VIZ_PARTICLE_Y_START - 1, line_color);
+
+    // ラベル・バー枠を含む全ウィジェットとバッファバーは次フレームで描かれる
+    initUiWidgets();
+    g_buffer_bar_static_drawn = false;
+}
+
+// ================================================================= //
+// SECTION: UI Widget Layer (retained mode)
+// ================================================================= //
+// 各バー・ラベルは表示済みの状態を保持し、変化した差分だけを描く。
+//   - バー: 塗り幅が変わった区間だけを fillRect（枠は初回/無効化時のみ）
+//   - テキスト: 変化した文字だけを描く。数字類は事前レンダリングしたグリフを転送
+//   - 1フレームのSPI転送量に上限を設け、超えた分は次フレームに持ち越す
+
+// 数値表示用グリフキャッシュ（GLCDフォント 6x8、16bppスプライト）
+TFT_eSprite g_glyphSprite = TFT_eSprite(&tft);
+uint16_t g_glyph_fg = 0, g_glyph_bg = 0;
+bool g_glyph_cache_ready = false;
+const char UI_GLYPH_CHARS[] = "0123456789%+-. ";
+constexpr int UI_GLYPH_COUNT = sizeof(UI_GLYPH_CHARS) - 1;
+
+int uiGlyphIndex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    switch (c) {
+        case '%': return 10;
+        case '+': return 11;
+        case '-': return 12;
+        case '.': return 13;
+        case ' ': return 14;
+        default:  return -1;
+    }
+}
+
+// 指定色のグリフを描き直す（色が変わらない限り起動時の1回のみ）
+void uiBuildGlyphCache(uint16_t fg, uint16_t bg) {
+    if (g_glyph_cache_ready && fg == g_glyph_fg && bg == g_glyph_bg) return;
+    if (!g_glyphSprite.created()) {
+        g_glyphSprite.setColorDepth(16);
+        if (g_glyphSprite.createSprite(UI_GLYPH_COUNT * UI_CHAR_W, UI_CHAR_H) == nullptr) {
+            Serial.println("WARNING: Glyph cache allocation failed (falling back to drawChar)");
+            return;
+        }
+    }
+    for (int i = 0; i < UI_GLYPH_COUNT; i++) {
+        g_glyphSprite.drawChar(i * UI_CHAR_W, 0, UI_GLYPH_CHARS[i], fg, bg, 1);
+    }
+    g_glyph_fg = fg;
+    g_glyph_bg = bg;
+    g_glyph_cache_ready = true;
+}
+
+void uiDrawChar(int x, int y, char c, uint16_t fg, uint16_t bg) {
+    int gi = uiGlyphIndex(c);
+    if (gi >= 0 && g_glyph_cache_ready && fg == g_glyph_fg && bg == g_glyph_bg) {
+        g_glyphSprite.pushSprite(x, y, gi * UI_CHAR_W, 0, UI_CHAR_W, UI_CHAR_H);
+    } else {
+        tft.drawChar(x, y, c, fg, bg, 1);
+    }
 }
 
-void drawParameterBar(int x, int y, int16_t val, int16_t& lastVal, uint16_t color) {
-    if(val == lastVal) return;
+void initUiWidgets() {
     uint16_t bg_color = g_inverse_mode ? TFT_WHITE : TFT_BLACK;
-    uint16_t border_color = g_inverse_mode ? TFT_BLACK : TFT_WHITE;
-    int fill_w = map(val, 0, 32767, 0, UI_BAR_WIDTH);
-    tft.fillRect(x, y, UI_BAR_WIDTH, UI_BAR_HEIGHT, bg_color);
-    tft.fillRect(x, y, fill_w, UI_BAR_HEIGHT, color);
-    tft.drawRect(x, y, UI_BAR_WIDTH, UI_BAR_HEIGHT, border_color);
+    uint16_t txt_color = g_inverse_mode ? TFT_BLACK : TFT_WHITE;
+
+    // パラメータバー（バーの直後のIDが値表示テキスト）
+    struct BarDef { UiWidgetId id; int col; int row; uint16_t color; bool bipolar; };
+    const BarDef bars[] = {
+        {UIW_POS_BAR,  0, 0, TFT_SKYBLUE,   false},
+        {UIW_PIT_BAR,  1, 0, TFT_AQUA,      true},
+        {UIW_SIZ_BAR,  0, 1, TFT_SKYBLUE,   false},
+        {UIW_MIX_BAR,  1, 1, TFT_LIGHTBLUE, false},
+        {UIW_DEJA_BAR, 0, 2, TFT_SKYBLUE,   false},
+        {UIW_RVB_BAR,  1, 2, 0x0410,        false},  // RVB (teal)
+        {UIW_TEX_BAR,  0, 3, TFT_AQUA,      false},
+        {UIW_ROOM_BAR, 1, 3, 0x8010,        false},  // ROOM (purple)
+        {UIW_FBK_BAR,  0, 4, TFT_AQUA,      false},
+        {UIW_SPR_BAR,  1, 4, TFT_AQUA,      false},
+    };
+    for (const BarDef& b : bars) {
+        int x = b.col ? UI_COL2_BAR_X : UI_COL1_BAR_X;
+        int y = UI_PARAM_Y_START + UI_PARAM_Y_SPACING * b.row;
+        uiInitBar(g_ui_widgets[b.id], x, y, b.color, bg_color, txt_color, b.bipolar);
+        // 値テキスト: "100%" / ピッチは "-24.0"
+        uiInitText(g_ui_widgets[b.id + 1], x + UI_BAR_WIDTH + 5, y, b.bipolar ? 5 : 4, txt_color, bg_color);
+    }
+
+    const int row5_y = UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 5 + 2;
+    const int row6_y = UI_PARAM_Y_START + UI_PARAM_Y_SPACING * 6 + 2;
+    uiInitText(g_ui_widgets[UIW_CLK_TEXT],  UI_COL1_BAR_X, row5_y, 10, txt_color, bg_color);
+    uiInitText(g_ui_widgets[UIW_BT_TEXT],   UI_COL2_BAR_X, row5_y, 10, TFT_DARKGREY, bg_color);
+    uiInitText(g_ui_widgets[UIW_LOOP_TEXT], UI_COL1_BAR_X, row6_y, 13, txt_color, bg_color);
+    uiInitText(g_ui_widgets[UIW_POT4_TEXT], UI_COL2_BAR_X, row6_y, 10, txt_color, bg_color);
+    uiInitText(g_ui_widgets[UIW_BPM_TEXT],  5,   VIZ_AREA_Y_START + 2, 13, TFT_BLACK, TFT_WHITE);
+    uiInitText(g_ui_widgets[UIW_GRAIN_TEXT], 240, VIZ_AREA_Y_START + 2, 12, TFT_BLACK, TFT_WHITE);
+
+    // 静的ラベル（POT4割当の強調は色変更として扱う）
+    for (int i = 0; i < UI_LABEL_COUNT; i++) {
+        int row = i % 7;
+        int x = (i < 7) ? UI_COL1_LABEL_X : UI_COL2_LABEL_X;
+        UiWidget& w = g_ui_widgets[UIW_LABEL_FIRST + i];
+        uiInitText(w, x, UI_PARAM_Y_START + UI_PARAM_Y_SPACING * row + 2, 4, txt_color, bg_color);
+        uiSetText(w, UI_LABEL_TEXT[i]);
+    }
+
+    uiBuildGlyphCache(txt_color, bg_color);
+    g_ui_next_widget = 0;
+}
+
+void uiInitBar(UiWidget& w, int x, int y, uint16_t fill, uint16_t bg, uint16_t border, bool bipolar) {
+    w.kind = bipolar ? UI_WIDGET_BIPOLAR_BAR : UI_WIDGET_BAR;
+    w.x = x; w.y = y; w.w = UI_BAR_WIDTH; w.h = UI_BAR_HEIGHT;
+    w.fg = fill; w.bg = bg; w.border = border;
+    w.fill_px = 0;
+    w.drawn_fill_px = 0;
+    w.full_redraw = true;
+}
+
+void uiInitText(UiWidget& w, int x, int y, uint8_t chars, uint16_t fg, uint16_t bg) {
+    w.kind = UI_WIDGET_TEXT;
+    w.x = x; w.y = y; w.w = chars * UI_CHAR_W; w.h = UI_CHAR_H;
+    w.fg = fg; w.bg = bg; w.border = fg;
+    w.chars = min(chars, (uint8_t)UI_TEXT_MAX_CHARS);
+    memset(w.text, ' ', w.chars);
+    w.text[w.chars] = '\0';
+    memcpy(w.drawn_text, w.text, w.chars + 1);
+    w.full_redraw = true;
+}
 
-    tft.setTextColor(border_color, bg_color);
-    tft.fillRect(x+UI_BAR_WIDTH+5, y, 30, UI_BAR_HEIGHT+2, bg_color);
-    tft.setCursor(x+UI_BAR_WIDTH+5, y);
-    tft.printf("%d%%", (int)map(val, 0, 32767, 0, 100));
-    lastVal = val;
+// 表示桁数に合わせて右側を空白で埋める（短くなった文字列の消去も差分描画で済む）
+void uiSetText(UiWidget& w, const char* s) {
+    uint8_t i = 0;
+    for (; i < w.chars && s[i] != '\0'; i++) w.text[i] = s[i];
+    for (; i < w.chars; i++) w.text[i] = ' ';
 }
 
-void drawPitchBar(int x, int y, float val, float& lastVal, uint16_t color) {
+void uiSetTextColor(UiWidget& w, uint16_t fg) {
+    if (w.fg != fg) {
+        w.fg = fg;
+        w.full_redraw = true;
+    }
+}
+
+// パラメータバー + 値テキスト（Q15 → 内側の塗り幅 / パーセント）
+void uiSetParam(UiWidgetId bar_id, int16_t val_q15) {
+    UiWidget& bar = g_ui_widgets[bar_id];
+    int16_t v = max(val_q15, (int16_t)0);
+    bar.fill_px = (int16_t)(((int32_t)v * (UI_BAR_WIDTH - 2)) / 32767);
+
+    char text[8];
+    snprintf(text, sizeof(text), "%d%%", (int)(((int32_t)v * 100) / 32767));
+    uiSetText(g_ui_widgets[bar_id + 1], text);
+}
+
+// ピッチバー（中央から左右に伸びる）+ 値テキスト
+void uiSetPitch(UiWidgetId bar_id, float val) {
     // 非有限値・範囲外をガード
     if (!isfinite(val)) val = 0.0f;
     if (val >  PITCH_RANGE_SEMITONES_HALF) val =  PITCH_RANGE_SEMITONES_HALF;
     if (val < -PITCH_RANGE_SEMITONES_HALF) val = -PITCH_RANGE_SEMITONES_HALF;
 
-    // lastVal 側も非有限なら強制更新扱い
-    bool shouldUpdate = !isfinite(lastVal) ||
-    (fabsf(val - lastVal) >= PITCH_CHANGE_THRESHOLD);
-    if (!shouldUpdate) return;
+    UiWidget& bar = g_ui_widgets[bar_id];
+    bar.fill_px = (int16_t)((val / PITCH_RANGE_SEMITONES_HALF) * UI_BIPOLAR_HALF_WIDTH);
 
-    const int center_x = x + UI_BAR_WIDTH / 2;
-    uint16_t bg_color = g_inverse_mode ? TFT_WHITE : TFT_BLACK;
-    uint16_t border_color = g_inverse_mode ? TFT_BLACK : TFT_WHITE;
-    // バー本体
-    tft.fillRect(x, y, UI_BAR_WIDTH, UI_BAR_HEIGHT, bg_color);
-    // map() を使わず自前で線形変換（0..halfRange → 0..UI_BAR_WIDTH/2）
-    float ratio = fabsf(val) / PITCH_RANGE_SEMITONES_HALF;
-    // 0..1
-    if (ratio > 1.0f) ratio = 1.0f;
-    int fill_w = (int)(ratio * (UI_BAR_WIDTH / 2));
-    if (val >= 0) {
-        tft.fillRect(center_x, y, fill_w, UI_BAR_HEIGHT, color);
+    char text[8];
+    snprintf(text, sizeof(text), "%.1f", val);
+    uiSetText(g_ui_widgets[bar_id + 1], text);
+}
+
+bool uiIsDirty(const UiWidget& w) {
+    if (w.full_redraw) return true;
+    if (w.kind == UI_WIDGET_TEXT) return memcmp(w.text, w.drawn_text, w.chars) != 0;
+    return w.fill_px != w.drawn_fill_px;
+}
+
+// 描画に必要なSPI転送量の見積もり（ピクセル × 2バイト + 矩形ごとのアドレス設定）
+uint32_t uiEstimateBytes(const UiWidget& w) {
+    if (w.kind == UI_WIDGET_TEXT) {
+        uint32_t changed = 0;
+        for (uint8_t i = 0; i < w.chars; i++) {
+            if (w.full_redraw || w.text[i] != w.drawn_text[i]) changed++;
+        }
+        return changed * (UI_CHAR_W * UI_CHAR_H * 2 + UI_SPI_RECT_OVERHEAD_BYTES);
+    }
+    if (w.full_redraw) {
+        return (uint32_t)w.w * w.h * 2 + 6 * UI_SPI_RECT_OVERHEAD_BYTES;
+    }
+    uint32_t span = abs(w.fill_px - w.drawn_fill_px);
+    return span * (w.h - 2) * 2 + 2 * UI_SPI_RECT_OVERHEAD_BYTES;
+}
+
+// 片側に伸びるバーの差分描画: [origin+from, origin+to) を塗る/消す
+void uiDrawBarSpan(const UiWidget& w, int origin, int from, int to, int dir) {
+    if (from == to) return;
+    int lo = min(from, to), hi = max(from, to);
+    uint16_t color = (to > from) ? w.fg : w.bg;
+    int x = (dir > 0) ? origin + lo : origin - hi + 1;
+    tft.fillRect(x, w.y + 1, hi - lo, w.h - 2, color);
+}
+
+void uiDrawWidget(UiWidget& w) {
+    if (w.kind == UI_WIDGET_TEXT) {
+        for (uint8_t i = 0; i < w.chars; i++) {
+            if (w.full_redraw || w.text[i] != w.drawn_text[i]) {
+                uiDrawChar(w.x + i * UI_CHAR_W, w.y, w.text[i], w.fg, w.bg);
+                w.drawn_text[i] = w.text[i];
+            }
+        }
+        w.full_redraw = false;
+        return;
+    }
+
+    if (w.kind == UI_WIDGET_BAR) {
+        if (w.full_redraw) {
+            tft.fillRect(w.x + 1, w.y + 1, w.w - 2, w.h - 2, w.bg);
+            tft.drawRect(w.x, w.y, w.w, w.h, w.border);
+            w.drawn_fill_px = 0;
+        }
+        uiDrawBarSpan(w, w.x + 1, w.drawn_fill_px, w.fill_px, +1);
     } else {
-        tft.fillRect(center_x - fill_w, y, fill_w, UI_BAR_HEIGHT, color);
+        // 中央線の右側が正、左側が負
+        const int center_x = w.x + w.w / 2;
+        if (w.full_redraw) {
+            tft.fillRect(w.x + 1, w.y + 1, w.w - 2, w.h - 2, w.bg);
+            tft.drawRect(w.x, w.y, w.w, w.h, w.border);
+            tft.drawFastVLine(center_x, w.y, w.h, g_inverse_mode ? TFT_LIGHTGREY : TFT_DARKGREY);
+            w.drawn_fill_px = 0;
+        }
+        int old_pos = max((int)w.drawn_fill_px, 0), new_pos = max((int)w.fill_px, 0);
+        int old_neg = max(-(int)w.drawn_fill_px, 0), new_neg = max(-(int)w.fill_px, 0);
+        uiDrawBarSpan(w, center_x + 1, old_pos, new_pos, +1);
+        uiDrawBarSpan(w, center_x - 1, old_neg, new_neg, -1);
     }
+    w.drawn_fill_px = w.fill_px;
+    w.full_redraw = false;
+}
 
-    // 枠線・センターライン
-    tft.drawRect(x, y, UI_BAR_WIDTH, UI_BAR_HEIGHT, border_color);
-    tft.drawFastVLine(center_x, y, UI_BAR_HEIGHT,
-                      g_inverse_mode ? TFT_LIGHTGREY : TFT_DARKGREY);
-    // 文字表示（printfではなく drawFloat を使用）
-    tft.setTextColor(border_color, bg_color);
-    tft.fillRect(x + UI_BAR_WIDTH + 5, y, 50, UI_BAR_HEIGHT + 2, bg_color);
-    // 第2引数=小数点以下桁数, 第3/4引数=表示位置
-    tft.drawFloat(val, 1, x + UI_BAR_WIDTH + 5, y);
+// dirtyなウィジェットを予算内で描く。前フレームで打ち切った位置から再開するので
+// 予算不足が続いても特定のウィジェットだけが描かれないことはない
+uint32_t uiRenderWidgets(uint32_t byte_budget) {
+    uint32_t spent = 0;
+    for (int n = 0; n < UIW_COUNT; n++) {
+        int idx = (g_ui_next_widget + n) % UIW_COUNT;
+        UiWidget& w = g_ui_widgets[idx];
+        if (!uiIsDirty(w)) continue;
+        uint32_t cost = uiEstimateBytes(w);
+        if (spent > 0 && spent + cost > byte_budget) {
+            g_ui_next_widget = idx;
+            return spent;
+        }
+        uiDrawWidget(w);
+        spent += cost;
+    }
+    return spent;
+}
 
-    lastVal = val;
+void uiInvalidateRect(int x, int y, int w, int h) {
+    for (int i = 0; i < UIW_COUNT; i++) {
+        UiWidget& wd = g_ui_widgets[i];
+        if (wd.x < x + w && x < wd.x + wd.w && wd.y < y + h && y < wd.y + wd.h) {
+            wd.full_redraw = true;
+        }
+    }
+}
+
+void invalidateAllWidgets() {
+    for (int i = 0; i < UIW_COUNT; i++) {
+        g_ui_widgets[i].full_redraw = true;
+    }
 }
 
 
 // ================================================================= //
 // SECTION: Particle Visualizer
 // ================================================================= //
-void drawParticleVisualizer() {
-    static uint16_t last_write_pos = 0xFFFF;
-    static bool buffer_bar_initialized = false;
-    uint16_t bg_color = g_inverse_mode ? TFT_WHITE : TFT_BLACK;
-    uint16_t fg_color = g_inverse_mode ? TFT_BLACK : TFT_WHITE;
-
-    // Clear particle area every frame for smooth animation (white background)
-    tft.fillRect(0, VIZ_PARTICLE_Y_START, 320, VIZ_PARTICLE_HEIGHT, TFT_WHITE);
-
-    // Draw enhanced buffer progress bar at bottom
-    if (!buffer_bar_initialized || last_write_pos != g_grainWritePos) {
-        // Clear buffer bar area with white background
-        tft.fillRect(0, VIZ_BUFFER_BAR_AREA_Y, 320, 48, TFT_WHITE);
-
-        // Draw scale markers (0%, 25%, 50%, 75%, 100%) - black text on white
-        tft.setTextSize(1);
-        tft.setTextColor(TFT_DARKGREY, TFT_WHITE);
-        tft.setCursor(0, VIZ_BUFFER_BAR_AREA_Y);
-        tft.print("0");
-        tft.setCursor(75, VIZ_BUFFER_BAR_AREA_Y);
-        tft.print("25");
-        tft.setCursor(155, VIZ_BUFFER_BAR_AREA_Y);
-        tft.print("50");
-        tft.setCursor(235, VIZ_BUFFER_BAR_AREA_Y);
-        tft.print("75");
-        tft.setCursor(302, VIZ_BUFFER_BAR_AREA_Y);
-        tft.print("100%");
-
-        int bar_y = VIZ_BUFFER_BAR_AREA_Y + 8;
-
-        // Draw segmented buffer bar (battery-style with purple segments)
-        constexpr int SEGMENT_COUNT = 32;
-        constexpr int SEGMENT_WIDTH = 9;
-        constexpr int SEGMENT_GAP = 1;
-        constexpr int SEGMENT_TOTAL_WIDTH = SEGMENT_WIDTH + SEGMENT_GAP;
-
-        // Calculate how many segments to fill based on buffer progress
-        int filled_segments = (g_grainWritePos * SEGMENT_COUNT) / GRAIN_BUFFER_SIZE;
-
-        // Draw each segment
-        for (int i = 0; i < SEGMENT_COUNT; i++) {
-            int seg_x = i * SEGMENT_TOTAL_WIDTH;
-
-            if (i < filled_segments) {
-                // Filled segment (purple)
-                tft.fillRect(seg_x, bar_y, SEGMENT_WIDTH, VIZ_BUFFER_BAR_HEIGHT, TFT_PURPLE);
-            } else {
-                // Empty segment (light gray on white background)
-                tft.fillRect(seg_x, bar_y, SEGMENT_WIDTH, VIZ_BUFFER_BAR_HEIGHT, TFT_LIGHTGREY);
-            }
-        }
+// バッファ位置バーの静的レイヤー（白背景・目盛り・枠・情報テキスト・空セグメント）
+void drawBufferBarStatic() {
+    // Clear buffer bar area with white background
+    tft.fillRect(0, VIZ_BUFFER_BAR_AREA_Y, 320, 48, TFT_WHITE);
 
-        // Draw current write position marker (red line)
-        int x_pos = (g_grainWritePos * (SEGMENT_COUNT * SEGMENT_TOTAL_WIDTH)) / GRAIN_BUFFER_SIZE;
-        tft.fillRect(x_pos - 1, bar_y, 2, VIZ_BUFFER_BAR_HEIGHT, TFT_RED);
+    // Draw scale markers (0%, 25%, 50%, 75%, 100%) - black text on white
+    tft.setTextSize(1);
+    tft.setTextColor(TFT_DARKGREY, TFT_WHITE);
+    tft.setCursor(0, VIZ_BUFFER_BAR_AREA_Y);
+    tft.print("0");
+    tft.setCursor(75, VIZ_BUFFER_BAR_AREA_Y);
+    tft.print("25");
+    tft.setCursor(155, VIZ_BUFFER_BAR_AREA_Y);
+    tft.print("50");
+    tft.setCursor(235, VIZ_BUFFER_BAR_AREA_Y);
+    tft.print("75");
+    tft.setCursor(302, VIZ_BUFFER_BAR_AREA_Y);
+    tft.print("100%");
+
+    // Empty segments (light gray on white background)
+    for (int i = 0; i < VIZ_BUFFER_SEGMENT_COUNT; i++) {
+        tft.fillRect(i * VIZ_BUFFER_SEGMENT_TOTAL_WIDTH, VIZ_BUFFER_BAR_Y,
+                     VIZ_BUFFER_SEGMENT_WIDTH, VIZ_BUFFER_BAR_HEIGHT, TFT_LIGHTGREY);
+    }
+
+    // Draw tick marks at 25% intervals (black on white)
+    for (int i = 0; i <= 4; i++) {
+        int tick_x = (i * VIZ_BUFFER_SEGMENT_COUNT * VIZ_BUFFER_SEGMENT_TOTAL_WIDTH) / 4;
+        tft.drawFastVLine(tick_x, VIZ_BUFFER_BAR_Y - 2, 2, TFT_BLACK);
+    }
+
+    // Draw border around entire bar area (black on white)
+    tft.drawRect(0, VIZ_BUFFER_BAR_Y, VIZ_BUFFER_SEGMENT_COUNT * VIZ_BUFFER_SEGMENT_TOTAL_WIDTH,
+                 VIZ_BUFFER_BAR_HEIGHT, TFT_BLACK);
+
+    // Buffer info text (実際のバッファ長から計算) - black text on white background
+    tft.setTextColor(TFT_BLACK, TFT_WHITE);
+    tft.setCursor(80, VIZ_BUFFER_BAR_AREA_Y + VIZ_BUFFER_BAR_HEIGHT + 11);
+    tft.printf("Buf:%usmp/%ums", (unsigned)GRAIN_BUFFER_SIZE,
+               (unsigned)((uint64_t)GRAIN_BUFFER_SIZE * 1000 / 44100));
+}
 
-        // Draw tick marks at 25% intervals (black on white)
-        for (int i = 0; i <= 4; i++) {
-            int tick_x = (i * SEGMENT_COUNT * SEGMENT_TOTAL_WIDTH) / 4;
-            tft.drawFastVLine(tick_x, bar_y - 2, 2, TFT_BLACK);
-        }
+// セグメントの内側だけを塗る（上下の枠線と左右端の縦線は静的レイヤーのまま残す）
+void drawBufferBarSegment(int i, bool filled) {
+    int x0 = max(i * VIZ_BUFFER_SEGMENT_TOTAL_WIDTH, 1);
+    int x1 = min(i * VIZ_BUFFER_SEGMENT_TOTAL_WIDTH + VIZ_BUFFER_SEGMENT_WIDTH, 319);
+    tft.fillRect(x0, VIZ_BUFFER_BAR_Y + 1, x1 - x0, VIZ_BUFFER_BAR_HEIGHT - 2,
+                 filled ? TFT_PURPLE : TFT_LIGHTGREY);
+}
+
+// 書き込みヘッド（2px幅）の下にあった1列を静的レイヤー＋セグメント状態で描き直す
+void restoreBufferBarColumn(int x, int filled_segments) {
+    if (x < 0 || x >= 320) return;
+    if (x == 0 || x == 319) {
+        tft.drawFastVLine(x, VIZ_BUFFER_BAR_Y, VIZ_BUFFER_BAR_HEIGHT, TFT_BLACK);
+        return;
+    }
+    int seg = x / VIZ_BUFFER_SEGMENT_TOTAL_WIDTH;
+    bool in_segment = (x % VIZ_BUFFER_SEGMENT_TOTAL_WIDTH) < VIZ_BUFFER_SEGMENT_WIDTH;
+    uint16_t inner = !in_segment ? TFT_WHITE : (seg < filled_segments ? TFT_PURPLE : TFT_LIGHTGREY);
+    tft.drawPixel(x, VIZ_BUFFER_BAR_Y, TFT_BLACK);
+    tft.drawFastVLine(x, VIZ_BUFFER_BAR_Y + 1, VIZ_BUFFER_BAR_HEIGHT - 2, inner);
+    tft.drawPixel(x, VIZ_BUFFER_BAR_Y + VIZ_BUFFER_BAR_HEIGHT - 1, TFT_BLACK);
+}
+
+// 以前は毎フレーム 320x48 を塗り直していたが、塗り状態が変わったセグメントと
+// 書き込みヘッドの移動分だけを描く
+void updateBufferBar() {
+    static int drawn_filled_segments = 0;
+    static int drawn_marker_x = -1;
 
-        // Draw border around entire bar area (black on white)
-        tft.drawRect(0, bar_y, SEGMENT_COUNT * SEGMENT_TOTAL_WIDTH, VIZ_BUFFER_BAR_HEIGHT, TFT_BLACK);
+    uint32_t write_pos = g_grainWritePos;
+    int filled_segments = (write_pos * VIZ_BUFFER_SEGMENT_COUNT) / GRAIN_BUFFER_SIZE;
+    int marker_x = (write_pos * (VIZ_BUFFER_SEGMENT_COUNT * VIZ_BUFFER_SEGMENT_TOTAL_WIDTH)) / GRAIN_BUFFER_SIZE;
 
-        // Draw buffer info text (32768 samples / ~743ms) - black text on white background
-        tft.setTextColor(TFT_BLACK, TFT_WHITE);
-        tft.setCursor(80, VIZ_BUFFER_BAR_AREA_Y + VIZ_BUFFER_BAR_HEIGHT + 11);
-        tft.print("Buf:32768smp/743ms");
+    if (!g_buffer_bar_static_drawn) {
+        drawBufferBarStatic();
+        g_buffer_bar_static_drawn = true;
+        drawn_filled_segments = 0;
+        drawn_marker_x = -1;
+    }
+    if (filled_segments == drawn_filled_segments && marker_x == drawn_marker_x) return;
+
+    // ラップアラウンド時は減る方向にも描き直す
+    int lo = min(filled_segments, drawn_filled_segments);
+    int hi = max(filled_segments, drawn_filled_segments);
+    for (int i = lo; i < hi; i++) {
+        drawBufferBarSegment(i, i < filled_segments);
+    }
+    drawn_filled_segments = filled_segments;
 
-        last_write_pos = g_grainWritePos;
-        buffer_bar_initialized = true;
+    // Write position marker (red line): erase the old one, then draw the new one
+    if (drawn_marker_x >= 0) {
+        restoreBufferBarColumn(drawn_marker_x - 1, filled_segments);
+        restoreBufferBarColumn(drawn_marker_x, filled_segments);
     }
+    tft.fillRect(marker_x - 1, VIZ_BUFFER_BAR_Y, 2, VIZ_BUFFER_BAR_HEIGHT, TFT_RED);
+    drawn_marker_x = marker_x;
+}
+
+void drawParticleVisualizer() {
+    // Buffer position bar (static layer once, then only changed segments + write head)
+    updateBufferBar();
+
+    if (!g_vizSpriteReady) return;
 
     // Trail effect: store previous particle positions
     struct ParticleTrail {
-        int x, y, radius;
-        uint16_t color;
+        int16_t x, y, radius;
+        uint8_t color_idx;
         bool valid;
     };
     static ParticleTrail trails[MAX_GRAINS] = {};
 
-    // Draw trails (previous frame particles with lighter color)
+    // パーティクルはオフスクリーンのスプライトに描き、最後に一括転送する（SPIは描画中に使わない）
+    // スプライトは毎フレームクリアせず、描き直すのは
+    //   オーディオ側で波形が変わった列 ＋ 前フレームで円を描いた列
+    // だけ（背景→波形の順に描き、その上にトレイルとパーティクルを重ねる）
+    static uint32_t circle_columns[VIZ_WAVE_DIRTY_WORDS] = {};
+    uint32_t columns[VIZ_WAVE_DIRTY_WORDS];
+    for (int w = 0; w < VIZ_WAVE_DIRTY_WORDS; w++) {
+        columns[w] = __atomic_exchange_n(&g_wave_dirty[w], 0, __ATOMIC_RELAXED) | circle_columns[w];
+        circle_columns[w] = 0;
+    }
+    redrawVisualizerColumns(columns);
+
+    // Draw trails (previous frame particles with lighter palette color)
     for (uint8_t i = 0; i < MAX_GRAINS; i++) {
         if (trails[i].valid) {
-            // Make trail color lighter (blend with white)
-            uint16_t trail_color = trails[i].color;
-            // Extract RGB components from RGB565
-            uint8_t r = ((trail_color >> 11) & 0x1F) * 8;
-            uint8_t g = ((trail_color >> 5) & 0x3F) * 4;
-            uint8_t b = (trail_color & 0x1F) * 8;
-            // Blend 60% with white
-            r = r + (255 - r) * 0.6;
-            g = g + (255 - g) * 0.6;
-            b = b + (255 - b) * 0.6;
-            // Convert back to RGB565
-            uint16_t light_color = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
-
-            tft.fillCircle(trails[i].x, trails[i].y, trails[i].radius, light_color);
+            g_vizSprite.fillCircle(trails[i].x, trails[i].y, trails[i].radius,
+                                   trails[i].color_idx + VIZ_PAL_TRAIL_OFFSET);
+            markVisualizerColumns(circle_columns, trails[i].x - trails[i].radius, trails[i].x + trails[i].radius);
         }
     }
 
     // Draw current particles and update trails
-    for (uint8_t i = 0; i < g_activeGrainCount; i++) {
-        uint8_t grain_idx = g_activeGrainIndices[i];
-        Grain& grain = g_grains[grain_idx];
+    bool is_active[MAX_GRAINS] = {};
+    // 表示はメインのレイヤー（レイヤー0）のグレイン
+    const GranularEngine& layer = g_layers[0];
+    for (uint8_t i = 0; i < layer.activeGrainCount; i++) {
+        uint8_t grain_idx = layer.activeGrainIndices[i];
+        const Grain& grain = layer.grains[grain_idx];
 
-        if (!grain.active) continue;
+        if (!grain.active || grain.length == 0) continue;
+        is_active[grain_idx] = true;
 
         // Calculate X position (buffer position: 0-320)
-        uint16_t current_pos = grain.position_q16 >> 16;
-        uint16_t buffer_pos = (grain.startPos + current_pos) & GRAIN_BUFFER_MASK;
-        int x = (buffer_pos * 320) / GRAIN_BUFFER_SIZE;
+        uint32_t current_pos = (uint32_t)(grain.position_q16 >> 16);
+        uint32_t buffer_pos = (grain.startPos + current_pos) & GRAIN_BUFFER_MASK;
+        int x = (buffer_pos * VIZ_SPRITE_WIDTH) / GRAIN_BUFFER_SIZE;
 
-        // Calculate particle size (envelope progress) - calculate first
-        float progress = (float)current_pos / grain.length;
-        // Use Hann window for size (larger in middle, smaller at edges)
-        float envelope = 0.5f * (1.0f - cosf(2.0f * PI * progress));
-        int size = VIZ_PARTICLE_MIN_SIZE + (int)(envelope * (VIZ_PARTICLE_MAX_SIZE - VIZ_PARTICLE_MIN_SIZE));
-        size = constrain(size, VIZ_PARTICLE_MIN_SIZE, VIZ_PARTICLE_MAX_SIZE);
-        int particle_radius = size / 2;
+        // Envelope progress (0..VIZ_ENV_LUT_SIZE-1) → particle radius from the Hann LUT
+        // （窓の位相は再生方向に関係なく 0 → 1 に進む）
+        uint32_t progress = (uint32_t)(((uint64_t)grain.env_phase * VIZ_ENV_LUT_SIZE) >> 32);
+        int particle_radius = g_viz_radius_lut[progress];
 
-        // Calculate Y position (pitch: speed_q16 mapped to Y axis)
+        // Calculate Y position (pitch: speed_q16 mapped to Y axis, sprite-local)
         // speed_q16: 1<<16 = normal pitch (center)
         // Constrain Y to keep particle fully within bounds (considering radius)
-        int32_t pitch_offset = grain.speed_q16 - (1 << 16);  // Offset from center
-        int y_center = VIZ_PARTICLE_Y_START + (VIZ_PARTICLE_HEIGHT / 2);
-        int y = y_center - (pitch_offset >> 12);  // Scale down for display
-        y = constrain(y, VIZ_PARTICLE_Y_START + particle_radius,
-                      VIZ_PARTICLE_Y_START + VIZ_PARTICLE_HEIGHT - particle_radius);
-
-        // Calculate color (progress-based gradient)
-        uint16_t color;
-        if (progress < 0.33f) {
-            // Start: Cyan to Yellow
-            color = TFT_CYAN;
-        } else if (progress < 0.66f) {
-            // Middle: Yellow to Magenta
-            color = TFT_YELLOW;
+        int32_t pitch_offset = abs(grain.speed_q16) - (1 << 16);  // Offset from center (speed is signed by direction)
+        int y = (VIZ_PARTICLE_HEIGHT / 2) - (pitch_offset >> 12);  // Scale down for display
+        y = constrain(y, particle_radius, VIZ_PARTICLE_HEIGHT - particle_radius);
+
+        // Calculate color (progress-based: Cyan → Yellow → Magenta)
+        uint8_t color_idx;
+        if (progress < VIZ_ENV_LUT_SIZE / 3) {
+            color_idx = VIZ_PAL_CYAN;
+        } else if (progress < (VIZ_ENV_LUT_SIZE * 2) / 3) {
+            color_idx = VIZ_PAL_YELLOW;
         } else {
-            // End: Magenta to Red
-            color = TFT_MAGENTA;
+            color_idx = VIZ_PAL_MAGENTA;
         }
 
         // Draw particle (filled circle)
-        tft.fillCircle(x, y, particle_radius, color);
+        g_vizSprite.fillCircle(x, y, particle_radius, color_idx);
+        markVisualizerColumns(circle_columns, x - particle_radius, x + particle_radius);
 
         // Save current position as trail for next frame
         trails[grain_idx].x = x;
         trails[grain_idx].y = y;
         trails[grain_idx].radius = particle_radius;
-        trails[grain_idx].color = color;
+        trails[grain_idx].color_idx = color_idx;
         trails[grain_idx].valid = true;
     }
 
     // Invalidate trails for inactive grains
     for (uint8_t i = 0; i < MAX_GRAINS; i++) {
-        bool is_active = false;
-        for (uint8_t j = 0; j < g_activeGrainCount; j++) {
-            if (g_activeGrainIndices[j] == i) {
-                is_active = true;
-                break;
-            }
-        }
-        if (!is_active) {
+        if (!is_active[i]) {
             trails[i].valid = false;
         }
     }
-}
 
-// ================================================================= //
-// SECTION: Initialization & Helpers
-// ================================================================= //
+    pushVisualizerSprite();
+}
 
-// Initialize window LUT (Hann window squared for grain envelope)
-void initWindowLut() {
-    for(int i=0; i<WINDOW_LUT_SIZE; i++) {
-        float t = (float)i / (WINDOW_LUT_SIZE - 1);
-        float w = 0.5f * (1.0f - cosf(2.0f * PI * t));
-        g_window_lut_q15[i] = (int16_t)((w * w) * 32767.0f);
+// 列ビットマスクに [x0, x1] を追加（スプライト外はクリップ）
+void markVisualizerColumns(uint32_t* columns, int x0, int x1) {
+    x0 = max(x0, 0);
+    x1 = min(x1, VIZ_WAVE_COLUMNS - 1);
+    for (int x = x0; x <= x1; x++) {
+        columns[x >> 5] |= 1u << (x & 31);
     }
 }
 
-// Initialize pitch LUT (exponential pitch shift values)
-void initPitchLut() {
-    for(int i=0; i<PITCH_LUT_SIZE; i++) {
-        float s = ((float)i / (PITCH_LUT_SIZE - 1)) * PITCH_RANGE_SEMITONES - PITCH_RANGE_SEMITONES_HALF;
-        g_pitch_lut_q16[i] = (int32_t)(exp2f(s / 12.0f) * 65536.0f);
+// 指定列を背景で消して波形（min/max の縦線）を描き直す。連続する列はまとめて消す
+void redrawVisualizerColumns(const uint32_t* columns) {
+    constexpr int half_h = VIZ_PARTICLE_HEIGHT / 2;
+    int x = 0;
+    while (x < VIZ_WAVE_COLUMNS) {
+        if (!(columns[x >> 5] & (1u << (x & 31)))) {
+            // 32列まとめて空ならスキップ
+            if ((x & 31) == 0 && columns[x >> 5] == 0) x += 32;
+            else x++;
+            continue;
+        }
+        int run_end = x;
+        while (run_end + 1 < VIZ_WAVE_COLUMNS && (columns[(run_end + 1) >> 5] & (1u << ((run_end + 1) & 31)))) {
+            run_end++;
+        }
+        g_vizSprite.fillRect(x, 0, run_end - x + 1, VIZ_PARTICLE_HEIGHT, VIZ_PAL_BG);
+        for (; x <= run_end; x++) {
+            // オーディオタスクが同時に列をリセットしても破綻しないよう順序を正規化する
+            int16_t lo = g_wave_min[x], hi = g_wave_max[x];
+            if (lo > hi) { int16_t t = lo; lo = hi; hi = t; }
+            int y_top = half_h - (((int32_t)hi * half_h) >> 15);
+            int y_bottom = half_h - (((int32_t)lo * half_h) >> 15);
+            g_vizSprite.drawFastVLine(x, y_top, y_bottom - y_top + 1, VIZ_PAL_WAVE);
+        }
     }
 }
 
-// Initialize pan LUT (sine curve for equal-power panning)
-void initPanLut() {
-    for(int i=0; i<PAN_LUT_SIZE; i++) {
-        float a = ((float)i / (PAN_LUT_SIZE - 1)) * (PI * 0.5f);
-        g_pan_lut_q15[i] = (int16_t)(sinf(a) * 32767.0f);
+// 4bppスプライトをRGB565ストリップに展開しながらDMA転送する。
+// 2本のストリップバッファをピンポンで使い、ストリップNの転送中にN+1を展開する。
+// （320x67の16bppフレームバッファ(43KB)はグレインバッファと共存できないため）
+void pushVisualizerSprite() {
+    constexpr int BYTES_PER_LINE = VIZ_SPRITE_WIDTH / 2;
+    const uint8_t* src = (const uint8_t*)g_vizSprite.getPointer();
+    int buf = 0;
+
+    tft.startWrite();
+    for (int y = 0; y < VIZ_PARTICLE_HEIGHT; y += VIZ_DMA_STRIP_LINES) {
+        int lines = min(VIZ_DMA_STRIP_LINES, VIZ_PARTICLE_HEIGHT - y);
+        uint32_t* dst = (uint32_t*)g_viz_dma_buf[buf];
+        const uint8_t* line = src + y * BYTES_PER_LINE;
+        for (int i = 0; i < lines * BYTES_PER_LINE; i++) {
+            dst[i] = g_viz_pixel_pair_lut[line[i]];
+        }
+        // pushImageDMA は前回転送の完了を待ってから次を投入する
+        tft.pushImageDMA(0, VIZ_PARTICLE_Y_START + y, VIZ_SPRITE_WIDTH, lines, g_viz_dma_buf[buf]);
+        buf ^= 1;
     }
+    tft.dmaWait();
+    tft.endWrite();
 }
 
-// Initialize mix LUT (linear dry/wet mix values)
-void initMixLut() {
-    for(int i=0; i<MIX_LUT_SIZE; i++) {
-        g_mix_lut_q15[i] = (int16_t)((i * 32767L) / (MIX_LUT_SIZE - 1));
+// パーティクルスプライト・DMA・描画用LUTの初期化
+void initParticleVisualizer() {
+    // Hann窓エンベロープ → 半径LUT（毎フレームのcosfを置き換え）
+    for (int i = 0; i < VIZ_ENV_LUT_SIZE; i++) {
+        float progress = (float)i / VIZ_ENV_LUT_SIZE;
+        float envelope = 0.5f * (1.0f - cosf(2.0f * PI * progress));
+        int size = VIZ_PARTICLE_MIN_SIZE + (int)(envelope * (VIZ_PARTICLE_MAX_SIZE - VIZ_PARTICLE_MIN_SIZE));
+        g_viz_radius_lut[i] = constrain(size, VIZ_PARTICLE_MIN_SIZE, VIZ_PARTICLE_MAX_SIZE) / 2;
     }
-}
 
-// Initialize feedback LUT (scaled feedback values)
-void initFeedbackLut() {
-    for(int i=0; i<FEEDBACK_LUT_SIZE; i++) {
-        float f = FEEDBACK_LUT_MIN + ((float)i / (FEEDBACK_LUT_SIZE - 1)) * FEEDBACK_LUT_RANGE;
-        g_feedback_lut_q15[i] = (int16_t)(f * 32767.0f);
+    // 上位ニブル = 左ピクセル。SPIへはそのまま流すのでRGB565はバイトスワップしておく
+    for (int b = 0; b < 256; b++) {
+        uint16_t left = VIZ_PALETTE[b >> 4], right = VIZ_PALETTE[b & 0x0F];
+        left = (uint16_t)((left << 8) | (left >> 8));
+        right = (uint16_t)((right << 8) | (right >> 8));
+        g_viz_pixel_pair_lut[b] = (uint32_t)left | ((uint32_t)right << 16);
     }
-}
 
-// Initialize reciprocal LUT (fast division for grain processing)
-void initReciprocalLut() {
-    for(int i=0; i<RECIPROCAL_LUT_SIZE; i++) {
-        uint16_t l = MIN_GRAIN_SIZE + ((MAX_GRAIN_SIZE - MIN_GRAIN_SIZE) * i) / (RECIPROCAL_LUT_SIZE - 1);
-        g_reciprocal_lut_q32[i] = (l > 0) ? (uint32_t)(((1ULL << 32) - 1) / l) : 0;
+    g_vizSprite.setColorDepth(VIZ_SPRITE_COLOR_DEPTH);
+    if (g_vizSprite.createSprite(VIZ_SPRITE_WIDTH, VIZ_PARTICLE_HEIGHT) == nullptr) {
+        Serial.println("ERROR: Visualizer sprite allocation failed (particles disabled)");
+        return;
     }
+    g_vizSprite.createPalette(VIZ_PALETTE, 16);
+    g_vizSprite.fillSprite(VIZ_PAL_BG);
+    // 初回フレームで全列の波形を描く（オーディオタスク起動前なので競合しない）
+    memset(g_wave_dirty, 0xFF, sizeof(g_wave_dirty));
+    g_vizSpriteReady = true;  // DMA は tft.init() の後に setup() で有効にする
 }
 
-// Initialize random pan LUT (pre-generated random panning values)
-void initRandomPanLut() {
-    for(int i=0; i<RANDOM_PAN_LUT_SIZE; i++) {
-        g_random_pan_lut[i] = ((esp_random() % 20001) / 10000.0f) - 1.0f;
-    }
+// ================================================================= //
+// SECTION: Initialization & Helpers
+// ================================================================= //
+// 電源投入から最初の処理済み出力までの時間（最初の出力後に1回だけ）
+// 入力が届くまでの時間は BT の接続操作しだいなので、入力 → 出力の区間も分けて出す
+void printBootTimeline() {
+    g_boot.reported = true;
+    Serial.printf("\n⏱  First output: %.1f ms after power-on (first A2DP input %.1f ms, input -> output %.1f ms)\n",
+        g_boot.first_output_us / 1000.0, g_boot.first_input_us / 1000.0,
+        (int32_t)(g_boot.first_output_us - g_boot.first_input_us) / 1000.0);
 }
 
-// Initialize random LUT (pre-generated random values)
-void initRandomLut() {
-    for(int i=0; i<RANDOM_LUT_SIZE; i++) {
-        g_random_lut_q15[i] = (esp_random() % 65535) - 32767;
+// LUT の配置とサイズ（どれが内部RAMを使っているかを起動時に確認する）
+void printLutFootprint() {
+    struct LutInfo { const char* name; uint32_t bytes; bool dram; const void* addr; };
+    const LutInfo luts[] = {
+        { "env hann2",   sizeof(g_env_hann2_lut_q15), true,  g_env_hann2_lut_q15 },
+        { "env exp",     sizeof(g_env_exp_lut_q15),   true,  g_env_exp_lut_q15 },
+        { "env taper",   sizeof(g_env_taper_lut_q15), true,  g_env_taper_lut_q15 },
+        { "pitch",       sizeof(g_pitch_lut_q16),     true,  g_pitch_lut_q16 },
+        { "sinc",        sizeof(g_sinc_lut_q15),      true,  &g_sinc_lut_q15 },
+#ifdef GRAIN_ULAW_ENABLED
+        { "mu-law dec",  sizeof(g_grain_decode_lut),  true,  g_grain_decode_lut },
+#endif
+        { "pan",         sizeof(g_pan_lut_q15),       false, g_pan_lut_q15 },
+        { "mix",         sizeof(g_mix_lut_q15),       false, g_mix_lut_q15 },
+        { "feedback",    sizeof(g_feedback_lut_q15),  false, g_feedback_lut_q15 },
+    };
+    uint32_t dram_bytes = 0, flash_bytes = 0;
+    Serial.printf("\n📐 LUTs (generated at compile time):\n");
+    for (const LutInfo& l : luts) {
+        Serial.printf("   %-11s %5u bytes  %-5s %p\n", l.name, (unsigned)l.bytes, l.dram ? "DRAM" : "flash", l.addr);
+        (l.dram ? dram_bytes : flash_bytes) += l.bytes;
     }
+    Serial.printf("   Total: DRAM %u bytes | flash %u bytes\n", (unsigned)dram_bytes, (unsigned)flash_bytes);
 }
 
-// Initialize all lookup tables
-void initAllLuts() {
-    initWindowLut();
-    initPitchLut();
-    initPanLut();
-    initMixLut();
-    initFeedbackLut();
-    initReciprocalLut();
-    initRandomPanLut();
-    initRandomLut();
-}
 
 // ================================================================= //
 // SECTION: Reverb Engine Implementation
 // ================================================================= //
+// 要求されたエンジンでディレイメモリを切り直し、書き込み位置・フィルタ状態を戻す（メモリはクリアしない）
+// 係数は updateReverbParams() が持つ（オーディオタスクから呼んでも整数演算だけで済む）
+void layoutReverb() {
+    g_reverb_engine_active = g_params.reverb_engine;
+    if (g_reverb_engine_active == REVERB_FREEVERB) {
+        g_reverb.init(g_reverbMem);
+    } else {
+        g_fdn.init(g_reverbMem, REVERB_MEM_SAMPLES, g_reverb_engine_active == REVERB_FDN8 ? 8 : 4);
+    }
+}
+
+// クリアして切り直す（起動時・ベンチマーク用。オーディオ処理中は停止中に分けてクリアする）
 void initReverb() {
-    // コムフィルタ初期化（左チャンネル）
-    g_reverb.combL[0].init(g_reverbCombL1, 1116);
-    g_reverb.combL[1].init(g_reverbCombL2, 1188);
-    g_reverb.combL[2].init(g_reverbCombL3, 1277);
-    g_reverb.combL[3].init(g_reverbCombL4, 1356);
-
-    // コムフィルタ初期化（右チャンネル）
-    g_reverb.combR[0].init(g_reverbCombR1, 1422);
-    g_reverb.combR[1].init(g_reverbCombR2, 1491);
-    g_reverb.combR[2].init(g_reverbCombR3, 1557);
-    g_reverb.combR[3].init(g_reverbCombR4, 1617);
-
-    // オールパス初期化（左チャンネル）
-    g_reverb.apL[0].init(g_reverbApL1, 225);
-    g_reverb.apL[1].init(g_reverbApL2, 341);
-
-    // オールパス初期化（右チャンネル）
-    g_reverb.apR[0].init(g_reverbApR1, 441);
-    g_reverb.apR[1].init(g_reverbApR2, 556);
-
-    // バッファクリア
-    memset(g_reverbCombL1, 0, sizeof(g_reverbCombL1));
-    memset(g_reverbCombL2, 0, sizeof(g_reverbCombL2));
-    memset(g_reverbCombL3, 0, sizeof(g_reverbCombL3));
-    memset(g_reverbCombL4, 0, sizeof(g_reverbCombL4));
-    memset(g_reverbCombR1, 0, sizeof(g_reverbCombR1));
-    memset(g_reverbCombR2, 0, sizeof(g_reverbCombR2));
-    memset(g_reverbCombR3, 0, sizeof(g_reverbCombR3));
-    memset(g_reverbCombR4, 0, sizeof(g_reverbCombR4));
-    memset(g_reverbApL1, 0, sizeof(g_reverbApL1));
-    memset(g_reverbApL2, 0, sizeof(g_reverbApL2));
-    memset(g_reverbApR1, 0, sizeof(g_reverbApR1));
-    memset(g_reverbApR2, 0, sizeof(g_reverbApR2));
-
-    // デフォルトパラメータ設定
-    updateReverbParams(16384);  // 50%のルームサイズ
+    memset(g_reverbMem, 0, sizeof(g_reverbMem));
+    layoutReverb();
 }
 
 void updateReverbParams(int16_t roomSize_q15) {
-    // ルームサイズ (0-32767) からフィードバックとダンピングを計算
-    // roomSize: 0% = タイト, 100% = 大ホール
-
-    // フィードバックゲイン: 0.70 → 0.95
-    // feedback_q15 = 22937 + (roomSize_q15 * 8192 / 32767)
-    int16_t feedback_q15 = 22937 + ((int32_t)roomSize_q15 * 8192 >> 15);
-
-    // ダンピング: 0.20 → 0.80 (逆転：小さいルームほど高域減衰大)
-    // damping_q15 = 26214 - (roomSize_q15 * 19661 / 32767)
-    int16_t damping_q15 = 26214 - ((int32_t)roomSize_q15 * 19661 >> 15);
+    // ルームサイズ (0-32767) からフィードバックとダンピングを計算（全コムフィルタに適用）
+    int16_t feedback_q15, damping_q15;
+    reverbRoomCoefs(roomSize_q15, feedback_q15, damping_q15);
+    g_reverb.setParams(feedback_q15, damping_q15);
+
+    // FDN: 残響時間 0.4s → 6s から、ライン長ごとに1周あたりの減衰を求める（全ラインが同じ速さで減衰）
+    // g = 10^(-3 × 長さ / (fs × RT60))、Hadamard の正規化 1/√N は 1/N（割り算）×√N（ゲイン側）に分ける
+    // 4/8ライン両方を計算しておき、エンジン切り替え（オーディオタスク側）では浮動小数点を使わない
+    float rt60_samples = 0.4f * powf(15.0f, roomSize_q15 / 32767.0f) * 44100.0f;
+    for (int c = 0; c < 2; c++) {
+        const int lines = c ? 8 : 4;
+        const float sqrt_n = sqrtf((float)lines);
+        for (int i = 0; i < lines; i++) {
+            float g = powf(10.0f, -3.0f * FdnReverb::lineLength(REVERB_MEM_SAMPLES, lines, i) / rt60_samples);
+            g_fdn.gain_q13[c][i] = (int16_t)(g * sqrt_n * 8192.0f);
+        }
+    }
+    g_fdn.damping_q15 = damping_q15;
+}
 
-    // 全コムフィルタに適用
-    for (int i = 0; i < 4; i++) {
-        g_reverb.combL[i].feedback_q15 = feedback_q15;
-        g_reverb.combL[i].damping_q15 = damping_q15;
-        g_reverb.combR[i].feedback_q15 = feedback_q15;
-        g_reverb.combR[i].damping_q15 = damping_q15;
+// エンジン切り替えは processOutputStage() が停止・クリアを経て layoutReverb() で反映する
+void processReverbBlock(const int16_t* inL, const int16_t* inR, int16_t* outL, int16_t* outR, int n) {
+    if (g_reverb_engine_active == REVERB_FDN4) {
+        g_fdn.processBlock<4>(inL, inR, outL, outR, n);
+        return;
+    }
+    if (g_reverb_engine_active == REVERB_FDN8) {
+        g_fdn.processBlock<8>(inL, inR, outL, outR, n);
+        return;
     }
+
+    g_reverb.processBlock<AUDIO_BLOCK_SIZE>(inL, inR, outL, outR, n);
 }
 
+#ifdef PROFILE_ENABLED
+// サンプル単位の参照実装（ブロック版のビット一致確認とサイクル比較用）
 void processReverb(int16_t inL, int16_t inR, int16_t& outL, int16_t& outR) {
-    // 1. コムフィルタ処理（並列）
-    int32_t combOutL = 0;
-    int32_t combOutR = 0;
+    g_reverb.process(inL, inR, outL, outR);
+}
 
-    for (int i = 0; i < 4; i++) {
-        combOutL += g_reverb.combL[i].process(inL);
-        combOutR += g_reverb.combR[i].process(inR);
+// 起動時にリバーブを参照実装とブロック版で同じノイズ入力に通し、出力の一致とサイクル数を比べる
+// （どちらもクリアした状態から始めるため、終わったら initReverb() で戻す）
+void benchmarkReverb() {
+    constexpr int BENCH_BLOCKS = 16;
+    constexpr int BENCH_SAMPLES = BENCH_BLOCKS * AUDIO_BLOCK_SIZE;
+    static int16_t inL[BENCH_SAMPLES], inR[BENCH_SAMPLES];
+    static int16_t refL[BENCH_SAMPLES], refR[BENCH_SAMPLES];
+    static int16_t outL[AUDIO_BLOCK_SIZE], outR[AUDIO_BLOCK_SIZE];
+    GrainRng rng;
+    rng.seed(0x5EED);
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        inL[i] = rng.bipolarQ15();
+        inR[i] = rng.bipolarQ15();
+    }
+    updateReverbParams(32767);  // フィードバック最大で飽和・ラップ経路も通す
+
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        processReverb(inL[i], inR[i], refL[i], refR[i]);
+    }
+    uint32_t ref_cycles = ESP.getCycleCount() - start;
+
+    initReverb();
+    updateReverbParams(32767);
+    bool match = true;
+    uint32_t block_cycles = 0;
+    for (int b = 0; b < BENCH_BLOCKS; b++) {
+        const int off = b * AUDIO_BLOCK_SIZE;
+        start = ESP.getCycleCount();
+        processReverbBlock(inL + off, inR + off, outL, outR, AUDIO_BLOCK_SIZE);
+        block_cycles += ESP.getCycleCount() - start;
+        if (memcmp(outL, refL + off, sizeof(outL)) != 0 || memcmp(outR, refR + off, sizeof(outR)) != 0) match = false;
+    }
+
+    g_perf.reverb_ref_cycles_x10 = (uint16_t)((ref_cycles * 10) / BENCH_SAMPLES);
+    g_perf.reverb_block_cycles_x10 = (uint16_t)((block_cycles * 10) / BENCH_SAMPLES);
+    g_perf.reverb_bit_exact = match;
+
+    // FDN 4/8ライン（同じメモリ予算）のコスト
+    const ReverbEngine saved_engine = g_params.reverb_engine;
+    for (int e = REVERB_FDN4; e <= REVERB_FDN8; e++) {
+        g_params.reverb_engine = (ReverbEngine)e;
+        initReverb();
+        updateReverbParams(32767);
+        uint32_t fdn_cycles = 0;
+        for (int b = 0; b < BENCH_BLOCKS; b++) {
+            const int off = b * AUDIO_BLOCK_SIZE;
+            start = ESP.getCycleCount();
+            processReverbBlock(inL + off, inR + off, outL, outR, AUDIO_BLOCK_SIZE);
+            fdn_cycles += ESP.getCycleCount() - start;
+        }
+        g_perf.reverb_fdn_cycles_x10[e - REVERB_FDN4] = (uint16_t)((fdn_cycles * 10) / BENCH_SAMPLES);
     }
+    g_params.reverb_engine = saved_engine;
+    updateReverbParams(16384);
+    initReverb();
+}
 
-    // 4で割る（4つのコムフィルタの平均）
-    int16_t apInL = (int16_t)(combOutL >> 2);
-    int16_t apInR = (int16_t)(combOutR >> 2);
-
-    // 2. オールパス処理（直列）
-    int16_t apOutL = g_reverb.apL[0].process(apInL);
-    apOutL = g_reverb.apL[1].process(apOutL);
+// 起動時に dsp_math.h のターゲット命令版（CLAMPS / MULL+MULSH）を移植版と照合する
+// （境界値 + 乱数。ホストビルドでは両者が同じ実装なので常に0）
+void dspMathSelfTest() {
+    static const int32_t EDGES[] = {
+        0, 1, -1, 32767, -32768, 32768, -32769, 65535, -65536,
+        0x3FFFFFFF, -0x40000000, 0x7FFFFFFF, (int32_t)0x80000000
+    };
+    constexpr int N_EDGES = sizeof(EDGES) / sizeof(EDGES[0]);
+    constexpr int N_RANDOM = 4096;
+    uint32_t mismatches = 0;
+
+    for (int i = 0; i < N_EDGES; i++) {
+        if (sat16(EDGES[i]) != sat16Ref(EDGES[i])) mismatches++;
+        for (int j = 0; j < N_EDGES; j++) {
+            if (mulShr<15>(EDGES[i], EDGES[j]) != mulShrRef<15>(EDGES[i], EDGES[j])) mismatches++;
+            if (mulShr<16>(EDGES[i], EDGES[j]) != mulShrRef<16>(EDGES[i], EDGES[j])) mismatches++;
+        }
+    }
 
-    int16_t apOutR = g_reverb.apR[0].process(apInR);
-    apOutR = g_reverb.apR[1].process(apOutR);
+    GrainRng rng;
+    rng.seed(0xD5B0);
+    for (int i = 0; i < N_RANDOM; i++) {
+        int32_t a = (int32_t)rng.next();
+        int32_t b = (int32_t)rng.next();
+        int32_t b15 = b >> 16;  // Q15 係数相当
+        if (sat16(a) != sat16Ref(a)) mismatches++;
+        if (sat16(a >> 14) != sat16Ref(a >> 14)) mismatches++;
+        if (mulShr<15>(a, b15) != mulShrRef<15>(a, b15)) mismatches++;
+        if (mulShr<16>(a, b) != mulShrRef<16>(a, b)) mismatches++;
+    }
 
-    outL = apOutL;
-    outR = apOutR;
+    g_perf.dsp_math_mismatches = mismatches;
 }
+#endif
 
 const char* getModeString(PlayMode m) {
-    return (m == MODE_GRANULAR) ? "GRAN" : "REV ";
+    switch (m) {
+        case MODE_REVERSE:    return "REV ";
+        case MODE_RANDOM_DIR: return "RND ";
+        default:              return "GRAN";
+    }
 }
 
 const char* getPot4ModeString(Pot4Mode m) {
@@ -2021,6 +4056,15 @@ const char* getPot4ModeString(Pot4Mode m) {
         case MODE_CLK_RESOLUTION:  return "CLK";
         case MODE_REVERB_MIX:      return "RVB MIX";
         case MODE_REVERB_ROOM:     return "RVB ROOM";
+        case MODE_DENSITY:         return "DENS";
         default:                   return "---";
     }
+}
+
+const char* getReverbEngineString(ReverbEngine e) {
+    switch (e) {
+        case REVERB_FDN4: return "FDN4";
+        case REVERB_FDN8: return "FDN8";
+        default:          return "FV";
+    }
 }
\ No newline at end of file
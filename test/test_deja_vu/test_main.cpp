@@ -0,0 +1,135 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Host Test: Deja Vu Loop & Snapshot Replay
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// deja_vu.h の DejaVuLoop を、本体のスナップショット保存・ロード（applyLayerRequests）と同じ手順で動かす。
+//   - 保存: 今のループを写し、新しいシードで再シード、ステップ 0
+//   - ロード: シードで再シード、保存したループに戻す、ステップ 0
+//   - DEJA VU > 0（再生と新規が混ざる）でも、同じスナップショットを2回ロードすると同じ ParamSnapshot 列になる
+//   - 再シードだけでループを戻さない（以前の実装）と、途中でループが変わっていれば列がずれる
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "deja_vu.h"
+
+constexpr int TRIGGERS = 512;
+
+struct Snapshot {
+    uint32_t rng_seed;
+    ParamSnapshot deja_vu[DEJA_VU_BUFFER_SIZE];
+};
+
+static GrainRng g_rng;
+static DejaVuLoop g_loop;
+static ParamSnapshot g_seqA[TRIGGERS], g_seqB[TRIGGERS];
+
+static const ParamSnapshot KNOBS = {12000, 20000, 3 * 256, 24000};
+static const ParamSnapshot WARM_KNOBS = {3000, 8000, -5 * 256, 4000};  // 保存前（TEXTURE で見分ける）
+
+static void saveSnapshot(Snapshot& snap, uint32_t seed) {
+    memcpy(snap.deja_vu, g_loop.steps, sizeof(snap.deja_vu));
+    snap.rng_seed = seed;
+    g_rng.seed(seed);
+    g_loop.step = 0;
+}
+
+static void loadSnapshot(const Snapshot& snap) {
+    g_rng.seed(snap.rng_seed);
+    g_loop.restore(snap.deja_vu);
+}
+
+// クロック1回ぶん。本体の triggerGrain も同じ乱数から速度・パン・向きを引くので、その分も進める
+static void runTriggers(ParamSnapshot* out, int16_t deja_vu_q15, int loop_length, const ParamSnapshot& knobs = KNOBS) {
+    for (int i = 0; i < TRIGGERS; i++) {
+        out[i] = g_loop.next(g_rng, knobs, deja_vu_q15, loop_length);
+        g_rng.next();
+        g_rng.next();
+        g_rng.next();
+    }
+}
+
+static int firstDifference(const ParamSnapshot* a, const ParamSnapshot* b) {
+    for (int i = 0; i < TRIGGERS; i++) {
+        if (memcmp(&a[i], &b[i], sizeof(ParamSnapshot)) != 0) return i;
+    }
+    return -1;
+}
+
+// 保存前にしばらく動かして、ループに中身を作っておく
+static void warmUp(Snapshot& snap, int16_t deja_vu_q15, int loop_length) {
+    memset(&g_loop, 0, sizeof(g_loop));
+    g_rng.seed(0xDE7A);
+    runTriggers(g_seqA, deja_vu_q15, loop_length, WARM_KNOBS);
+    saveSnapshot(snap, 0x5A5A1234);
+}
+
+// ================================================================
+// テスト
+// ================================================================
+void test_two_loads_give_identical_sequences() {
+    static const int16_t DEJA_VU[] = {1, 8192, 16384, 24576, 32767};
+    static const int LOOP_LENGTHS[] = {2, 5, 16};
+    for (int16_t dv : DEJA_VU) {
+        for (int len : LOOP_LENGTHS) {
+            Snapshot snap;
+            warmUp(snap, dv, len);
+            loadSnapshot(snap);
+            runTriggers(g_seqA, dv, len);
+            // ロードの間に別の DEJA VU で動かしてループを書き換えておく
+            runTriggers(g_seqB, 0, len);
+            loadSnapshot(snap);
+            runTriggers(g_seqB, dv, len);
+            char msg[80];
+            snprintf(msg, sizeof(msg), "deja vu %d, loop %d: first difference at trigger %d", (int)dv, len, firstDifference(g_seqA, g_seqB));
+            TEST_ASSERT_EQUAL_INT_MESSAGE(-1, firstDifference(g_seqA, g_seqB), msg);
+        }
+    }
+}
+
+// 保存直後の列（保存で再シードした時点から）とロード後の列も同じ
+void test_load_replays_from_save_point() {
+    Snapshot snap;
+    warmUp(snap, 20000, 8);
+    runTriggers(g_seqA, 20000, 8);
+    loadSnapshot(snap);
+    runTriggers(g_seqB, 20000, 8);
+    TEST_ASSERT_EQUAL_INT(-1, firstDifference(g_seqA, g_seqB));
+}
+
+// 比較が空振りしていないこと: 保存したループの再生（TEXTURE が保存前の値）と新規の両方が起きていて、
+// ループを戻さずに再シードだけすると（以前の実装）列がずれる
+void test_reseed_without_loop_restore_diverges() {
+    Snapshot snap;
+    warmUp(snap, 16384, 8);
+    loadSnapshot(snap);
+    runTriggers(g_seqA, 16384, 8);
+    int replayed_saved = 0, fresh = 0;
+    for (int i = 0; i < TRIGGERS; i++) {
+        if (g_seqA[i].texture_q15 == WARM_KNOBS.texture_q15) replayed_saved++;
+        else fresh++;
+    }
+    TEST_ASSERT_TRUE(replayed_saved > 0);
+    TEST_ASSERT_TRUE(fresh > 0);
+
+    runTriggers(g_seqB, 0, 8);
+    g_rng.seed(snap.rng_seed);
+    g_loop.step = 0;
+    runTriggers(g_seqB, 16384, 8);
+    TEST_ASSERT_TRUE(firstDifference(g_seqA, g_seqB) >= 0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_two_loads_give_identical_sequences);
+    RUN_TEST(test_load_replays_from_save_point);
+    RUN_TEST(test_reseed_without_loop_restore_diverges);
+    return UNITY_END();
+}
@@ -0,0 +1,246 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Host Test: Fixed-point DSP helpers
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// dsp_math.h の各ヘルパーを、同じヘッダの *Ref（64bit で定義どおりに計算する版）と比べる。
+// ホストでは __XTENSA__ が無いので移植版が通る（mulShr は実機と同じ上位/下位の組み立て）。
+//   - sat16: int32 の全値、addSat16: int16 × int16 の全組み合わせ
+//   - mulQ15 / mulQ15Round / mulQ15Wide / mulQ16 / macQ15 / lerpQ15 / onePoleQ15 /
+//     clamp32 / mix2Q15 / softClip: 端の値 + 乱数（各ヘルパーの定義域の中で）
+//   - mulShr<S>: 使っている S = 15, 16 は端 + 乱数、組み立て自体は S = 1..31 の全部
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "dsp_math.h"
+
+constexpr int RANDOM_CASES = 4000000;
+
+static uint32_t g_rng_state = 0x2468ACEu;
+static uint32_t nextRand() {
+    g_rng_state ^= g_rng_state << 13;
+    g_rng_state ^= g_rng_state >> 17;
+    g_rng_state ^= g_rng_state << 5;
+    return g_rng_state;
+}
+static int16_t nextQ15() { return (int16_t)(nextRand() >> 16); }
+
+static const int32_t EDGES16[] = {-32768, -32767, -16385, -16384, -1, 0, 1, 16383, 16384, 32766, 32767};
+static const int32_t FRACS[] = {0, 1, 16384, 32767};
+static const int32_t EDGES32[] = {
+    INT32_MIN, INT32_MIN + 1, -65536, -32769, -32768, -32767, -1, 0, 1, 32767, 32768, 65535, INT32_MAX - 1, INT32_MAX
+};
+
+// 最初に一致しなかった入力を表示する
+static void reportMismatch(uint32_t mismatches, const char* name, int64_t a, int64_t b) {
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%s: %u mismatches, first at (%lld, %lld)", name, (unsigned)mismatches, (long long)a, (long long)b);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, mismatches, msg);
+}
+
+// ================================================================
+// 飽和
+// ================================================================
+void test_sat16_exhaustive() {
+    uint32_t mismatches = 0;
+    int64_t first = 0;
+    for (int64_t x = INT32_MIN; x <= INT32_MAX; x++) {
+        if (sat16((int32_t)x) != sat16Ref((int32_t)x)) {
+            if (mismatches == 0) first = x;
+            mismatches++;
+        }
+    }
+    reportMismatch(mismatches, "sat16", first, 0);
+}
+
+void test_add_sat16_exhaustive() {
+    uint32_t mismatches = 0;
+    int64_t fa = 0, fb = 0;
+    for (int32_t a = -32768; a <= 32767; a++) {
+        for (int32_t b = -32768; b <= 32767; b++) {
+            if (addSat16(a, b) != addSat16Ref(a, b)) {
+                if (mismatches == 0) { fa = a; fb = b; }
+                mismatches++;
+            }
+        }
+    }
+    reportMismatch(mismatches, "addSat16", fa, fb);
+}
+
+// ================================================================
+// 乗算
+// ================================================================
+// 上位（MULSH）と下位（MULL）から組み立てた値が、全ての S で64bit積のシフトと一致すること
+template <int S>
+static uint32_t composeMismatches(int32_t a, int32_t b) {
+    return (mulShr<S>(a, b) != mulShrRef<S>(a, b) ? 1u : 0u) + composeMismatches<S - 1>(a, b);
+}
+template <>
+uint32_t composeMismatches<0>(int32_t, int32_t) { return 0; }
+
+void test_mul_shr_in_use_edges_and_random() {
+    uint32_t mismatches = 0;
+    int64_t fa = 0, fb = 0;
+    for (int32_t a : EDGES32) {
+        for (int32_t b : EDGES32) {
+            if (mulShr<15>(a, b) != mulShrRef<15>(a, b) || mulShr<16>(a, b) != mulShrRef<16>(a, b)) {
+                if (mismatches == 0) { fa = a; fb = b; }
+                mismatches++;
+            }
+        }
+    }
+    for (int i = 0; i < RANDOM_CASES; i++) {
+        int32_t a = (int32_t)nextRand();
+        int32_t b = (int32_t)nextRand();
+        int32_t b15 = nextQ15();
+        if (mulShr<15>(a, b15) != mulShrRef<15>(a, b15) || mulShr<16>(a, b) != mulShrRef<16>(a, b)) {
+            if (mismatches == 0) { fa = a; fb = b; }
+            mismatches++;
+        }
+    }
+    reportMismatch(mismatches, "mulShr<15/16>", fa, fb);
+}
+
+void test_mul_shr_compose_all_shifts() {
+    uint32_t mismatches = 0;
+    for (int32_t a : EDGES32) {
+        for (int32_t b : EDGES32) mismatches += composeMismatches<31>(a, b);
+    }
+    for (int i = 0; i < RANDOM_CASES / 16; i++) {
+        mismatches += composeMismatches<31>((int32_t)nextRand(), (int32_t)nextRand());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+}
+
+// Q15 の積（定義域: int16 同士。Wide / Q16 は片方が32bit）
+void test_mul_q15_family() {
+    uint32_t mismatches = 0;
+    int64_t fa = 0, fb = 0;
+    for (int32_t a : EDGES16) {
+        for (int32_t b : EDGES16) {
+            if (mulQ15(a, b) != mulQ15Ref(a, b) || mulQ15Round(a, b) != mulQ15RoundRef(a, b)) {
+                if (mismatches == 0) { fa = a; fb = b; }
+                mismatches++;
+            }
+        }
+    }
+    for (int i = 0; i < RANDOM_CASES; i++) {
+        int32_t a = nextQ15(), b = nextQ15();
+        int32_t w = (int32_t)nextRand(), q16 = (int32_t)nextRand();
+        bool ok = mulQ15(a, b) == mulQ15Ref(a, b) &&
+                  mulQ15Round(a, b) == mulQ15RoundRef(a, b) &&
+                  mulQ15Wide(w, b) == mulQ15WideRef(w, b) &&
+                  mulQ16(w, q16) == mulQ16Ref(w, q16);
+        if (!ok) {
+            if (mismatches == 0) { fa = a; fb = b; }
+            mismatches++;
+        }
+    }
+    reportMismatch(mismatches, "mulQ15/Round/Wide/Q16", fa, fb);
+}
+
+// 丸め版は真値から ±0.5LSB 以内、0.5 ちょうどは正方向。切り捨て版は常に真値以下
+void test_mul_q15_round_direction() {
+    TEST_ASSERT_EQUAL_INT32(1, mulQ15Round(1, 16384));     // 0.5 → 1
+    TEST_ASSERT_EQUAL_INT32(0, mulQ15Round(-1, 16384));    // -0.5 → 0
+    TEST_ASSERT_EQUAL_INT32(-1, mulQ15(-1, 16384));        // 切り捨ては -1
+    TEST_ASSERT_EQUAL_INT32(-1, mulQ15Round(-3, 16384));   // -1.5 → -1
+    int64_t sum_trunc = 0, sum_round = 0, sum_exact_q15 = 0;
+    for (int i = 0; i < RANDOM_CASES; i++) {
+        int32_t a = nextQ15(), b = nextQ15();
+        int64_t p = (int64_t)a * b;
+        sum_trunc += mulQ15(a, b);
+        sum_round += mulQ15Round(a, b);
+        sum_exact_q15 += p;
+        int64_t err2 = 2 * ((int64_t)mulQ15Round(a, b) * 32768 - p);
+        TEST_ASSERT_TRUE(err2 > -32768 && err2 <= 32768);
+    }
+    // 切り捨ての偏り（平均 -0.5LSB）が丸めで消える
+    double bias_trunc = (double)(sum_trunc * 32768 - sum_exact_q15) / 32768.0 / RANDOM_CASES;
+    double bias_round = (double)(sum_round * 32768 - sum_exact_q15) / 32768.0 / RANDOM_CASES;
+    TEST_ASSERT_FLOAT_WITHIN(0.01, -0.5, bias_trunc);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0.0, bias_round);
+}
+
+// ================================================================
+// 積和・補間・フィルタ・ミックス
+// ================================================================
+void test_mac_lerp_one_pole() {
+    uint32_t mismatches = 0;
+    int64_t fa = 0, fb = 0;
+    for (int32_t a : EDGES16) {
+        for (int32_t b : EDGES16) {
+            for (int32_t f : FRACS) {
+                bool ok = macQ15(a * 1000, a, b) == macQ15Ref(a * 1000, a, b) &&
+                          lerpQ15(a, b, f) == lerpQ15Ref(a, b, f) &&
+                          onePoleQ15(a, b, f) == onePoleQ15Ref(a, b, f);
+                if (!ok) {
+                    if (mismatches == 0) { fa = a; fb = b; }
+                    mismatches++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < RANDOM_CASES; i++) {
+        int32_t a = nextQ15(), b = nextQ15();
+        int32_t f = (int32_t)(nextRand() & 0x7FFF);
+        int32_t acc = (int32_t)nextRand() >> 4;
+        bool ok = macQ15(acc, a, b) == macQ15Ref(acc, a, b) &&
+                  lerpQ15(a, b, f) == lerpQ15Ref(a, b, f) &&
+                  onePoleQ15(a, b, f) == onePoleQ15Ref(a, b, f);
+        if (!ok) {
+            if (mismatches == 0) { fa = a; fb = b; }
+            mismatches++;
+        }
+    }
+    reportMismatch(mismatches, "macQ15/lerpQ15/onePoleQ15", fa, fb);
+}
+
+void test_clamp_mix_soft_clip() {
+    uint32_t mismatches = 0;
+    int64_t fa = 0, fb = 0;
+    for (int32_t x : EDGES32) {
+        for (int32_t lo : EDGES16) {
+            if (clamp32(x, lo, 32767) != clamp32Ref(x, lo, 32767) || softClip(x) != softClipRef(x)) {
+                if (mismatches == 0) { fa = x; fb = lo; }
+                mismatches++;
+            }
+        }
+    }
+    for (int i = 0; i < RANDOM_CASES; i++) {
+        int32_t x = (int32_t)nextRand();
+        int32_t lo = (int32_t)nextRand() >> 1;
+        int32_t hi = lo + (int32_t)(nextRand() >> 1);
+        int32_t in = nextQ15(), ga = nextQ15(), gb = nextQ15();
+        int32_t wet = (int32_t)nextRand() >> 12;  // 32bit のウェットバス（±2^19）
+        bool ok = clamp32(x, lo, hi) == clamp32Ref(x, lo, hi) &&
+                  mix2Q15(in, ga, wet, gb) == mix2Q15Ref(in, ga, wet, gb) &&
+                  softClip(x) == softClipRef(x) &&
+                  softClip(x >> 14) == softClipRef(x >> 14);
+        if (!ok) {
+            if (mismatches == 0) { fa = x; fb = lo; }
+            mismatches++;
+        }
+    }
+    reportMismatch(mismatches, "clamp32/mix2Q15/softClip", fa, fb);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_sat16_exhaustive);
+    RUN_TEST(test_add_sat16_exhaustive);
+    RUN_TEST(test_mul_shr_in_use_edges_and_random);
+    RUN_TEST(test_mul_shr_compose_all_shifts);
+    RUN_TEST(test_mul_q15_family);
+    RUN_TEST(test_mul_q15_round_direction);
+    RUN_TEST(test_mac_lerp_one_pole);
+    RUN_TEST(test_clamp_mix_soft_clip);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Host Test: Grain History Codec
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// grain_codec.h の μ-law を確かめる。デコード表は本体と同じ生成式（decodeGrainSampleRef）から作る。
+//   - int16 の全値: 誤差は区間の刻みの半分以内（クリップ域を除く）、符号が保たれ、コードは単調
+//   - 全コード: 復号 → 再符号化で同じ値に戻る、0x00 が無音
+//   - S/N: 起動時ベンチマーク（benchmarkGrainCodec）と同じ正弦波+ノイズを -6 / -30 dBFS で。
+//     あわせて -6..-42 dBFS でレベルによらずほぼ一定なこと
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include "grain_codec.h"
+#include "lut_gen.h"
+
+constexpr lutgen::LutTable<int16_t, 256> DECODE_LUT = lutgen::makeLut<int16_t, 256>(decodeGrainSampleRef);
+
+static uint32_t g_rng_state;
+static int16_t nextNoise() {
+    g_rng_state ^= g_rng_state << 13;
+    g_rng_state ^= g_rng_state >> 17;
+    g_rng_state ^= g_rng_state << 5;
+    return (int16_t)(g_rng_state >> 16);
+}
+
+// 正弦波（441Hz）0.7 + ノイズ 0.3 を level 倍して符号化 → 表で復号した S/N（dB）
+static double measureSnrDb(double level) {
+    constexpr int N = 44100;
+    g_rng_state = 0xC0DEC;
+    double sig = 0.0, err = 0.0;
+    for (int i = 0; i < N; i++) {
+        double v = 0.7 * sin(2.0 * M_PI * 441.0 * i / 44100.0) + 0.3 * nextNoise() / 32768.0;
+        int32_t x = (int32_t)(v * level * 32767.0);
+        int32_t e = DECODE_LUT[encodeGrainSample(x)] - x;
+        sig += (double)x * x;
+        err += (double)e * e;
+    }
+    return 10.0 * log10(sig / err);
+}
+
+// ================================================================
+// テスト
+// ================================================================
+void test_quantization_error_within_half_step() {
+    uint32_t over = 0;
+    int32_t first = 0;
+    for (int32_t x = -32768; x <= 32767; x++) {
+        uint8_t code = encodeGrainSample(x);
+        int32_t y = DECODE_LUT[code];
+        int32_t mag = x < 0 ? -x : x;
+        int32_t target = mag > GRAIN_ULAW_CLIP ? (x < 0 ? -GRAIN_ULAW_CLIP : GRAIN_ULAW_CLIP) : x;
+        int32_t half_step = 4 << ((code >> 4) & 0x07);
+        int32_t e = y - target;
+        bool ok = (e >= -half_step && e <= half_step) && (y == 0 || (y < 0) == (x < 0));
+        if (!ok) {
+            if (over == 0) first = x;
+            over++;
+        }
+    }
+    char msg[64];
+    snprintf(msg, sizeof(msg), "first out of bound at %d", (int)first);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, over, msg);
+}
+
+// 大きい入力ほど大きい（か同じ）値に戻る
+void test_decode_monotonic_in_input() {
+    int32_t prev = DECODE_LUT[encodeGrainSample(-40000)];
+    for (int32_t x = -40000; x <= 40000; x++) {
+        int32_t y = DECODE_LUT[encodeGrainSample(x)];
+        TEST_ASSERT_TRUE(y >= prev);
+        prev = y;
+    }
+}
+
+void test_codes_round_trip_and_silence() {
+    TEST_ASSERT_EQUAL_INT32(0, encodeGrainSample(0));
+    TEST_ASSERT_EQUAL_INT32(0, DECODE_LUT[0]);
+    for (int c = 0; c < 256; c++) {
+        int32_t y = DECODE_LUT[c];
+        TEST_ASSERT_EQUAL_INT32(decodeGrainSampleRef((uint8_t)c), y);
+        // -0（0x80）は +0 と同じ値に戻る
+        uint8_t expect = (c == 0x80) ? 0 : (uint8_t)c;
+        TEST_ASSERT_EQUAL_INT32(expect, encodeGrainSample(y));
+    }
+    TEST_ASSERT_TRUE(encodeGrainSample(INT32_MIN) == encodeGrainSample(-32768));
+    TEST_ASSERT_TRUE(encodeGrainSample(INT32_MAX) == encodeGrainSample(32767));
+}
+
+void test_snr_at_benchmark_levels() {
+    double snr6 = measureSnrDb(0.5);      // -6 dBFS
+    double snr30 = measureSnrDb(0.0316);  // -30 dBFS
+    char msg[96];
+    snprintf(msg, sizeof(msg), "SNR: %.1f dB at -6 dBFS, %.1f dB at -30 dBFS", snr6, snr30);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(snr6 >= 36.0);
+    TEST_ASSERT_TRUE(snr30 >= 33.0);
+}
+
+// 対数圧伸なので -6..-42 dBFS で S/N の差が小さい（8bit 線形なら 36 dB 下がる。
+// 実測 31.5..37.9 dB、下端は最小区間の刻みが効き始める -42 dBFS）
+void test_snr_nearly_level_independent() {
+    double lo = 1e9, hi = -1e9;
+    for (int db = -6; db >= -42; db -= 6) {
+        double snr = measureSnrDb(pow(10.0, db / 20.0));
+        if (snr < lo) lo = snr;
+        if (snr > hi) hi = snr;
+    }
+    char msg[64];
+    snprintf(msg, sizeof(msg), "SNR -6..-42 dBFS: %.1f..%.1f dB", lo, hi);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(hi - lo <= 8.0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_quantization_error_within_half_step);
+    RUN_TEST(test_decode_monotonic_in_input);
+    RUN_TEST(test_codes_round_trip_and_silence);
+    RUN_TEST(test_snr_at_benchmark_levels);
+    RUN_TEST(test_snr_nearly_level_independent);
+    return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Host Test: Grain Trigger Math
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// grain_math.h の整数版（速度・パン）を、整数化する前の float 実装と同じ入力で比べる。
+//   - 速度: Q8.8 の全ピッチ × テクスチャ × 乱数の格子で、同じ式を double で評価した値と ±1LSB 以内。
+//           float 版とは LUT インデックスの境界で float の丸めが隣の段に乗る場合だけずれる（Q8 で1段以内）
+//   - パン: スプレッド × 乱数の格子で L/R とも ±1LSB 以内
+//   - ピッチ LUT: 整数オクターブはちょうど 2^n 倍（±12 半音で 131072 / 32768）
+// LUT は本体と同じ生成式（pitchQ16 / panQ15）から作り、両実装で共有する
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "grain_math.h"
+
+constexpr lutgen::LutTable<int32_t, PITCH_LUT_SIZE> PITCH_LUT = lutgen::makeLut<int32_t, PITCH_LUT_SIZE>(pitchQ16);
+constexpr lutgen::LutTable<int16_t, PAN_LUT_SIZE> PAN_LUT = lutgen::makeLut<int16_t, PAN_LUT_SIZE>(panQ15);
+
+// ================================================================
+// 旧 float 実装（乱数の取り出しだけを引数に置き換えたもの）
+// ================================================================
+static float clampf(float x, float lo, float hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+// 速度は同じ式を float と double の両方で評価できるようにする。
+// float 版は LUT インデックス(Q8)が境界のごく近く（例: 真値 8831.999）だと丸め誤差で
+// 隣の段に乗ることがあり、そこでは補間1段分（最大 (y1-y0)/256 ≈ 11LSB）ずれる。
+// これは整数版の誤差ではなく float 版自身の誤差なので、±1LSB の判定は double で評価した
+// 同じ式に対して行い、float 版とは「ずれても Q8 インデックス1段以内」を確認する。
+template <typename T>
+static int32_t refGrainSpeed(T base_pitch, int16_t texture, int16_t rand_val, int32_t* index_q8_out = nullptr) {
+    const T PITCH_LUT_SCALE = (T)(PITCH_LUT_SIZE - 1) / (T)PITCH_RANGE_SEMITONES;
+    T pitch_rand_comp = (texture / (T)32767) * (T)PITCH_TEXTURE_VARIANCE * (rand_val / (T)32767);
+    T pitch = base_pitch + pitch_rand_comp;
+    T index_f = (pitch + (T)PITCH_RANGE_SEMITONES_HALF) * PITCH_LUT_SCALE;
+    index_f = index_f < 0 ? 0 : (index_f > PITCH_LUT_SIZE - 2 ? (T)(PITCH_LUT_SIZE - 2) : index_f);
+    int index_i = (int)index_f;
+    int32_t frac_q8 = (int32_t)((index_f - index_i) * 256);
+    if (index_q8_out) *index_q8_out = (index_i << 8) + frac_q8;
+    int32_t y0 = PITCH_LUT[index_i], y1 = PITCH_LUT[index_i + 1];
+    int32_t speed = y0 + (((y1 - y0) * frac_q8) >> 8);
+    return clamp32(speed, 1 << 14, 4 << 16);
+}
+
+static void floatGrainPan(int16_t spread_q15, float pan_random, int16_t& panL, int16_t& panR) {
+    float pan = 0.5f + (spread_q15 / 32767.0f) * STEREO_SPREAD_SCALE * pan_random;
+    pan = clampf(pan, 0.0f, 1.0f);
+    float pan_index_f = pan * (PAN_LUT_SIZE - 1);
+    int pan_index_i = clamp32((int)pan_index_f, 0, PAN_LUT_SIZE - 2);
+    int32_t frac_q8 = (int32_t)((pan_index_f - pan_index_i) * 256.0f);
+    panR = PAN_LUT[pan_index_i] + (((PAN_LUT[pan_index_i + 1] - PAN_LUT[pan_index_i]) * frac_q8) >> 8);
+    float pan_index_l_f = (PAN_LUT_SIZE - 1) - pan_index_f;
+    int pan_index_l_i = clamp32((int)pan_index_l_f, 0, PAN_LUT_SIZE - 2);
+    int32_t frac_l_q8 = (int32_t)((pan_index_l_f - pan_index_l_i) * 256.0f);
+    panL = PAN_LUT[pan_index_l_i] + (((PAN_LUT[pan_index_l_i + 1] - PAN_LUT[pan_index_l_i]) * frac_l_q8) >> 8);
+}
+
+// ================================================================
+// テスト
+// ================================================================
+static const int16_t RANDS[] = {
+    -32767, -32766, -30000, -24576, -16384, -12345, -8192, -4096, -1000, -257, -1, 0,
+    1, 255, 999, 4097, 8191, 12346, 16383, 20000, 24577, 30001, 32766, 32767
+};
+constexpr int N_RANDS = sizeof(RANDS) / sizeof(RANDS[0]);
+
+void test_speed_within_1lsb_of_float_formula() {
+    static const int16_t TEXTURES[] = {0, 1, 4096, 8192, 12288, 16384, 24576, 30000, 32767};
+    uint32_t cases = 0, differ = 0, float_boundary = 0;
+    int32_t max_err = 0, max_float_err = 0, max_float_step = 0;
+    for (int32_t q8 = -PITCH_RANGE_Q8_HALF; q8 <= PITCH_RANGE_Q8_HALF; q8++) {
+        for (int16_t tex : TEXTURES) {
+            for (int r = 0; r < N_RANDS; r++) {
+                int32_t a = grainSpeedQ16(PITCH_LUT, (int16_t)q8, tex, RANDS[r]);
+                int32_t b = refGrainSpeed<double>((double)q8 / PITCH_Q8_ONE, tex, RANDS[r]);
+                int32_t err = abs(a - b);
+                if (err) differ++;
+                if (err > max_err) max_err = err;
+
+                // float 版: ずれるのはインデックス境界で1段隣に乗った時だけ
+                int32_t idx_d, idx_f;
+                refGrainSpeed<double>((double)q8 / PITCH_Q8_ONE, tex, RANDS[r], &idx_d);
+                int32_t f = refGrainSpeed<float>((float)q8 / PITCH_Q8_ONE, tex, RANDS[r], &idx_f);
+                int32_t ferr = abs(a - f);
+                if (ferr > 1) {
+                    float_boundary++;
+                    if (abs(idx_f - idx_d) > max_float_step) max_float_step = abs(idx_f - idx_d);
+                }
+                if (ferr > max_float_err) max_float_err = ferr;
+                cases++;
+            }
+        }
+    }
+    char msg[160];
+    snprintf(msg, sizeof(msg), "speed: %u cases, %u differ (max %d LSB); float32: %u boundary cases (max %d LSB, %d Q8 step)",
+             (unsigned)cases, (unsigned)differ, (int)max_err, (unsigned)float_boundary, (int)max_float_err, (int)max_float_step);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(1, max_err);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(1, max_float_step);
+}
+
+// LUT: オクターブの格子点（64エントリごと）はちょうど 2^n × 65536、それ以外は真値の切り捨て
+void test_pitch_lut_octaves_exact() {
+    static const int32_t OCTAVES[] = {16384, 32768, 65536, 131072, 262144};
+    for (int k = 0; k < 5; k++) {
+        TEST_ASSERT_EQUAL_INT32(OCTAVES[k], PITCH_LUT[k * (PITCH_LUT_SIZE - 1) / 4]);
+    }
+    for (int i = 0; i < PITCH_LUT_SIZE; i++) {
+        double exact = pow(2.0, ((double)i / (PITCH_LUT_SIZE - 1) * 48.0 - 24.0) / 12.0) * 65536.0;
+        TEST_ASSERT_EQUAL_INT32((int32_t)floor(exact + 1e-9), PITCH_LUT[i]);
+    }
+}
+
+void test_pan_matches_float_within_1lsb() {
+    uint32_t cases = 0, differ = 0;
+    int32_t max_err = 0;
+    for (int32_t spread = 0; spread <= 32767; spread += 7) {
+        for (int r = 0; r < N_RANDS; r++) {
+            int16_t aL, aR, bL, bR;
+            grainPanQ15(PAN_LUT, (int16_t)spread, RANDS[r], aL, aR);
+            floatGrainPan((int16_t)spread, RANDS[r] / 32767.0f, bL, bR);
+            int32_t err = abs(aL - bL) > abs(aR - bR) ? abs(aL - bL) : abs(aR - bR);
+            if (err) differ++;
+            if (err > max_err) max_err = err;
+            cases++;
+        }
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "pan: %u cases, %u differ, max %d LSB", (unsigned)cases, (unsigned)differ, (int)max_err);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(1, max_err);
+}
+
+// 中央（スプレッド0）は等パワーの ±3dB 点、両端は片側だけ
+void test_pan_center_and_edges() {
+    int16_t L, R;
+    grainPanQ15(PAN_LUT, 0, 12345, L, R);
+    TEST_ASSERT_EQUAL_INT32(PAN_LUT[(PAN_LUT_SIZE - 1) / 2], L);
+    TEST_ASSERT_EQUAL_INT32(L, R);
+    TEST_ASSERT_EQUAL_INT32(PAN_LUT[0], 0);
+    TEST_ASSERT_EQUAL_INT32(PAN_LUT[PAN_LUT_SIZE - 1], 32767);
+}
+
+// ピッチ0（テクスチャ0）は等速 1.0、整数オクターブはちょうど2の累乗倍、ピッチに対して単調増加
+// （+24 半音はインデックスを最後の区間の内側に留めるので LUT の端までは届かない。旧 float 版と同じ）
+void test_speed_unity_and_monotonic() {
+    TEST_ASSERT_EQUAL_INT32(65536, grainSpeedQ16(PITCH_LUT, 0, 0, 0));
+    TEST_ASSERT_EQUAL_INT32(131072, grainSpeedQ16(PITCH_LUT, 12 * PITCH_Q8_ONE, 0, 0));
+    TEST_ASSERT_EQUAL_INT32(32768, grainSpeedQ16(PITCH_LUT, -12 * PITCH_Q8_ONE, 0, 0));
+    TEST_ASSERT_EQUAL_INT32(16384, grainSpeedQ16(PITCH_LUT, -24 * PITCH_Q8_ONE, 0, 0));
+    int32_t prev = 0;
+    for (int32_t q8 = -PITCH_RANGE_Q8_HALF; q8 <= PITCH_RANGE_Q8_HALF; q8++) {
+        int32_t s = grainSpeedQ16(PITCH_LUT, (int16_t)q8, 0, 0);
+        TEST_ASSERT_TRUE(s >= prev);
+        prev = s;
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_speed_within_1lsb_of_float_formula);
+    RUN_TEST(test_pitch_lut_octaves_exact);
+    RUN_TEST(test_pan_matches_float_within_1lsb);
+    RUN_TEST(test_pan_center_and_edges);
+    RUN_TEST(test_speed_unity_and_monotonic);
+    return UNITY_END();
+}
@@ -0,0 +1,156 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Host Test: Freeverb block processing
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// reverb.h の Reverb::processBlock()（ブロック版）が process()（サンプル単位の参照実装）と
+// ビット一致することを確かめる。同じメモリ配置・同じ係数の2台に同じ入力を通して比べる。
+//   - ブロック長: AUDIO_BLOCK_SAMPLES の候補（16/32/64）と I2S ブロック（128）、半端な長さの混在
+//   - ルームサイズ: 最小・中央・最大（最大はコムの飽和経路も通る）
+//   - 入力: フルスケールのノイズ、インパルス後の減衰（最長のコムを何周もする長さ）
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "reverb.h"
+
+constexpr int MAX_BLOCK = 128;
+constexpr int TEST_SAMPLES = 24000;  // 最長のコム（1617）の約15周
+
+static int16_t g_memRef[REVERB_FREEVERB_SAMPLES];
+static int16_t g_memBlk[REVERB_FREEVERB_SAMPLES];
+static Reverb g_ref;
+static Reverb g_blk;
+
+static int16_t g_inL[TEST_SAMPLES], g_inR[TEST_SAMPLES];
+static int16_t g_refL[TEST_SAMPLES], g_refR[TEST_SAMPLES];
+
+// 入力用の xorshift32（再現性のため固定シード）
+static uint32_t g_rng_state;
+static int16_t nextNoise() {
+    g_rng_state ^= g_rng_state << 13;
+    g_rng_state ^= g_rng_state >> 17;
+    g_rng_state ^= g_rng_state << 5;
+    return (int16_t)(g_rng_state >> 16);
+}
+
+static void fillNoise(uint32_t seed) {
+    g_rng_state = seed;
+    for (int i = 0; i < TEST_SAMPLES; i++) {
+        g_inL[i] = nextNoise();
+        g_inR[i] = nextNoise();
+    }
+}
+
+// 最初の数ブロックだけ大きな入力、あとは無音（残響の減衰と 0 への収束を比べる）
+static void fillImpulse() {
+    memset(g_inL, 0, sizeof(g_inL));
+    memset(g_inR, 0, sizeof(g_inR));
+    for (int i = 0; i < 64; i++) {
+        g_inL[i] = 32767;
+        g_inR[i] = (i & 1) ? -32768 : 32767;
+    }
+}
+
+static void setupPair(int16_t room_q15) {
+    int16_t fb, damp;
+    reverbRoomCoefs(room_q15, fb, damp);
+    memset(g_memRef, 0, sizeof(g_memRef));
+    memset(g_memBlk, 0, sizeof(g_memBlk));
+    memset(&g_ref, 0, sizeof(g_ref));
+    memset(&g_blk, 0, sizeof(g_blk));
+    g_ref.init(g_memRef);
+    g_blk.init(g_memBlk);
+    g_ref.setParams(fb, damp);
+    g_blk.setParams(fb, damp);
+}
+
+// blocks が 0 で終わるまでの長さを繰り返してブロックに切る。最初に一致しなかったサンプル位置を返す（-1 = 一致）
+static int runAndCompare(int16_t room_q15, const int* blocks) {
+    setupPair(room_q15);
+    for (int i = 0; i < TEST_SAMPLES; i++) {
+        g_ref.process(g_inL[i], g_inR[i], g_refL[i], g_refR[i]);
+    }
+    int16_t outL[MAX_BLOCK], outR[MAX_BLOCK];
+    int pos = 0, b = 0;
+    while (pos < TEST_SAMPLES) {
+        if (blocks[b] == 0) b = 0;
+        int n = blocks[b++];
+        if (n > TEST_SAMPLES - pos) n = TEST_SAMPLES - pos;
+        g_blk.processBlock<MAX_BLOCK>(g_inL + pos, g_inR + pos, outL, outR, n);
+        for (int i = 0; i < n; i++) {
+            if (outL[i] != g_refL[pos + i] || outR[i] != g_refR[pos + i]) return pos + i;
+        }
+        pos += n;
+    }
+    return -1;
+}
+
+static const int16_t ROOMS[] = {0, 16384, 32767};
+
+static void checkAllRooms(const int* blocks, const char* label) {
+    for (int16_t room : ROOMS) {
+        int first = runAndCompare(room, blocks);
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%s, room %d: first mismatch at sample %d", label, (int)room, first);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(-1, first, msg);
+    }
+}
+
+// ================================================================
+// テスト
+// ================================================================
+void test_block_matches_sample_noise_fixed_blocks() {
+    static const int SIZES[] = {16, 32, 64, 128};
+    fillNoise(0x5EED);
+    for (int n : SIZES) {
+        const int blocks[] = {n, 0};
+        char label[32];
+        snprintf(label, sizeof(label), "noise, block %d", n);
+        checkAllRooms(blocks, label);
+    }
+}
+
+// 半端な長さを混ぜると、コム・オールパスの折り返しがブロックの途中のいろいろな位置に来る
+void test_block_matches_sample_noise_ragged_blocks() {
+    static const int BLOCKS[] = {1, 7, 33, 128, 5, 64, 31, 2, 97, 16, 0};
+    fillNoise(0xC0FFEE);
+    checkAllRooms(BLOCKS, "noise, ragged");
+}
+
+void test_block_matches_sample_impulse_tail() {
+    static const int BLOCKS[] = {32, 0};
+    fillImpulse();
+    checkAllRooms(BLOCKS, "impulse");
+}
+
+// 比較が空振りしていないこと（最大ルームでは出力が実際に出ていて、飽和値にも届く）
+void test_reference_output_is_nontrivial() {
+    fillImpulse();
+    static const int BLOCKS[] = {32, 0};
+    TEST_ASSERT_EQUAL_INT(-1, runAndCompare(32767, BLOCKS));
+    int32_t peak = 0;
+    bool tail = false;
+    for (int i = 0; i < TEST_SAMPLES; i++) {
+        int32_t a = g_refL[i] < 0 ? -g_refL[i] : g_refL[i];
+        if (a > peak) peak = a;
+        if (i > 8 * 1617 && g_refL[i] != 0) tail = true;
+    }
+    TEST_ASSERT_TRUE(peak > 16384);
+    TEST_ASSERT_TRUE(tail);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_block_matches_sample_noise_fixed_blocks);
+    RUN_TEST(test_block_matches_sample_noise_ragged_blocks);
+    RUN_TEST(test_block_matches_sample_impulse_tail);
+    RUN_TEST(test_reference_output_is_nontrivial);
+    return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Host Test: Soft Clip & Dry/Wet Mix
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//
+// dsp_math.h の softClip（分岐なし）を、分岐で書いていた従来の曲線と比べる。
+//   - softClip: ±2^21 の全整数 + int32 の端 + 乱数で完全一致
+//   - ドライ/ウェットミックス（mix2Q15）: ウェットを先に softClip していた従来のミックスと
+//     |ウェット| ≤ 24576 で 0LSB。超えた分は膝で丸めない（差は削っていた分 × WET に等しい）
+//
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#include <unity.h>
+#include <stdio.h>
+#include "dsp_math.h"
+
+// ================================================================
+// 従来の実装（分岐版。int32 の端で溢れないよう excess だけ64bitにしてある）
+// ================================================================
+static int16_t softClipOld(int32_t x) {
+    // 範囲内ならそのまま
+    if (x >= -24576 && x <= 24576) {
+        return (int16_t)x;
+    }
+
+    // 3次多項式による滑らかなクリッピング
+    if (x > 24576) {
+        int64_t excess = (int64_t)x - 24576;
+        if (excess > 8191) return 32767;
+        // 滑らかな遷移領域
+        int32_t soft = 24576 + (int32_t)excess - (int32_t)((excess * excess) >> 13);
+        return (int16_t)(soft < 32767 ? soft : 32767);
+    } else {
+        int64_t excess = -24576 - (int64_t)x;
+        if (excess > 8191) return -32767;
+        // 滑らかな遷移領域
+        int32_t soft = -24576 - (int32_t)excess + (int32_t)((excess * excess) >> 13);
+        return (int16_t)(soft > -32767 ? soft : -32767);
+    }
+}
+
+// ウェットを先に softClip してから混ぜていたミックス（飽和前の値）
+static int32_t mixOld(int16_t in, int16_t dry_q15, int32_t wet, int16_t wet_q15) {
+    return ((int32_t)in * dry_q15 + (int32_t)softClipOld(wet) * wet_q15) >> 15;
+}
+
+static uint32_t g_rng_state = 0x1234567u;
+static uint32_t nextRand() {
+    g_rng_state ^= g_rng_state << 13;
+    g_rng_state ^= g_rng_state >> 17;
+    g_rng_state ^= g_rng_state << 5;
+    return g_rng_state;
+}
+
+// ================================================================
+// テスト
+// ================================================================
+void test_soft_clip_matches_old_curve_exhaustive() {
+    uint32_t mismatches = 0;
+    int32_t first = 0;
+    for (int32_t x = -(1 << 21); x <= (1 << 21); x++) {
+        if (softClip(x) != softClipOld(x)) {
+            if (mismatches == 0) first = x;
+            mismatches++;
+        }
+    }
+    char msg[64];
+    snprintf(msg, sizeof(msg), "first mismatch at %d", (int)first);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, mismatches, msg);
+}
+
+void test_soft_clip_matches_old_curve_extremes_and_random() {
+    static const int32_t EDGES[] = {
+        INT32_MIN, INT32_MIN + 1, -65536, -65535, -32769, -32768, -32767, 32767, 32768, 65535, 65536,
+        INT32_MAX - 1, INT32_MAX
+    };
+    for (int32_t x : EDGES) {
+        TEST_ASSERT_EQUAL_INT32(softClipOld(x), softClip(x));
+    }
+    for (int i = 0; i < 1000000; i++) {
+        int32_t x = (int32_t)nextRand();
+        TEST_ASSERT_EQUAL_INT32(softClipOld(x), softClip(x));
+    }
+}
+
+// 奇関数・出力範囲・単調な区間。膝の2次式は e = 4096（|x| = 28672）で最大 26624 になり、
+// その先は下がって |x| = 32767 で 24577、32768 以上で 32767 に跳ぶ（従来の曲線どおり）
+void test_soft_clip_shape() {
+    int16_t prev = softClip(-28672);
+    for (int32_t x = -40000; x <= 40000; x++) {
+        int16_t y = softClip(x);
+        TEST_ASSERT_EQUAL_INT32(-y, softClip(-x));
+        TEST_ASSERT_TRUE(y >= -32767 && y <= 32767);
+        if (x >= -28672 && x <= 28672) {
+            TEST_ASSERT_TRUE(y >= prev);
+            prev = y;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT32(24576, softClip(24576));
+    TEST_ASSERT_EQUAL_INT32(26624, softClip(28672));
+    TEST_ASSERT_EQUAL_INT32(24577, softClip(32767));
+    TEST_ASSERT_EQUAL_INT32(32767, softClip(32768));
+}
+
+// |ウェット| ≤ 24576（従来の softClip の線形区間）では従来のミックスとビット一致
+void test_mix_matches_old_within_linear_region() {
+    uint32_t mismatches = 0;
+    for (int i = 0; i < 5000000; i++) {
+        int16_t in = (int16_t)nextRand();
+        int32_t wet = (int32_t)(nextRand() % 49153) - 24576;
+        int16_t wet_q15 = (int16_t)(nextRand() & 0x7FFF);
+        int16_t dry_q15 = 32767 - wet_q15;
+        if (mix2Q15(in, dry_q15, wet, wet_q15) != mixOld(in, dry_q15, wet, wet_q15)) mismatches++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+}
+
+// 超えた分は線形のまま: 従来との差は (wet - softClip(wet)) × WET の切り捨て1回ぶん（±1LSB）、
+// 符号は常にウェットと同じ向き（新しい方が小さく丸めることはない）
+void test_mix_above_linear_region_keeps_wet_linear() {
+    for (int i = 0; i < 2000000; i++) {
+        int16_t in = (int16_t)nextRand();
+        int32_t mag = 24577 + (int32_t)(nextRand() % 300000);
+        int32_t wet = (nextRand() & 1) ? mag : -mag;
+        int16_t wet_q15 = (int16_t)(nextRand() & 0x7FFF);
+        int16_t dry_q15 = 32767 - wet_q15;
+        int32_t diff = mix2Q15(in, dry_q15, wet, wet_q15) - mixOld(in, dry_q15, wet, wet_q15);
+        int32_t knee = (int32_t)(((int64_t)(wet - softClipOld(wet)) * wet_q15) >> 15);
+        TEST_ASSERT_TRUE(diff - knee >= -1 && diff - knee <= 1);
+        if (wet > 0) TEST_ASSERT_TRUE(diff >= 0);
+        else         TEST_ASSERT_TRUE(diff <= 0);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_soft_clip_matches_old_curve_exhaustive);
+    RUN_TEST(test_soft_clip_matches_old_curve_extremes_and_random);
+    RUN_TEST(test_soft_clip_shape);
+    RUN_TEST(test_mix_matches_old_within_linear_region);
+    RUN_TEST(test_mix_above_linear_region_keeps_wet_linear);
+    return UNITY_END();
+}